@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+# Starts a local dedicated server and adds headless VR bot clients to it in steps, for sizing servers.
+# The server appends a report every REPORT_INTERVAL seconds to Saved/Stress/VRServer-<time>.csv
+# (clients, tick time, bandwidth, CPU and replication time per client), so the rows show how it scales with the bot count.
+#
+# Usage: UE4_EDITOR=/path/to/Engine/Binaries/Linux/UE4Editor Scripts/BotLoadTest.sh [MaxBots] [BotsPerStep] [StepSeconds] [Map]
+
+set -euo pipefail
+
+MAX_BOTS=${1:-32}
+BOTS_PER_STEP=${2:-4}
+STEP_SECONDS=${3:-60}
+MAP=${4:-/Game/Levels/test}
+REPORT_INTERVAL=${REPORT_INTERVAL:-5}
+PORT=${PORT:-7777}
+
+EDITOR=${UE4_EDITOR:?Set UE4_EDITOR to the UE4Editor binary}
+PROJECT="$(cd "$(dirname "$0")/.." && pwd)/GhibliWaterHill.uproject"
+LOG_DIR="$(dirname "$PROJECT")/Saved/Stress/Logs"
+mkdir -p "$LOG_DIR"
+
+PIDS=()
+cleanup()
+{
+	for PID in "${PIDS[@]}"; do kill "$PID" 2>/dev/null || true; done
+	wait 2>/dev/null || true
+}
+trap cleanup EXIT INT TERM
+
+"$EDITOR" "$PROJECT" "$MAP" -server -port="$PORT" -unattended -nosound -log -abslog="$LOG_DIR/Server.log" \
+	-ExecCmds="vr.NetReportInterval $REPORT_INTERVAL, vr.NetReportCsv 1" > /dev/null 2>&1 &
+PIDS+=($!)
+# Give the server time to load the map before anyone connects
+sleep 20
+
+BOTS=0
+while [ "$BOTS" -lt "$MAX_BOTS" ]; do
+	for ((i = 0; i < BOTS_PER_STEP && BOTS < MAX_BOTS; i++)); do
+		BOTS=$((BOTS + 1))
+		"$EDITOR" "$PROJECT" "127.0.0.1:$PORT" -game -vrbot -nullrhi -nosound -unattended -log -abslog="$LOG_DIR/Bot$BOTS.log" > /dev/null 2>&1 &
+		PIDS+=($!)
+	done
+	echo "$BOTS bots connected, measuring for $STEP_SECONDS s"
+	sleep "$STEP_SECONDS"
+done
+
+echo "Done, see $(dirname "$PROJECT")/Saved/Stress/VRServer-*.csv"
@@ -2,5 +2,41 @@
 
 #include "GhibliWaterHill.h"
 #include "Modules/ModuleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "VRTelemetry.h"
+#include "VRLatency.h"
+#include "VRMemoryTracking.h"
+#include "VRNetStats.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, GhibliWaterHill, "GhibliWaterHill" );
+class FGhibliWaterHillModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		RegisterVRLLMTags();
+		StartVRNetReports();
+		BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddLambda([]() { FVRLatency::Get().BeginFrame(); });
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddLambda([]()
+		{
+			FVRLatency::Get().EndFrame();
+			FVRTelemetry::Get().RecordFrame();
+		});
+		EndFrameRTHandle = FCoreDelegates::OnEndFrameRT.AddLambda([]() { FVRLatency::Get().RenderFrameEnded(); });
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		FCoreDelegates::OnEndFrameRT.Remove(EndFrameRTHandle);
+		StopVRNetReports();
+		FVRTelemetry::Get().Stop();
+	}
+
+private:
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+	FDelegateHandle EndFrameRTHandle;
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FGhibliWaterHillModule, GhibliWaterHill, "GhibliWaterHill" );
@@ -3,4 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 
+// Shared by all of the interaction systems so `stat VRInteraction` shows them together
+DECLARE_STATS_GROUP(TEXT("VRInteraction"), STATGROUP_VRInteraction, STATCAT_Advanced);
@@ -3,6 +3,11 @@
 
 #include "Bridge.h"
 #include "Lever.h"
+#include "InteractableSignificanceSubsystem.h"
+#include "MechanismNavSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "VRMemoryTracking.h"
+#include "VRMathCore.h"
 
 // Sets default values
 ABridge::ABridge()
@@ -10,14 +15,41 @@ ABridge::ABridge()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	FPuzzleNetRelevancy::ConfigureDormantReplication(this);
+
 }
 
 // Called when the game starts or when spawned
 void ABridge::BeginPlay()
 {
+	VR_LLM_SCOPE(Interactables);
 	Super::BeginPlay();
 	
 	//InitRotation = GetActorRotation();
+	NetRelevancy.Init(this);
+	// The bridge has to keep following its lever even when out of view, so it is only ever slowed down
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this, -1, false);
+	}
+	if (UMechanismNavSubsystem* MechanismNav = GetWorld()->GetSubsystem<UMechanismNavSubsystem>())
+	{
+		MechanismNav->RegisterMechanism(this);
+	}
+}
+
+// Called when the game ends or when destroyed
+void ABridge::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	if (UMechanismNavSubsystem* MechanismNav = GetWorld()->GetSubsystem<UMechanismNavSubsystem>())
+	{
+		MechanismNav->UnregisterMechanism(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -28,6 +60,36 @@ void ABridge::Tick(float DeltaTime)
 	if (!ensure(LinkedLever)) { return; }
 
 	//UE_LOG(LogTemp, Warning, TEXT("A %f"), LinkedLever->GetLeverRotationPercentage())
-	SetActorRotation(InitRotation + FRotator(90, 0, 0) * LinkedLever->GetLeverRotationPercentage());
+	SetActorRotation(InitRotation + FRotator(VRMath::BridgePitchForLever(GetLinkedLeverPercentage()), 0, 0));
+}
+
+float ABridge::GetLinkedLeverPercentage()
+{
+	// Clients follow the server unless they are moving the lever themselves
+	if (!HasAuthority() && !LinkedLever->bIsHeldLocally()) { return ReplicatedLeverPercentage / 255.f; }
+
+	float Percentage = LinkedLever->GetLeverRotationPercentage();
+	if (HasAuthority())
+	{
+		int32 Quantized = VRMath::QuantizeUnit8(Percentage);
+		bool bAtEnd = (Quantized == 0 || Quantized == 255) && Quantized != ReplicatedLeverPercentage;
+		if (bAtEnd || FMath::Abs(Quantized - ReplicatedLeverPercentage) >= ReplicationStep)
+		{
+			FlushNetDormancy();
+			ReplicatedLeverPercentage = (uint8)Quantized;
+		}
+	}
+	return Percentage;
 }
 
+void ABridge::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABridge, ReplicatedLeverPercentage);
+}
+
+bool ABridge::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return NetRelevancy.IsRelevantFor(SrcLocation) && Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
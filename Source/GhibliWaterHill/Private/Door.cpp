@@ -4,6 +4,12 @@
 #include "Door.h"
 #include "Components/StaticMeshComponent.h"
 #include "PhysicsEngine/PhysicsConstraintComponent.h" 
+#include "InteractableSignificanceSubsystem.h"
+#include "MechanismNavSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "VRTelemetry.h"
+#include "VRInteractionEventSubsystem.h"
+#include "VRMemoryTracking.h"
 
 // Sets default values
 ADoor::ADoor()
@@ -11,13 +17,39 @@ ADoor::ADoor()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	FPuzzleNetRelevancy::ConfigureDormantReplication(this);
 }
 
 // Called when the game starts or when spawned
 void ADoor::BeginPlay()
 {
+	VR_LLM_SCOPE(Interactables);
 	Super::BeginPlay();
 	SetDoorMesh();
+	NetRelevancy.Init(this);
+
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this);
+	}
+	if (UMechanismNavSubsystem* MechanismNav = GetWorld()->GetSubsystem<UMechanismNavSubsystem>())
+	{
+		MechanismNav->RegisterMechanism(this);
+	}
+}
+
+// Called when the game ends or when destroyed
+void ADoor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	if (UMechanismNavSubsystem* MechanismNav = GetWorld()->GetSubsystem<UMechanismNavSubsystem>())
+	{
+		MechanismNav->UnregisterMechanism(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -34,15 +66,48 @@ UStaticMeshComponent* ADoor::SetDoorMesh()
 	return DoorMesh;
 }
 
-void ADoor::SetLockedState(bool Locked)
+void ADoor::SetLockedState(bool Locked, bool bWakeClients)
+{
+	// Wakes the door just long enough to send the change
+	if (HasAuthority() && bWakeClients && Locked != bLocked) { FlushNetDormancy(); }
+	if (bLocked && !Locked) { FVRTelemetry::Get().Record(EVRTelemetryEvent::DoorUnlocked); }
+	bool bChanged = Locked != bLocked;
+	bLocked = Locked;
+	ApplyLockedState();
+	if (bChanged) { BroadcastLockChanged(); }
+}
+
+void ADoor::OnRep_Locked()
+{
+	ApplyLockedState();
+	BroadcastLockChanged();
+}
+
+void ADoor::BroadcastLockChanged()
+{
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>()) { Events->DoorLockChanged.Broadcast({ this, bLocked }); }
+}
+
+void ADoor::ApplyLockedState()
 {
 	TArray<UPhysicsConstraintComponent*> Constraints;
 	GetComponents<UPhysicsConstraintComponent>(Constraints);
 	for (UPhysicsConstraintComponent* Constraint : Constraints)
 	{
 		if (!ensure(Constraint)) { break; }
-		if (Locked) { Constraint->SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Locked, 90); }
+		if (bLocked) { Constraint->SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Locked, 90); }
 		else { Constraint->SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Free, 90); }
 	}
 }
 
+void ADoor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ADoor, bLocked);
+}
+
+bool ADoor::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return NetRelevancy.IsRelevantFor(SrcLocation) && Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
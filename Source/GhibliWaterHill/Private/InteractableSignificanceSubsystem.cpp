@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InteractableSignificanceSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "VRCharacter.h"
+#include "VRController.h"
+#include "VRWorkSchedulerSubsystem.h"
+#include "VRInteractionEventSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_VRInteraction);
+DECLARE_CYCLE_STAT(TEXT("Significance Hand Wake"), STAT_SignificanceHandWake, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Full"), STAT_SignificanceFull, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Reduced"), STAT_SignificanceReduced, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Dormant"), STAT_SignificanceDormant, STATGROUP_VRInteraction);
+
+bool UInteractableSignificanceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UInteractableSignificanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	UVRWorkSchedulerSubsystem* Scheduler = Collection.InitializeDependency<UVRWorkSchedulerSubsystem>();
+	if (ensure(Scheduler))
+	{
+		// A hand reaching for something can't wait for the budget, the rest of the scoring can
+		Scheduler->RegisterWork(this, TEXT("SignificanceHandWake"), EVRWorkPriority::Critical, 0.02f, [this](float DeltaTime) { WakeNearHands(DeltaTime); }, true);
+		Scheduler->RegisterWork(this, TEXT("Significance"), EVRWorkPriority::Normal, 0.1f, [this](float DeltaTime) { Update(DeltaTime); }, true);
+	}
+	UVRInteractionEventSubsystem* Events = Collection.InitializeDependency<UVRInteractionEventSubsystem>();
+	if (ensure(Events))
+	{
+		GrabbedSubscription = Events->Grabbed.Subscribe<UInteractableSignificanceSubsystem, &UInteractableSignificanceSubsystem::OnGrabbed>(this);
+		FlingStartedSubscription = Events->FlingStarted.Subscribe<UInteractableSignificanceSubsystem, &UInteractableSignificanceSubsystem::OnFlingStarted>(this);
+	}
+}
+
+void UInteractableSignificanceSubsystem::Deinitialize()
+{
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>())
+	{
+		Events->Grabbed.Unsubscribe(GrabbedSubscription);
+		Events->FlingStarted.Unsubscribe(FlingStartedSubscription);
+	}
+	Entries.Empty();
+	Super::Deinitialize();
+}
+
+void UInteractableSignificanceSubsystem::RegisterActor(AActor* Actor, float WakeRadius, bool bAllowTickDisable)
+{
+	if (!ensure(Actor)) { return; }
+	for (const FSignificanceEntry& Entry : Entries) { if (Entry.Actor == Actor) { return; } }
+
+	FSignificanceEntry Entry;
+	Entry.Actor = Actor;
+	Entry.WakeRadiusSquared = FMath::Square(WakeRadius < 0 ? HandWakeRadius : WakeRadius);
+	Entry.bAllowTickDisable = bAllowTickDisable;
+	Entry.FullTickInterval = Actor->GetActorTickInterval();
+	Entries.Add(Entry);
+}
+
+void UInteractableSignificanceSubsystem::UnregisterActor(AActor* Actor)
+{
+	Entries.RemoveAllSwap([Actor](const FSignificanceEntry& Entry) { return Entry.Actor == Actor || !Entry.Actor.IsValid(); });
+}
+
+void UInteractableSignificanceSubsystem::WakeActor(AActor* Actor)
+{
+	for (FSignificanceEntry& Entry : Entries)
+	{
+		if (Entry.Actor == Actor) { ApplyBucket(Entry, ESignificanceBucket::Full); return; }
+	}
+}
+
+void UInteractableSignificanceSubsystem::OnGrabbed(const FVRGrabEvent& Event)
+{
+	if (Event.Component) { WakeActor(Event.Component->GetOwner()); }
+}
+
+void UInteractableSignificanceSubsystem::OnFlingStarted(const FVRFlingStartedEvent& Event)
+{
+	if (Event.Component) { WakeActor(Event.Component->GetOwner()); }
+}
+
+void UInteractableSignificanceSubsystem::WakeNearHands(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceHandWake);
+	if (Entries.Num() == 0) { return; }
+
+	GatherViewers();
+	if (HandLocations.Num() == 0) { return; }
+	for (FSignificanceEntry& Entry : Entries)
+	{
+		if (Entry.Bucket != ESignificanceBucket::Full && Entry.Actor.IsValid() && bHandNear(Entry)) { ApplyBucket(Entry, ESignificanceBucket::Full); }
+	}
+}
+
+void UInteractableSignificanceSubsystem::Update(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+	if (Entries.Num() == 0) { return; }
+
+	GatherViewers();
+	if (Viewers.Num() == 0) { return; }
+
+	// Scoring everything is only done every ScoreInterval, hands are checked every frame in WakeNearHands
+	TimeSinceScore += DeltaTime;
+	bool bRescore = TimeSinceScore >= ScoreInterval;
+	if (bRescore) { TimeSinceScore = 0; }
+
+	int32 NumFull = 0, NumReduced = 0, NumDormant = 0;
+	for (int32 i = Entries.Num() - 1; i >= 0; i--)
+	{
+		FSignificanceEntry& Entry = Entries[i];
+		if (!Entry.Actor.IsValid())
+		{
+			Entries.RemoveAtSwap(i);
+			continue;
+		}
+
+		if (bRescore) { ApplyBucket(Entry, ScoreEntry(Entry)); }
+
+		if (Entry.Bucket == ESignificanceBucket::Full) { NumFull++; }
+		else if (Entry.Bucket == ESignificanceBucket::Reduced) { NumReduced++; }
+		else { NumDormant++; }
+	}
+	SET_DWORD_STAT(STAT_SignificanceFull, NumFull);
+	SET_DWORD_STAT(STAT_SignificanceReduced, NumReduced);
+	SET_DWORD_STAT(STAT_SignificanceDormant, NumDormant);
+}
+
+void UInteractableSignificanceSubsystem::GatherViewers()
+{
+	Viewers.Reset();
+	HandLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (!PlayerController) { continue; }
+
+		FViewer Viewer;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(Viewer.Location, ViewRotation);
+		Viewer.Forward = ViewRotation.Vector();
+		Viewers.Add(Viewer);
+
+		AVRCharacter* Character = Cast<AVRCharacter>(PlayerController->GetPawn());
+		if (!Character) { continue; }
+		if (Character->GetLeftController()) { HandLocations.Add(Character->GetLeftController()->GetActorLocation()); }
+		if (Character->GetRightController()) { HandLocations.Add(Character->GetRightController()->GetActorLocation()); }
+	}
+}
+
+bool UInteractableSignificanceSubsystem::bHandNear(const FSignificanceEntry& Entry) const
+{
+	FVector Location = Entry.Actor->GetActorLocation();
+	for (const FVector& HandLocation : HandLocations)
+	{
+		if (FVector::DistSquared(HandLocation, Location) < Entry.WakeRadiusSquared) { return true; }
+	}
+	return false;
+}
+
+ESignificanceBucket UInteractableSignificanceSubsystem::ScoreEntry(const FSignificanceEntry& Entry) const
+{
+	if (bHandNear(Entry)) { return ESignificanceBucket::Full; }
+
+	FVector Location = Entry.Actor->GetActorLocation();
+	float ConeCos = FMath::Cos(FMath::DegreesToRadians(ViewConeHalfAngle));
+	ESignificanceBucket Best = ESignificanceBucket::Dormant;
+	for (const FViewer& Viewer : Viewers)
+	{
+		FVector ToActor = Location - Viewer.Location;
+		float Distance = ToActor.Size();
+		bool bInView = Distance < KINDA_SMALL_NUMBER || FVector::DotProduct(ToActor / Distance, Viewer.Forward) > ConeCos;
+
+		if (Distance < FullRateDistance && bInView) { return ESignificanceBucket::Full; }
+		if (Distance < FullRateDistance || (Distance < ReducedRateDistance && bInView)) { Best = ESignificanceBucket::Reduced; }
+	}
+	return Best;
+}
+
+void UInteractableSignificanceSubsystem::ApplyBucket(FSignificanceEntry& Entry, ESignificanceBucket Bucket)
+{
+	if (Entry.Bucket == Bucket) { return; }
+	Entry.Bucket = Bucket;
+
+	AActor* Actor = Entry.Actor.Get();
+	switch (Bucket)
+	{
+	case ESignificanceBucket::Full:
+		Actor->SetActorTickInterval(Entry.FullTickInterval);
+		Actor->SetActorTickEnabled(true);
+		break;
+	case ESignificanceBucket::Reduced:
+		// Never faster than the actor asked for
+		Actor->SetActorTickInterval(FMath::Max(ReducedTickInterval, Entry.FullTickInterval));
+		Actor->SetActorTickEnabled(true);
+		break;
+	case ESignificanceBucket::Dormant:
+		if (Entry.bAllowTickDisable) { Actor->SetActorTickEnabled(false); }
+		else { Actor->SetActorTickInterval(FMath::Max(DormantTickInterval, Entry.FullTickInterval)); }
+		break;
+	}
+}
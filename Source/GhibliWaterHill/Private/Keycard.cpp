@@ -2,6 +2,8 @@
 
 
 #include "Keycard.h"
+#include "Components/PrimitiveComponent.h"
+#include "PuzzleNetRelevancy.h"
 
 // Sets default values
 AKeycard::AKeycard()
@@ -9,6 +11,8 @@ AKeycard::AKeycard()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	FPuzzleNetRelevancy::ConfigureDormantReplication(this);
+
 }
 
 // Called when the game starts or when spawned
@@ -23,5 +27,10 @@ void AKeycard::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// Woken when grabbed or flicked, goes back to sleep on the network once it has come to rest.
+	// Keycards get carried between rooms so unlike the other puzzle pieces they are only culled by distance
+	if (!HasAuthority() || NetDormancy != DORM_Awake) { return; }
+	UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(GetRootComponent());
+	if (Root && !Root->RigidBodyIsAwake()) { SetNetDormancy(DORM_DormantAll); }
 }
 
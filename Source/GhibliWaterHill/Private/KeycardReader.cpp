@@ -7,7 +7,11 @@
 #include "Engine/StaticMeshActor.h" 
 #include "Keycard.h"
 #include "Door.h"
-#include "Materials/MaterialInstanceDynamic.h"
+#include "Materials/MaterialInterface.h"
+#include "VRInteractionPoolSubsystem.h"
+#include "InteractableSignificanceSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "VRMemoryTracking.h"
 
 // Sets default values
 AKeycardReader::AKeycardReader()
@@ -15,6 +19,8 @@ AKeycardReader::AKeycardReader()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	FPuzzleNetRelevancy::ConfigureDormantReplication(this);
+
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Scene"));
 
 	if (GetWorld())
@@ -31,14 +37,30 @@ AKeycardReader::AKeycardReader()
 // Called when the game starts or when spawned
 void AKeycardReader::BeginPlay()
 {
+	VR_LLM_SCOPE(Interactables);
 	Super::BeginPlay();
 
 	SetReaderMesh();
-	if (!ensure(ReaderMesh->GetMaterial(1))) { return; }
-	ActiveMaterialInstance = UMaterialInstanceDynamic::Create(ReaderMesh->GetMaterial(1), this);
-	ReaderMesh->SetMaterial(1, ActiveMaterialInstance);
+	NetRelevancy.Init(this);
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this);
+	}
 
-	SetLocked(true);
+	ReaderMaterialBase = ReaderMesh->GetMaterial(1);
+	if (!ensure(ReaderMaterialBase)) { return; }
+
+	SetLocked(true, false);
+}
+
+// Called when the game ends or when destroyed
+void AKeycardReader::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -54,6 +76,8 @@ void AKeycardReader::OnOverlapBegin(UPrimitiveComponent* OverlappedComp,
 	bool bFromSweep,
 	const FHitResult& SweepResult)
 {
+	// Clients hear about the unlock from the server
+	if (!HasAuthority()) { return; }
 	if (!ensure(LinkedKeycard)) { return; }
 	if (!bDoorLocked) { return; }
 	if ( (OtherActor == LinkedKeycard) && (OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr))
@@ -62,14 +86,25 @@ void AKeycardReader::OnOverlapBegin(UPrimitiveComponent* OverlappedComp,
 	}
 }
 
-void AKeycardReader::SetLocked(bool bLocked)
+FVector AKeycardReader::GetDetectLocation() const
+{
+	return KeycardDetectRegion ? KeycardDetectRegion->GetComponentLocation() : GetActorLocation();
+}
+
+void AKeycardReader::SetLocked(bool bLocked, bool bWakeClients)
 {
 	if (!ensure(LinkedDoor)) { return; }
-	LinkedDoor->SetLockedState(bLocked);
+	if (HasAuthority() && bWakeClients && bLocked != bDoorLocked) { FlushNetDormancy(); }
+	LinkedDoor->SetLockedState(bLocked, bWakeClients);
 	bDoorLocked = bLocked;
 	ChangeMaterial(bDoorLocked);
 }
 
+void AKeycardReader::OnRep_DoorLocked()
+{
+	ChangeMaterial(bDoorLocked);
+}
+
 UStaticMeshComponent* AKeycardReader::SetReaderMesh()
 {
 	TArray<UStaticMeshComponent*> Meshes;
@@ -82,8 +117,20 @@ UStaticMeshComponent* AKeycardReader::SetReaderMesh()
 void AKeycardReader::ChangeMaterial(bool bLocked)
 {
 	if (!ensure(ReaderMesh)) { return; }
-	if (!ensure(ActiveMaterialInstance)) { return; }
-	if (bLocked) { ActiveMaterialInstance->SetScalarParameterValue(TEXT("DoorLocked"), 1); }
-	else { ActiveMaterialInstance->SetScalarParameterValue(TEXT("DoorLocked"), 0); }
+	if (!ReaderMaterialBase) { return; }
+	UVRInteractionPoolSubsystem* Pool = GetWorld()->GetSubsystem<UVRInteractionPoolSubsystem>();
+	if (!ensure(Pool)) { return; }
+	ReaderMesh->SetMaterial(1, Pool->GetSharedMaterialInstance(ReaderMaterialBase, TEXT("DoorLocked"), bLocked ? 1 : 0));
 }
 
+void AKeycardReader::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AKeycardReader, bDoorLocked);
+}
+
+bool AKeycardReader::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return NetRelevancy.IsRelevantFor(SrcLocation) && Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
@@ -3,6 +3,14 @@
 
 #include "Lever.h"
 #include "Components/StaticMeshComponent.h"
+#include "InteractableSignificanceSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "Kismet/GameplayStatics.h"
+#include "VRCharacter.h"
+#include "VRController.h"
+#include "VRMemoryTracking.h"
+#include "VRMathCore.h"
+#include "VRInteractionEventSubsystem.h"
 
 // Sets default values
 ALever::ALever()
@@ -10,14 +18,34 @@ ALever::ALever()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	FPuzzleNetRelevancy::ConfigureDormantReplication(this);
+
 }
 
 // Called when the game starts or when spawned
 void ALever::BeginPlay()
 {
+	VR_LLM_SCOPE(Interactables);
 	Super::BeginPlay();
 	SetLeverMesh();
+	NetRelevancy.Init(this);
 	//InitialRodRotation = RodMesh->GetComponentRotation(); <-- this doesn't work, provides incorrect init
+
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		// The rod is only checked in Tick, a dormant lever that stopped ticking would never send a knock it took
+		Significance->RegisterActor(this, -1, false);
+	}
+}
+
+// Called when the game ends or when destroyed
+void ALever::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -25,6 +53,16 @@ void ALever::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 	//UE_LOG(LogTemp, Warning, TEXT("A %s %s"), *InitialRodRotation.ToString(), *RodMesh->GetComponentRotation().ToString())
+
+	if (!HasAuthority() || !RodMesh) { return; }
+	// Stays dormant until the rod has moved past the next step
+	int32 RodPercentage = FMath::RoundToInt(GetSignedRodScale() * 100);
+	if (FMath::Abs(RodPercentage - ReplicatedRodPercentage) >= ReplicationStep)
+	{
+		FlushNetDormancy();
+		ReplicatedRodPercentage = (int8)RodPercentage;
+		BroadcastLeverChanged();
+	}
 }
 
 UStaticMeshComponent* ALever::SetLeverMesh()
@@ -36,13 +74,72 @@ UStaticMeshComponent* ALever::SetLeverMesh()
 	return RodMesh;
 }
 
+float ALever::GetSignedRodScale() const
+{
+	return VRMath::RodPitchToScale(RodMesh->GetComponentRotation().Pitch - InitialRodRotation.Pitch, RodRotationMaxScale);
+}
 
 float ALever::GetLeverRotationPercentage()
 {
 	if (!ensure(RodMesh)) { return 0; }
-	float RodRotation = RodMesh->GetComponentRotation().Pitch - InitialRodRotation.Pitch;
-	float Scale = RodRotation / RodRotationMaxScale;
 	//UE_LOG(LogTemp, Warning, TEXT("Percentage %f"), RodMesh->GetComponentRotation().Pitch)
-	if (abs(Scale) < 0.05) { Scale = 0; }
-	return FMath::Clamp(abs(Scale), 0.f, 1.f);
-}
\ No newline at end of file
+	return VRMath::LeverOpenAmount(GetSignedRodScale());
+}
+
+bool ALever::bIsHeldLocally() const
+{
+	AVRCharacter* Character = Cast<AVRCharacter>(UGameplayStatics::GetPlayerPawn(this, 0));
+	if (!Character || !RodMesh) { return false; }
+	for (AVRController* Controller : { Character->GetLeftController(), Character->GetRightController() })
+	{
+		if (Controller && Controller->GetGrabbedComponent() == RodMesh) { return true; }
+	}
+	return false;
+}
+
+void ALever::OnRep_RodPercentage()
+{
+	BroadcastLeverChanged();
+	if (!RodMesh || bIsHeldLocally()) { return; }
+	ApplyRodScale(ReplicatedRodPercentage / 100.f);
+}
+
+void ALever::BroadcastLeverChanged()
+{
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>())
+	{
+		Events->LeverChanged.Broadcast({ this, ReplicatedRodPercentage / 100.f });
+	}
+}
+
+void ALever::RestoreRodScale(float Scale)
+{
+	if (!ensure(RodMesh)) { return; }
+	ApplyRodScale(Scale);
+	RodMesh->SetPhysicsLinearVelocity(FVector::ZeroVector);
+	RodMesh->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+	if (HasAuthority())
+	{
+		FlushNetDormancy();
+		ReplicatedRodPercentage = (int8)FMath::RoundToInt(Scale * 100);
+	}
+}
+
+void ALever::ApplyRodScale(float Scale)
+{
+	FRotator RodRotation = RodMesh->GetComponentRotation();
+	RodRotation.Pitch = InitialRodRotation.Pitch + Scale * RodRotationMaxScale;
+	RodMesh->SetWorldRotation(RodRotation, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void ALever::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ALever, ReplicatedRodPercentage);
+}
+
+bool ALever::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return NetRelevancy.IsRelevantFor(SrcLocation) && Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
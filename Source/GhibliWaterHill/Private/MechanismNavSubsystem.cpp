@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MechanismNavSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/World.h"
+#include "Components/PrimitiveComponent.h"
+#include "NavigationSystem.h"
+#include "VRWorkSchedulerSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Mechanism Nav Update"), STAT_MechanismNavUpdate, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Mechanism Nav Rebuilds"), STAT_MechanismNavRebuilds, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mechanisms Unsettled"), STAT_MechanismsUnsettled, STATGROUP_VRInteraction);
+
+namespace
+{
+	// Anything less than this between frames is physics jitter, not movement
+	constexpr float StillDistance = 0.1;
+	constexpr float StillAngle = 0.1;
+}
+
+bool UMechanismNavSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMechanismNavSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	UVRWorkSchedulerSubsystem* Scheduler = Collection.InitializeDependency<UVRWorkSchedulerSubsystem>();
+	if (ensure(Scheduler))
+	{
+		Scheduler->RegisterWork(this, TEXT("MechanismNav"), EVRWorkPriority::Low, 0.05f, [this](float DeltaTime) { Update(DeltaTime); }, true);
+	}
+}
+
+void UMechanismNavSubsystem::Deinitialize()
+{
+	for (FMechanism& Mechanism : Mechanisms) { SetAffectsNavigation(Mechanism, true); }
+	Mechanisms.Empty();
+	Super::Deinitialize();
+}
+
+void UMechanismNavSubsystem::RegisterMechanism(AActor* Actor)
+{
+	if (!ensure(Actor)) { return; }
+	for (const FMechanism& Mechanism : Mechanisms) { if (Mechanism.Actor == Actor) { return; } }
+
+	FMechanism Mechanism;
+	Mechanism.Actor = Actor;
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		if (!Primitive->IsRegistered() || !Primitive->CanEverAffectNavigation()) { continue; }
+		FMechanismComponent Component;
+		Component.Component = Primitive;
+		Component.LastTransform = Primitive->GetComponentTransform();
+		Mechanism.Components.Add(Component);
+		Mechanism.BuiltBounds += Primitive->Bounds.GetBox();
+	}
+	if (Mechanism.Components.Num() > 0) { Mechanisms.Add(Mechanism); }
+}
+
+void UMechanismNavSubsystem::UnregisterMechanism(AActor* Actor)
+{
+	Mechanisms.RemoveAllSwap([this, Actor](FMechanism& Mechanism)
+	{
+		bool bRemove = Mechanism.Actor == Actor || !Mechanism.Actor.IsValid();
+		if (bRemove) { SetAffectsNavigation(Mechanism, true); }
+		return bRemove;
+	});
+}
+
+bool UMechanismNavSubsystem::IsSettledAt(const FVector& Location) const
+{
+	for (const FMechanism& Mechanism : Mechanisms)
+	{
+		if (Mechanism.State == EMechanismNavState::Idle) { continue; }
+		if (Mechanism.UnsettledBounds.ExpandBy(UnsettledPadding).IsInside(Location)) { return false; }
+	}
+	return true;
+}
+
+bool UMechanismNavSubsystem::bMovedFrom(const FTransform& Transform, const FTransform& From, float Distance, float AngleDegrees) const
+{
+	return !Transform.GetLocation().Equals(From.GetLocation(), Distance)
+		|| Transform.GetRotation().AngularDistance(From.GetRotation()) > FMath::DegreesToRadians(AngleDegrees);
+}
+
+void UMechanismNavSubsystem::Update(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MechanismNavUpdate);
+	if (Mechanisms.Num() == 0) { return; }
+	TimeSinceRebuild += DeltaTime;
+
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	bool bBuilding = NavSystem && NavSystem->IsNavigationBuildInProgress();
+	bool bAnyDirty = false;
+	for (int32 i = Mechanisms.Num() - 1; i >= 0; i--)
+	{
+		FMechanism& Mechanism = Mechanisms[i];
+		if (!Mechanism.Actor.IsValid()) { Mechanisms.RemoveAtSwap(i); continue; }
+		UpdateMotion(Mechanism, DeltaTime);
+		if (Mechanism.State == EMechanismNavState::Building && !bBuilding) { Mechanism.State = EMechanismNavState::Idle; }
+		bAnyDirty |= Mechanism.State == EMechanismNavState::Dirty;
+		if (Mechanism.State != EMechanismNavState::Idle) { INC_DWORD_STAT(STAT_MechanismsUnsettled); }
+	}
+
+	// Without a navmesh (eg. on clients) there's nothing to rebuild, only to track
+	if (bAnyDirty && !NavSystem)
+	{
+		for (FMechanism& Mechanism : Mechanisms)
+		{
+			if (Mechanism.State != EMechanismNavState::Dirty) { continue; }
+			SetAffectsNavigation(Mechanism, true);
+			Mechanism.State = EMechanismNavState::Idle;
+		}
+	}
+	else if (bAnyDirty && TimeSinceRebuild >= MinRebuildInterval)
+	{
+		RebuildDirty();
+	}
+}
+
+void UMechanismNavSubsystem::UpdateMotion(FMechanism& Mechanism, float DeltaTime)
+{
+	bool bMoving = false;
+	FBox CurrentBounds(ForceInit);
+	for (FMechanismComponent& Component : Mechanism.Components)
+	{
+		UPrimitiveComponent* Primitive = Component.Component.Get();
+		if (!Primitive) { continue; }
+		const FTransform& Transform = Primitive->GetComponentTransform();
+		bMoving |= bMovedFrom(Transform, Component.LastTransform, StillDistance, StillAngle);
+		Component.LastTransform = Transform;
+		CurrentBounds += Primitive->Bounds.GetBox();
+	}
+
+	if (bMoving)
+	{
+		// Teleports are refused anywhere it has swept through since the navmesh was last right
+		if (Mechanism.State == EMechanismNavState::Idle) { Mechanism.UnsettledBounds = Mechanism.BuiltBounds; }
+		Mechanism.UnsettledBounds += CurrentBounds;
+		Mechanism.State = EMechanismNavState::Moving;
+		Mechanism.StillTime = 0;
+		// Otherwise every frame it moves, however little, updates the octree and dirties the tiles under it
+		SetAffectsNavigation(Mechanism, false);
+		return;
+	}
+
+	if (Mechanism.State != EMechanismNavState::Moving) { return; }
+	Mechanism.StillTime += DeltaTime;
+	if (Mechanism.StillTime < SettleTime) { return; }
+	Mechanism.State = EMechanismNavState::Dirty;
+}
+
+void UMechanismNavSubsystem::SetAffectsNavigation(FMechanism& Mechanism, bool bAffects)
+{
+	if (Mechanism.bOutOfOctree != bAffects) { return; }
+	Mechanism.bOutOfOctree = !bAffects;
+	for (FMechanismComponent& Component : Mechanism.Components)
+	{
+		// Adds or removes it from the octree, dirtying its bounds
+		if (UPrimitiveComponent* Primitive = Component.Component.Get()) { Primitive->SetCanEverAffectNavigation(bAffects); }
+	}
+}
+
+void UMechanismNavSubsystem::RebuildDirty()
+{
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!ensure(NavSystem)) { return; }
+	TimeSinceRebuild = 0;
+
+	// The old bounds were dirtied when it left the octree, putting it back dirties just the new ones.
+	// The dynamic navmesh rebuilds those tiles on worker threads over the next frames.
+	for (FMechanism& Mechanism : Mechanisms)
+	{
+		if (Mechanism.State != EMechanismNavState::Dirty) { continue; }
+		SetAffectsNavigation(Mechanism, true);
+		Mechanism.BuiltBounds.Init();
+		for (FMechanismComponent& Component : Mechanism.Components)
+		{
+			if (UPrimitiveComponent* Primitive = Component.Component.Get()) { Mechanism.BuiltBounds += Primitive->Bounds.GetBox(); }
+		}
+		Mechanism.State = EMechanismNavState::Building;
+		INC_DWORD_STAT(STAT_MechanismNavRebuilds);
+	}
+}
@@ -0,0 +1,467 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PhysicsPropActivitySubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "VRCharacter.h"
+#include "VRController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Prop Activity Update"), STAT_PropActivityUpdate, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Props Tracked"), STAT_PropsTracked, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Props Awake"), STAT_PropsAwake, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Props Kinematic"), STAT_PropsKinematic, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Prop Wakes"), STAT_PropWakes, STATGROUP_VRInteraction);
+
+static int32 GVRPropActivity = 1;
+static FAutoConsoleVariableRef CVarVRPropActivity(
+	TEXT("vr.PropActivity"),
+	GVRPropActivity,
+	TEXT("1 to let UPhysicsPropActivitySubsystem sleep and freeze props away from the players, 0 to leave every prop simulating"));
+
+bool UPhysicsPropActivitySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UPhysicsPropActivitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	ActorsInitializedHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UPhysicsPropActivitySubsystem::OnActorsInitialized);
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UPhysicsPropActivitySubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UPhysicsPropActivitySubsystem::OnLevelRemoved);
+}
+
+void UPhysicsPropActivitySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(ActorsInitializedHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	Props.Empty();
+	Grid.Empty();
+	RegisteredLevels.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UPhysicsPropActivitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPhysicsPropActivitySubsystem, STATGROUP_Tickables);
+}
+
+void UPhysicsPropActivitySubsystem::OnActorsInitialized(const UWorld::FActorsInitializedParams& Params)
+{
+	if (Params.World != GetWorld()) { return; }
+	for (ULevel* Level : GetWorld()->GetLevels())
+	{
+		if (Level && Level->bIsVisible) { RegisterLevelProps(Level); }
+	}
+	UE_LOG(LogTemp, Log, TEXT("Managing %d physics props"), Props.Num());
+}
+
+void UPhysicsPropActivitySubsystem::OnLevelAdded(ULevel* Level, UWorld* World)
+{
+	// Levels made visible before the actors are initialized are picked up with the rest in OnActorsInitialized
+	if (World != GetWorld() || !World->AreActorsInitialized()) { return; }
+	RegisterLevelProps(Level);
+	UE_LOG(LogTemp, Log, TEXT("Managing %d physics props after streaming in %s"), Props.Num(), *GetNameSafe(Level->GetOuter()));
+}
+
+void UPhysicsPropActivitySubsystem::OnLevelRemoved(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld()) { return; }
+	// No level means the whole world is going
+	if (!Level)
+	{
+		Props.Empty();
+		Grid.Empty();
+		RegisteredLevels.Empty();
+		NextScoreIndex = 0;
+		NumKinematic = 0;
+		return;
+	}
+	UnregisterLevelProps(Level);
+}
+
+void UPhysicsPropActivitySubsystem::RegisterLevelProps(ULevel* Level)
+{
+	if (!Level || RegisteredLevels.Contains(Level)) { return; }
+	RegisteredLevels.Add(Level);
+	for (AActor* Actor : Level->Actors)
+	{
+		// Hands and players have their own physics
+		if (!Actor || Actor->IsA<APawn>() || Actor->IsA<AVRController>()) { continue; }
+		UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Actor->GetRootComponent());
+		if (Root && Root->BodyInstance.bSimulatePhysics && Root->Mobility == EComponentMobility::Movable) { RegisterProp(Root); }
+	}
+}
+
+void UPhysicsPropActivitySubsystem::UnregisterLevelProps(ULevel* Level)
+{
+	RegisteredLevels.Remove(Level);
+	RegisteredLevels.RemoveAll([](const TWeakObjectPtr<ULevel>& Registered) { return !Registered.IsValid(); });
+
+	// Props spawned at runtime belong to the persistent level, so only streamed in level props go here
+	int32 NumRemoved = Props.RemoveAll([this, Level](const FPhysicsProp& Prop)
+	{
+		UPrimitiveComponent* Component = Prop.Component.Get();
+		bool bRemove = !Component || Component->GetComponentLevel() == Level;
+		if (bRemove && Prop.Activity == EPropActivity::Kinematic) { NumKinematic--; }
+		return bRemove;
+	});
+	if (NumRemoved == 0) { return; }
+
+	// Indices have moved, so the grid is rebuilt
+	Grid.Reset();
+	for (int32 Index = 0; Index < Props.Num(); Index++) { Grid.FindOrAdd(Props[Index].Cell).Add(Index); }
+	if (NextScoreIndex >= Props.Num()) { NextScoreIndex = 0; }
+}
+
+void UPhysicsPropActivitySubsystem::RegisterProp(UPrimitiveComponent* Component)
+{
+	if (!ensure(Component)) { return; }
+	FPhysicsProp Prop;
+	Prop.Component = Component;
+	Prop.Cell = GetCell(Component->GetComponentLocation());
+	int32 Index = Props.Add(Prop);
+	Grid.FindOrAdd(Prop.Cell).Add(Index);
+}
+
+void UPhysicsPropActivitySubsystem::UnregisterProp(UPrimitiveComponent* Component)
+{
+	int32 Index = Props.IndexOfByPredicate([Component](const FPhysicsProp& Prop) { return Prop.Component == Component; });
+	if (Index != INDEX_NONE) { RemoveProp(Index); }
+}
+
+void UPhysicsPropActivitySubsystem::RemoveProp(int32 Index)
+{
+	if (Props[Index].Activity == EPropActivity::Kinematic) { NumKinematic--; }
+	if (TArray<int32>* Cell = Grid.Find(Props[Index].Cell))
+	{
+		Cell->RemoveSwap(Index);
+		if (Cell->Num() == 0) { Grid.Remove(Props[Index].Cell); }
+	}
+	int32 LastIndex = Props.Num() - 1;
+	if (Index != LastIndex)
+	{
+		// The last prop takes this index, in the grid too
+		if (TArray<int32>* LastCell = Grid.Find(Props[LastIndex].Cell))
+		{
+			int32 Slot = LastCell->Find(LastIndex);
+			if (Slot != INDEX_NONE) { (*LastCell)[Slot] = Index; }
+		}
+	}
+	Props.RemoveAtSwap(Index);
+	if (NextScoreIndex > Props.Num()) { NextScoreIndex = Props.Num(); }
+}
+
+void UPhysicsPropActivitySubsystem::GetPropComponents(TArray<UPrimitiveComponent*>& OutComponents) const
+{
+	for (const FPhysicsProp& Prop : Props)
+	{
+		if (UPrimitiveComponent* Component = Prop.Component.Get()) { OutComponents.Add(Component); }
+	}
+}
+
+FIntVector UPhysicsPropActivitySubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UPhysicsPropActivitySubsystem::MoveToCell(int32 Index, const FIntVector& Cell)
+{
+	FPhysicsProp& Prop = Props[Index];
+	if (Prop.Cell == Cell) { return; }
+	if (TArray<int32>* OldCell = Grid.Find(Prop.Cell))
+	{
+		OldCell->RemoveSwap(Index);
+		if (OldCell->Num() == 0) { Grid.Remove(Prop.Cell); }
+	}
+	Prop.Cell = Cell;
+	Grid.FindOrAdd(Cell).Add(Index);
+}
+
+void UPhysicsPropActivitySubsystem::QuerySphere(const FVector& Center, float Radius)
+{
+	QueryResults.Reset();
+	FIntVector Min = GetCell(Center - FVector(Radius));
+	FIntVector Max = GetCell(Center + FVector(Radius));
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				if (const TArray<int32>* Cell = Grid.Find(FIntVector(X, Y, Z))) { QueryResults.Append(*Cell); }
+			}
+		}
+	}
+}
+
+void UPhysicsPropActivitySubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PropActivityUpdate);
+
+	bool bEnabled = GVRPropActivity != 0;
+	if (bEnabled != bWasEnabled)
+	{
+		bWasEnabled = bEnabled;
+		if (!bEnabled) { RestoreAll(); }
+	}
+	if (!bEnabled) { return; }
+
+	GatherInterest();
+	if (Viewers.Num() == 0) { return; }
+	WakeNearHands();
+
+	// Everything else is re-scored a slice at a time, a full pass takes Props.Num() / PropsScoredPerFrame frames
+	int32 NumToScore = FMath::Min(PropsScoredPerFrame, Props.Num());
+	for (int32 i = 0; i < NumToScore && Props.Num() > 0; i++)
+	{
+		if (NextScoreIndex >= Props.Num())
+		{
+			NextScoreIndex = 0;
+			AwakeLastCycle = AwakeThisCycle;
+			AwakeThisCycle = 0;
+		}
+		// Destroyed without being unregistered, the last prop moves into this slot and is scored next
+		if (!Props[NextScoreIndex].Component.IsValid())
+		{
+			RemoveProp(NextScoreIndex);
+			continue;
+		}
+		ScoreProp(NextScoreIndex++);
+	}
+
+	SET_DWORD_STAT(STAT_PropsTracked, Props.Num());
+	SET_DWORD_STAT(STAT_PropsAwake, AwakeLastCycle);
+	SET_DWORD_STAT(STAT_PropsKinematic, NumKinematic);
+}
+
+void UPhysicsPropActivitySubsystem::GatherInterest()
+{
+	Viewers.Reset();
+	HandLocations.Reset();
+	FlickCones.Reset();
+	PinnedComponents.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (!PlayerController) { continue; }
+
+		FViewer Viewer;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(Viewer.Location, ViewRotation);
+		Viewer.Forward = ViewRotation.Vector();
+		Viewers.Add(Viewer);
+
+		AVRCharacter* Character = Cast<AVRCharacter>(PlayerController->GetPawn());
+		if (!Character) { continue; }
+		for (AVRController* Controller : { Character->GetLeftController(), Character->GetRightController() })
+		{
+			if (!Controller) { continue; }
+			const FVRControllerPose& Pose = Controller->GetPose();
+			HandLocations.Add(Pose.Location);
+			// Wake what the hand could pick next, before FlickHighlight looks for it
+			if (Pose.bGoodFlickRotation) { FlickCones.Add({ Pose.Location, Pose.HandDirection }); }
+			if (UPrimitiveComponent* Grabbed = Controller->GetGrabbedComponent()) { PinnedComponents.Add(Grabbed); }
+			if (UPrimitiveComponent* Flicking = Controller->GetFlickingComponent()) { PinnedComponents.Add(Flicking); }
+		}
+	}
+}
+
+void UPhysicsPropActivitySubsystem::WakeNearHands()
+{
+	int32 NumWakes = 0;
+	for (const FVector& HandLocation : HandLocations)
+	{
+		QuerySphere(HandLocation, HandWakeRadius);
+		for (int32 Index : QueryResults)
+		{
+			FPhysicsProp& Prop = Props[Index];
+			if (Prop.Activity == EPropActivity::Active || !Prop.Component.IsValid()) { continue; }
+			if (FVector::DistSquared(Prop.Component->GetComponentLocation(), HandLocation) > FMath::Square(HandWakeRadius)) { continue; }
+			WakeProp(Prop);
+			NumWakes++;
+		}
+	}
+
+	// Walk each cone in cell sized steps, checking a sphere around the axis that covers the cone's width there
+	float ConeCos = FMath::Cos(FMath::DegreesToRadians(FlickConeHalfAngle));
+	float ConeTan = FMath::Tan(FMath::DegreesToRadians(FlickConeHalfAngle));
+	for (const FFlickCone& Cone : FlickCones)
+	{
+		for (float Distance = CellSize * 0.5f; Distance < FlickConeLength + CellSize; Distance += CellSize)
+		{
+			QuerySphere(Cone.Origin + Cone.Direction * Distance, Distance * ConeTan + CellSize);
+			for (int32 Index : QueryResults)
+			{
+				FPhysicsProp& Prop = Props[Index];
+				if (Prop.Activity == EPropActivity::Active || !Prop.Component.IsValid()) { continue; }
+				FVector ToProp = Prop.Component->GetComponentLocation() - Cone.Origin;
+				float PropDistance = ToProp.Size();
+				if (PropDistance > FlickConeLength || FVector::DotProduct(ToProp, Cone.Direction) < PropDistance * ConeCos) { continue; }
+				WakeProp(Prop);
+				NumWakes++;
+			}
+		}
+	}
+	SET_DWORD_STAT(STAT_PropWakes, NumWakes);
+}
+
+void UPhysicsPropActivitySubsystem::ScoreProp(int32 Index)
+{
+	FPhysicsProp& Prop = Props[Index];
+	UPrimitiveComponent* Component = Prop.Component.Get();
+	if (!Component) { return; }
+	if (PinnedComponents.Contains(Component))
+	{
+		SetActivity(Prop, EPropActivity::Active);
+		return;
+	}
+
+	FVector Location = Component->GetComponentLocation();
+	MoveToCell(Index, GetCell(Location));
+
+	// Contact may have woken something we put to sleep
+	bool bAwake = Component->IsSimulatingPhysics() && Component->RigidBodyIsAwake();
+	if (Prop.Activity == EPropActivity::Asleep && bAwake) { Prop.Activity = EPropActivity::Active; }
+	if (bAwake) { AwakeThisCycle++; }
+
+	float ViewCos = FMath::Cos(FMath::DegreesToRadians(ViewConeHalfAngle));
+	float NearestSquared = BIG_NUMBER;
+	bool bInView = false;
+	for (const FViewer& Viewer : Viewers)
+	{
+		FVector ToProp = Location - Viewer.Location;
+		float DistanceSquared = ToProp.SizeSquared();
+		NearestSquared = FMath::Min(NearestSquared, DistanceSquared);
+		if (DistanceSquared < FMath::Square(ViewDistance) && FVector::DotProduct(ToProp, Viewer.Forward) > FMath::Sqrt(DistanceSquared) * ViewCos) { bInView = true; }
+	}
+	bool bCameIntoView = bInView && !Prop.bInView;
+	Prop.bInView = bInView;
+
+	if (NearestSquared < FMath::Square(InteractionRadius))
+	{
+		// Close enough to be knocked into, it has to be in the simulation but can stay asleep
+		if (Prop.Activity == EPropActivity::Kinematic) { SetActivity(Prop, EPropActivity::Asleep); }
+		return;
+	}
+	if (bInView)
+	{
+		// Over budget even slow movers in view settle, anything faster would visibly freeze
+		bool bOverBudget = AwakeLastCycle > ActiveBodyBudget;
+		if (bOverBudget)
+		{
+			if (Prop.Activity == EPropActivity::Kinematic) { SetActivity(Prop, EPropActivity::Asleep); }
+			if (bAwake && Component->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(BudgetSleepSpeed))
+			{
+				SetActivity(Prop, EPropActivity::Asleep);
+			}
+		}
+		// Anything we froze or put to sleep carries on from where it was as it is seen, the physics engine lets it settle again
+		else if (bCameIntoView || Prop.Activity == EPropActivity::Kinematic) { WakeProp(Prop); }
+		return;
+	}
+
+	// Only settle what has nearly stopped, a prop mid fall or roll would hang in the air or on a slope
+	if (Prop.Activity == EPropActivity::Active)
+	{
+		if (!bAwake || IsSettling(Component)) { SetActivity(Prop, EPropActivity::Asleep); }
+	}
+	else if (Prop.Activity == EPropActivity::Asleep && !bAwake && NearestSquared > FMath::Square(KinematicDistance))
+	{
+		SetActivity(Prop, EPropActivity::Kinematic);
+	}
+}
+
+bool UPhysicsPropActivitySubsystem::IsSettling(const UPrimitiveComponent* Component) const
+{
+	return Component->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(SleepLinearSpeed)
+		&& Component->GetPhysicsAngularVelocityInDegrees().SizeSquared() < FMath::Square(SleepAngularSpeed);
+}
+
+void UPhysicsPropActivitySubsystem::SetActivity(FPhysicsProp& Prop, EPropActivity Activity)
+{
+	if (Prop.Activity == Activity) { return; }
+	UPrimitiveComponent* Component = Prop.Component.Get();
+	if (!Component) { return; }
+
+	if (Prop.Activity == EPropActivity::Kinematic) { NumKinematic--; }
+	if (Activity == EPropActivity::Kinematic) { NumKinematic++; }
+	Prop.Activity = Activity;
+
+	switch (Activity)
+	{
+	case EPropActivity::Active:
+		if (!Component->IsSimulatingPhysics()) { Component->SetSimulatePhysics(true); }
+		Component->WakeRigidBody();
+		break;
+	case EPropActivity::Asleep:
+		if (!Component->IsSimulatingPhysics()) { Component->SetSimulatePhysics(true); }
+		Component->PutRigidBodyToSleep();
+		break;
+	case EPropActivity::Kinematic:
+		Component->SetSimulatePhysics(false);
+		break;
+	}
+}
+
+void UPhysicsPropActivitySubsystem::WakeProp(FPhysicsProp& Prop)
+{
+	SetActivity(Prop, EPropActivity::Active);
+}
+
+void UPhysicsPropActivitySubsystem::RestoreAll()
+{
+	for (FPhysicsProp& Prop : Props)
+	{
+		if (Prop.Activity == EPropActivity::Kinematic) { SetActivity(Prop, EPropActivity::Asleep); }
+		Prop.Activity = EPropActivity::Active;
+	}
+}
+
+/** Spawns physics cubes around the local player to benchmark the manager: vr.PropStress <Count> <Radius> */
+static void SpawnPropStress(const TArray<FString>& Args, UWorld* World)
+{
+	UPhysicsPropActivitySubsystem* Activity = World ? World->GetSubsystem<UPhysicsPropActivitySubsystem>() : nullptr;
+	APawn* Pawn = UGameplayStatics::GetPlayerPawn(World, 0);
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!Activity || !Pawn || !Cube) { return; }
+
+	int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 2000;
+	float Radius = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10000;
+	FRandomStream Random(Count);
+	for (int32 i = 0; i < Count; i++)
+	{
+		float Angle = Random.FRand() * 2 * PI;
+		float Distance = FMath::Sqrt(Random.FRand()) * Radius;
+		FVector Location = Pawn->GetActorLocation() + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 200 + Random.FRand() * 300);
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AStaticMeshActor* Prop = World->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator, SpawnParams);
+		if (!Prop) { continue; }
+		UStaticMeshComponent* Mesh = Prop->GetStaticMeshComponent();
+		Mesh->SetMobility(EComponentMobility::Movable);
+		Mesh->SetStaticMesh(Cube);
+		Mesh->SetWorldScale3D(FVector(0.2f));
+		Mesh->SetSimulatePhysics(true);
+		Activity->RegisterProp(Mesh);
+	}
+	UE_LOG(LogTemp, Display, TEXT("Spawned %d physics props within %.0f, compare stat physics with vr.PropActivity 0 and 1"), Count, Radius);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs VRPropStressCommand(
+	TEXT("vr.PropStress"),
+	TEXT("Spawns physics props around the player for benchmarking: vr.PropStress <Count> <Radius>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SpawnPropStress));
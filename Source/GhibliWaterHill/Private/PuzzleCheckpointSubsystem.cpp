@@ -0,0 +1,306 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PuzzleCheckpointSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Async/Async.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Components/PrimitiveComponent.h"
+#include "Door.h"
+#include "KeycardReader.h"
+#include "Keycard.h"
+#include "Lever.h"
+#include "PhysicsPropActivitySubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Checkpoint Capture"), STAT_CheckpointCapture, STATGROUP_VRInteraction);
+DECLARE_CYCLE_STAT(TEXT("Checkpoint Restore"), STAT_CheckpointRestore, STATGROUP_VRInteraction);
+
+namespace
+{
+	const uint32 CheckpointMagic = 0x50435256; // "VRCP"
+	const uint32 CheckpointVersion = 1;
+
+	// Everything is plain 32 bit fields so a mapped file can be read in place
+	struct FCheckpointHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumLocks;
+		uint32 NumLevers;
+		uint32 NumBodies;
+	};
+
+	struct FLockRecord
+	{
+		uint32 Id;
+		uint32 bLocked;
+	};
+
+	struct FLeverRecord
+	{
+		uint32 Id;
+		float RodScale;
+	};
+
+	enum EBodyFlags : uint32
+	{
+		BodySimulating = 1 << 0,
+		BodyAwake = 1 << 1
+	};
+
+	struct FBodyRecord
+	{
+		uint32 Id;
+		uint32 Flags;
+		float Location[3];
+		float Rotation[4];
+		float LinearVelocity[3];
+		float AngularVelocity[3];
+	};
+
+	static_assert(sizeof(FCheckpointHeader) == 20 && sizeof(FLockRecord) == 8 && sizeof(FLeverRecord) == 8 && sizeof(FBodyRecord) == 60,
+		"Checkpoint records are written as raw memory, bump CheckpointVersion if they change");
+
+	// Stable between runs of the same map, PIE or not
+	uint32 GetCheckpointId(const UObject* Object)
+	{
+		return FCrc::StrCrc32(*UWorld::RemovePIEPrefix(Object->GetPathName()));
+	}
+
+	template<typename T>
+	void AppendRecords(TArray<uint8>& Buffer, const TArray<T>& Records)
+	{
+		Buffer.Append(reinterpret_cast<const uint8*>(Records.GetData()), Records.Num() * sizeof(T));
+	}
+
+	void StoreVector(float* Out, const FVector& Vector) { Out[0] = Vector.X; Out[1] = Vector.Y; Out[2] = Vector.Z; }
+	FVector LoadVector(const float* In) { return FVector(In[0], In[1], In[2]); }
+}
+
+bool UPuzzleCheckpointSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UPuzzleCheckpointSubsystem::Deinitialize()
+{
+	WaitForPendingWrite();
+	Super::Deinitialize();
+}
+
+FString UPuzzleCheckpointSubsystem::GetCheckpointPath(const FString& Name)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Checkpoints") / (Name + TEXT(".vrcp"));
+}
+
+void UPuzzleCheckpointSubsystem::WaitForPendingWrite()
+{
+	if (PendingWrite.IsValid()) { PendingWrite.Wait(); }
+	PendingWrite = TFuture<bool>();
+	PendingWritePath.Empty();
+}
+
+TMap<uint32, UObject*> UPuzzleCheckpointSubsystem::GatherCheckpointObjects() const
+{
+	TMap<uint32, UObject*> Objects;
+	auto Add = [&Objects](UObject* Object)
+	{
+		uint32 Id = GetCheckpointId(Object);
+		UObject*& Existing = Objects.FindOrAdd(Id);
+		if (Existing && Existing != Object) { UE_LOG(LogTemp, Warning, TEXT("Checkpoint id clash between %s and %s"), *Existing->GetPathName(), *Object->GetPathName()); }
+		Existing = Object;
+	};
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		AActor* Actor = *It;
+		if (Actor->IsA<ADoor>() || Actor->IsA<AKeycardReader>() || Actor->IsA<ALever>()) { Add(Actor); }
+		// Door leaves and cards swing or fall under physics, the lever rod is covered by its lever
+		if (Actor->IsA<ADoor>() || Actor->IsA<AKeycard>())
+		{
+			TArray<UPrimitiveComponent*> Components;
+			Actor->GetComponents<UPrimitiveComponent>(Components);
+			for (UPrimitiveComponent* Component : Components)
+			{
+				if (Component->IsSimulatingPhysics()) { Add(Component); }
+			}
+		}
+	}
+	if (UPhysicsPropActivitySubsystem* Props = GetWorld()->GetSubsystem<UPhysicsPropActivitySubsystem>())
+	{
+		TArray<UPrimitiveComponent*> Components;
+		Props->GetPropComponents(Components);
+		for (UPrimitiveComponent* Component : Components) { Add(Component); }
+	}
+	return Objects;
+}
+
+void UPuzzleCheckpointSubsystem::SaveCheckpoint(const FString& Name)
+{
+	TArray<FLockRecord> Locks;
+	TArray<FLeverRecord> Levers;
+	TArray<FBodyRecord> Bodies;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CheckpointCapture);
+		for (const TPair<uint32, UObject*>& Object : GatherCheckpointObjects())
+		{
+			if (ADoor* Door = Cast<ADoor>(Object.Value)) { Locks.Add({ Object.Key, Door->bIsLocked() }); }
+			else if (AKeycardReader* Reader = Cast<AKeycardReader>(Object.Value)) { Locks.Add({ Object.Key, Reader->bIsDoorLocked() }); }
+			else if (ALever* Lever = Cast<ALever>(Object.Value)) { Levers.Add({ Object.Key, Lever->GetSignedRodScale() }); }
+			else if (UPrimitiveComponent* Component = Cast<UPrimitiveComponent>(Object.Value))
+			{
+				FBodyRecord& Body = Bodies.AddZeroed_GetRef();
+				Body.Id = Object.Key;
+				bool bSimulating = Component->IsSimulatingPhysics();
+				Body.Flags = (bSimulating ? BodySimulating : 0) | (bSimulating && Component->RigidBodyIsAwake() ? BodyAwake : 0);
+				const FTransform& Transform = Component->GetComponentTransform();
+				StoreVector(Body.Location, Transform.GetLocation());
+				FQuat Rotation = Transform.GetRotation();
+				Body.Rotation[0] = Rotation.X; Body.Rotation[1] = Rotation.Y; Body.Rotation[2] = Rotation.Z; Body.Rotation[3] = Rotation.W;
+				if (bSimulating)
+				{
+					StoreVector(Body.LinearVelocity, Component->GetPhysicsLinearVelocity());
+					StoreVector(Body.AngularVelocity, Component->GetPhysicsAngularVelocityInDegrees());
+				}
+			}
+		}
+	}
+
+	// Serialising and writing happen off the game thread, only the capture above costs a frame
+	WaitForPendingWrite();
+	FString Path = GetCheckpointPath(Name);
+	PendingWritePath = Path;
+	PendingWrite = Async(EAsyncExecution::ThreadPool, [Path, Locks = MoveTemp(Locks), Levers = MoveTemp(Levers), Bodies = MoveTemp(Bodies)]()
+	{
+		FCheckpointHeader Header = { CheckpointMagic, CheckpointVersion, (uint32)Locks.Num(), (uint32)Levers.Num(), (uint32)Bodies.Num() };
+		TArray<uint8> Buffer;
+		Buffer.Reserve(sizeof(Header) + Locks.Num() * sizeof(FLockRecord) + Levers.Num() * sizeof(FLeverRecord) + Bodies.Num() * sizeof(FBodyRecord));
+		Buffer.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+		AppendRecords(Buffer, Locks);
+		AppendRecords(Buffer, Levers);
+		AppendRecords(Buffer, Bodies);
+
+		// Written next to it and moved over, so a crash mid write never leaves half a checkpoint
+		FString TempPath = Path + TEXT(".tmp");
+		bool bSaved = FFileHelper::SaveArrayToFile(Buffer, *TempPath) && IFileManager::Get().Move(*Path, *TempPath, true);
+		UE_LOG(LogTemp, Log, TEXT("Checkpoint %s: %d locks, %d levers, %d bodies, %d bytes%s"),
+			*Path, Locks.Num(), Levers.Num(), Bodies.Num(), Buffer.Num(), bSaved ? TEXT("") : TEXT(" FAILED TO WRITE"));
+		return bSaved;
+	});
+}
+
+bool UPuzzleCheckpointSubsystem::LoadCheckpoint(const FString& Name)
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Checkpoints can only be restored on the server"));
+		return false;
+	}
+	FString Path = GetCheckpointPath(Name);
+	if (PendingWritePath == Path) { WaitForPendingWrite(); }
+
+	// Mapped rather than read, so nothing is copied before it is applied
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Path));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+	TArray<uint8> FallbackBuffer;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+	if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(FallbackBuffer, *Path, FILEREAD_Silent))
+	{
+		Data = FallbackBuffer.GetData();
+		Size = FallbackBuffer.Num();
+	}
+
+	const FCheckpointHeader* Header = reinterpret_cast<const FCheckpointHeader*>(Data);
+	if (!Data || Size < (int64)sizeof(FCheckpointHeader) || Header->Magic != CheckpointMagic || Header->Version != CheckpointVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No usable checkpoint at %s"), *Path);
+		return false;
+	}
+	int64 ExpectedSize = sizeof(FCheckpointHeader) + (int64)Header->NumLocks * sizeof(FLockRecord)
+		+ (int64)Header->NumLevers * sizeof(FLeverRecord) + (int64)Header->NumBodies * sizeof(FBodyRecord);
+	if (!ensure(Size == ExpectedSize)) { return false; }
+
+	SCOPE_CYCLE_COUNTER(STAT_CheckpointRestore);
+	double StartTime = FPlatformTime::Seconds();
+	TMap<uint32, UObject*> Objects = GatherCheckpointObjects();
+	int32 NumMissing = 0;
+
+	const FLockRecord* Locks = reinterpret_cast<const FLockRecord*>(Header + 1);
+	for (uint32 i = 0; i < Header->NumLocks; i++)
+	{
+		UObject** Object = Objects.Find(Locks[i].Id);
+		if (ADoor* Door = Object ? Cast<ADoor>(*Object) : nullptr) { Door->SetLockedState(Locks[i].bLocked != 0); }
+		else if (AKeycardReader* Reader = Object ? Cast<AKeycardReader>(*Object) : nullptr) { Reader->RestoreLocked(Locks[i].bLocked != 0); }
+		else { NumMissing++; }
+	}
+
+	const FLeverRecord* Levers = reinterpret_cast<const FLeverRecord*>(Locks + Header->NumLocks);
+	for (uint32 i = 0; i < Header->NumLevers; i++)
+	{
+		UObject** Object = Objects.Find(Levers[i].Id);
+		if (ALever* Lever = Object ? Cast<ALever>(*Object) : nullptr) { Lever->RestoreRodScale(Levers[i].RodScale); }
+		else { NumMissing++; }
+	}
+
+	const FBodyRecord* Bodies = reinterpret_cast<const FBodyRecord*>(Levers + Header->NumLevers);
+	for (uint32 i = 0; i < Header->NumBodies; i++)
+	{
+		const FBodyRecord& Body = Bodies[i];
+		UObject** Object = Objects.Find(Body.Id);
+		UPrimitiveComponent* Component = Object ? Cast<UPrimitiveComponent>(*Object) : nullptr;
+		if (!Component) { NumMissing++; continue; }
+
+		FQuat Rotation(Body.Rotation[0], Body.Rotation[1], Body.Rotation[2], Body.Rotation[3]);
+		Component->SetWorldLocationAndRotation(LoadVector(Body.Location), Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		if (!Component->IsSimulatingPhysics()) { continue; }
+		Component->SetPhysicsLinearVelocity(LoadVector(Body.LinearVelocity));
+		Component->SetPhysicsAngularVelocityInDegrees(LoadVector(Body.AngularVelocity));
+		if (Body.Flags & BodyAwake) { Component->WakeRigidBody(); }
+		else { Component->PutRigidBodyToSleep(); }
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Restored checkpoint %s in %.2f ms (%d records had nothing to apply to)"), *Path, (FPlatformTime::Seconds() - StartTime) * 1000, NumMissing);
+	return true;
+}
+
+static void SaveCheckpointCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (UPuzzleCheckpointSubsystem* Checkpoints = World ? World->GetSubsystem<UPuzzleCheckpointSubsystem>() : nullptr)
+	{
+		Checkpoints->SaveCheckpoint(Args.Num() > 0 ? Args[0] : TEXT("Quick"));
+	}
+}
+
+static void LoadCheckpointCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (UPuzzleCheckpointSubsystem* Checkpoints = World ? World->GetSubsystem<UPuzzleCheckpointSubsystem>() : nullptr)
+	{
+		Checkpoints->LoadCheckpoint(Args.Num() > 0 ? Args[0] : TEXT("Quick"));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs VRSaveCheckpointCommand(
+	TEXT("vr.SaveCheckpoint"),
+	TEXT("Saves the puzzle and prop state: vr.SaveCheckpoint [Name]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SaveCheckpointCommand));
+
+static FAutoConsoleCommandWithWorldAndArgs VRLoadCheckpointCommand(
+	TEXT("vr.LoadCheckpoint"),
+	TEXT("Restores puzzle and prop state saved with vr.SaveCheckpoint, on the server: vr.LoadCheckpoint [Name]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LoadCheckpointCommand));
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PuzzleNetRelevancy.h"
+#include "GameFramework/Actor.h"
+#include "Engine/Level.h"
+#include "Engine/LevelBounds.h"
+
+namespace
+{
+	const float PuzzleNetCullDistance = 8000;
+	// So players standing in a doorway still see both sides
+	const float RoomBoundsMargin = 500;
+
+	// CalculateLevelBounds goes through every actor in the level, so it's done once per room rather than per puzzle actor
+	TMap<TWeakObjectPtr<ULevel>, FBox> RoomBoundsCache;
+
+	FBox GetRoomBounds(ULevel* Level)
+	{
+		if (const FBox* Cached = RoomBoundsCache.Find(Level)) { return *Cached; }
+		// Rooms that have streamed out since, so the cache stays as small as what's loaded
+		for (auto It = RoomBoundsCache.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().IsValid()) { It.RemoveCurrent(); }
+		}
+		return RoomBoundsCache.Add(Level, ALevelBounds::CalculateLevelBounds(Level).ExpandBy(RoomBoundsMargin));
+	}
+}
+
+void FPuzzleNetRelevancy::ConfigureDormantReplication(AActor* Actor)
+{
+	Actor->SetReplicates(true);
+	Actor->NetDormancy = DORM_Initial;
+	Actor->NetCullDistanceSquared = FMath::Square(PuzzleNetCullDistance);
+}
+
+void FPuzzleNetRelevancy::Init(const AActor* Actor)
+{
+	ULevel* Level = Actor->GetLevel();
+	if (!Level || Level->IsPersistentLevel()) { return; }
+	check(IsInGameThread());
+	RoomBounds = GetRoomBounds(Level);
+}
+
+bool FPuzzleNetRelevancy::IsRelevantFor(const FVector& SrcLocation) const
+{
+	return !RoomBounds.IsValid || RoomBounds.IsInsideOrOn(SrcLocation);
+}
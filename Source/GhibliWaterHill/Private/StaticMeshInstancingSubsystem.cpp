@@ -0,0 +1,249 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StaticMeshInstancingSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/MapBuildDataRegistry.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Auto Instanced Components"), STAT_AutoInstancedComponents, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Auto Instancing Components"), STAT_AutoInstancingComponents, STATGROUP_VRInteraction);
+DECLARE_MEMORY_STAT(TEXT("Auto Instancing Memory Saved"), STAT_AutoInstancingMemorySaved, STATGROUP_VRInteraction);
+
+static int32 GVRAutoInstance = 1;
+static FAutoConsoleVariableRef CVarVRAutoInstance(
+	TEXT("vr.AutoInstance"),
+	GVRAutoInstance,
+	TEXT("1 to merge repeated static mesh actors into instanced components as levels are added, 0 to leave them (only affects levels added afterwards)"));
+
+namespace
+{
+	// Everything that has to match for two meshes to be drawn and collide as instances of one component
+	struct FInstanceGroupKey
+	{
+		FIntVector Cell;
+		UStaticMesh* Mesh;
+		TArray<UMaterialInterface*, TInlineAllocator<4>> Materials;
+		FName CollisionProfile;
+		ECollisionEnabled::Type CollisionEnabled;
+		ECollisionChannel ObjectType;
+		FCollisionResponseContainer Responses;
+		float MaxDrawDistance;
+		bool bCastShadow;
+		bool bReceivesDecals;
+		bool bAffectsNavigation;
+
+		bool operator==(const FInstanceGroupKey& Other) const
+		{
+			return Cell == Other.Cell && Mesh == Other.Mesh && Materials == Other.Materials
+				&& CollisionProfile == Other.CollisionProfile && CollisionEnabled == Other.CollisionEnabled
+				&& ObjectType == Other.ObjectType && Responses == Other.Responses
+				&& MaxDrawDistance == Other.MaxDrawDistance && bCastShadow == Other.bCastShadow
+				&& bReceivesDecals == Other.bReceivesDecals && bAffectsNavigation == Other.bAffectsNavigation;
+		}
+
+		friend uint32 GetTypeHash(const FInstanceGroupKey& Key)
+		{
+			uint32 Hash = HashCombine(GetTypeHash(Key.Cell), GetTypeHash(Key.Mesh));
+			for (UMaterialInterface* Material : Key.Materials) { Hash = HashCombine(Hash, GetTypeHash(Material)); }
+			return HashCombine(Hash, GetTypeHash(Key.CollisionProfile));
+		}
+	};
+
+	struct FInstanceGroup
+	{
+		TArray<AStaticMeshActor*> Actors;
+	};
+
+	// What the actor and its components cost to keep around, not counting shared assets
+	int64 GetActorBytes(AActor* Actor)
+	{
+		int64 Bytes = Actor->GetClass()->GetStructureSize();
+		for (UActorComponent* Component : Actor->GetComponents())
+		{
+			if (Component) { Bytes += Component->GetClass()->GetStructureSize() + Component->GetResourceSizeBytes(EResourceSizeMode::Exclusive); }
+		}
+		return Bytes;
+	}
+}
+
+bool UStaticMeshInstancingSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UStaticMeshInstancingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	ActorsInitializedHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UStaticMeshInstancingSubsystem::OnActorsInitialized);
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UStaticMeshInstancingSubsystem::OnLevelAdded);
+}
+
+void UStaticMeshInstancingSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(ActorsInitializedHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	ProcessedLevels.Empty();
+	Super::Deinitialize();
+}
+
+void UStaticMeshInstancingSubsystem::OnActorsInitialized(const UWorld::FActorsInitializedParams& Params)
+{
+	if (Params.World != GetWorld()) { return; }
+	for (ULevel* Level : GetWorld()->GetLevels())
+	{
+		if (Level && Level->bIsVisible) { InstanceLevel(Level); }
+	}
+	LogReport();
+}
+
+void UStaticMeshInstancingSubsystem::OnLevelAdded(ULevel* Level, UWorld* World)
+{
+	// Levels added during the map load are done together once the actors are initialised
+	if (World != GetWorld() || !World->AreActorsInitialized()) { return; }
+	InstanceLevel(Level);
+}
+
+bool UStaticMeshInstancingSubsystem::bCanInstance(const AStaticMeshActor* Actor) const
+{
+	// Blueprint subclasses have their own logic, anything replicated has to keep its identity
+	if (!Actor || Actor->GetClass() != AStaticMeshActor::StaticClass() || Actor->IsPendingKill()) { return false; }
+	if (Actor->GetIsReplicated() || Actor->ActorHasTag(KeepTag) || Actor->GetComponents().Num() != 1) { return false; }
+
+	const UStaticMeshComponent* Component = Actor->GetStaticMeshComponent();
+	if (!Component || !Component->GetStaticMesh() || Component->Mobility != EComponentMobility::Static) { return false; }
+	if (Component->BodyInstance.bSimulatePhysics || Component->BodyInstance.bNotifyRigidBodyCollision || Component->GetGenerateOverlapEvents()) { return false; }
+	if (Component->GetAttachChildren().Num() > 0 || !Component->IsVisible()) { return false; }
+
+	// Instances can't keep per component lightmaps or painted vertex colours
+	if (Component->LODData.Num() > 0)
+	{
+		const FStaticMeshComponentLODInfo& LODInfo = Component->LODData[0];
+		const FMeshMapBuildData* BuildData = Component->GetMeshMapBuildData(LODInfo);
+		if (BuildData && (BuildData->LightMap || BuildData->ShadowMap)) { return false; }
+		if (LODInfo.OverrideVertexColors) { return false; }
+	}
+	return true;
+}
+
+void UStaticMeshInstancingSubsystem::InstanceLevel(ULevel* Level)
+{
+	if (!Level || GVRAutoInstance == 0 || ProcessedLevels.Contains(Level)) { return; }
+	ProcessedLevels.Add(Level);
+	double StartTime = FPlatformTime::Seconds();
+
+	TMap<FInstanceGroupKey, FInstanceGroup> Groups;
+	for (AActor* Actor : Level->Actors)
+	{
+		AStaticMeshActor* MeshActor = Cast<AStaticMeshActor>(Actor);
+		if (!bCanInstance(MeshActor)) { continue; }
+
+		UStaticMeshComponent* Component = MeshActor->GetStaticMeshComponent();
+		FVector Location = Component->GetComponentLocation();
+		FInstanceGroupKey Key;
+		Key.Cell = FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+		Key.Mesh = Component->GetStaticMesh();
+		for (int32 i = 0; i < Component->GetNumMaterials(); i++) { Key.Materials.Add(Component->GetMaterial(i)); }
+		Key.CollisionProfile = Component->GetCollisionProfileName();
+		Key.CollisionEnabled = Component->GetCollisionEnabled();
+		Key.ObjectType = Component->GetCollisionObjectType();
+		Key.Responses = Component->GetCollisionResponseToChannels();
+		Key.MaxDrawDistance = Component->LDMaxDrawDistance;
+		Key.bCastShadow = Component->CastShadow;
+		Key.bReceivesDecals = Component->bReceivesDecals;
+		Key.bAffectsNavigation = Component->CanEverAffectNavigation();
+		Groups.FindOrAdd(Key).Actors.Add(MeshActor);
+	}
+
+	AActor* Host = nullptr;
+	int32 NumMerged = 0;
+	int32 NumInstanced = 0;
+	int64 BytesSaved = 0;
+	for (TPair<FInstanceGroupKey, FInstanceGroup>& Group : Groups)
+	{
+		TArray<AStaticMeshActor*>& Actors = Group.Value.Actors;
+		if (Actors.Num() < MinInstances) { continue; }
+
+		if (!Host)
+		{
+			// Spawned into the level so it streams out with the rooms it replaced
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.OverrideLevel = Level;
+			SpawnParams.ObjectFlags |= RF_Transient;
+			Host = GetWorld()->SpawnActor<AActor>(SpawnParams);
+			if (!ensure(Host)) { return; }
+			USceneComponent* Root = NewObject<USceneComponent>(Host, TEXT("Root"));
+			Root->SetMobility(EComponentMobility::Static);
+			Host->SetRootComponent(Root);
+			Root->RegisterComponent();
+			BytesSaved -= GetActorBytes(Host);
+		}
+
+		const FInstanceGroupKey& Key = Group.Key;
+		UStaticMeshComponent* Source = Actors[0]->GetStaticMeshComponent();
+		UHierarchicalInstancedStaticMeshComponent* Instanced = NewObject<UHierarchicalInstancedStaticMeshComponent>(Host);
+		Instanced->SetMobility(EComponentMobility::Static);
+		Instanced->SetupAttachment(Host->GetRootComponent());
+		Instanced->SetStaticMesh(Key.Mesh);
+		for (int32 i = 0; i < Key.Materials.Num(); i++) { Instanced->SetMaterial(i, Key.Materials[i]); }
+		Instanced->BodyInstance.CopyBodyInstancePropertiesFrom(&Source->BodyInstance);
+		Instanced->SetCanEverAffectNavigation(Key.bAffectsNavigation);
+		Instanced->CastShadow = Key.bCastShadow;
+		Instanced->bReceivesDecals = Key.bReceivesDecals;
+		Instanced->InstanceEndCullDistance = FMath::TruncToInt(Key.MaxDrawDistance);
+		Instanced->bAutoRebuildTreeOnInstanceChanges = false;
+
+		// The host sits at the origin, so world transforms are instance transforms
+		for (AStaticMeshActor* Actor : Actors)
+		{
+			Instanced->AddInstance(Actor->GetStaticMeshComponent()->GetComponentTransform());
+			BytesSaved += GetActorBytes(Actor);
+			Actor->Destroy();
+		}
+		Instanced->BuildTreeIfOutdated(false, true);
+		Instanced->RegisterComponent();
+		Host->AddInstanceComponent(Instanced);
+		BytesSaved -= Instanced->GetClass()->GetStructureSize() + Instanced->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+		NumMerged += Actors.Num();
+		NumInstanced++;
+	}
+	if (NumInstanced == 0) { return; }
+
+	double Seconds = FPlatformTime::Seconds() - StartTime;
+	TotalMergedComponents += NumMerged;
+	TotalInstancedComponents += NumInstanced;
+	TotalBytesSaved += BytesSaved;
+	TotalSeconds += Seconds;
+	SET_DWORD_STAT(STAT_AutoInstancedComponents, TotalMergedComponents);
+	SET_DWORD_STAT(STAT_AutoInstancingComponents, TotalInstancedComponents);
+	SET_MEMORY_STAT(STAT_AutoInstancingMemorySaved, TotalBytesSaved);
+	UE_LOG(LogTemp, Log, TEXT("Instanced %d static meshes into %d components in %s (%.1f KB saved, %.2f ms)"),
+		NumMerged, NumInstanced, *Level->GetOuter()->GetName(), BytesSaved / 1024.0, Seconds * 1000);
+}
+
+void UStaticMeshInstancingSubsystem::LogReport() const
+{
+	// Each merged component was a scene primitive with its own bounds, transform and draw, now shared by its group
+	UE_LOG(LogTemp, Display, TEXT("Auto instancing: %d static mesh components merged into %d instanced components across %d levels, %.1f KB saved, %.2f ms spent"),
+		TotalMergedComponents, TotalInstancedComponents, ProcessedLevels.Num(), TotalBytesSaved / 1024.0, TotalSeconds * 1000);
+}
+
+static void LogAutoInstanceReport(UWorld* World)
+{
+	if (UStaticMeshInstancingSubsystem* Instancing = World ? World->GetSubsystem<UStaticMeshInstancingSubsystem>() : nullptr)
+	{
+		Instancing->LogReport();
+	}
+}
+
+static FAutoConsoleCommandWithWorld VRAutoInstanceReportCommand(
+	TEXT("vr.AutoInstanceReport"),
+	TEXT("Logs how many static mesh components were merged into instanced components and what it saved"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&LogAutoInstanceReport));
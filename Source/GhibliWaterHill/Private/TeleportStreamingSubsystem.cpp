@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TeleportStreamingSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/World.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/LevelStreamingVolume.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Teleport Streaming Update"), STAT_TeleportStreamingUpdate, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Streamed Rooms Wanted"), STAT_StreamedRoomsWanted, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Teleport Streaming Flushes"), STAT_TeleportStreamingFlushes, STATGROUP_VRInteraction);
+
+namespace
+{
+	// Aiming moves the destination a little every frame, no need to track each position separately
+	const float PrefetchTargetMergeDistance = 200;
+}
+
+bool UTeleportStreamingSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UTeleportStreamingSubsystem::Deinitialize()
+{
+	ManagedLevels.Empty();
+	PrefetchTargets.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UTeleportStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTeleportStreamingSubsystem, STATGROUP_Tickables);
+}
+
+void UTeleportStreamingSubsystem::GatherManagedLevels()
+{
+	bGathered = true;
+	for (ULevelStreaming* Level : GetWorld()->GetStreamingLevels())
+	{
+		if (!Level || Level->EditorStreamingVolumes.Num() == 0) { continue; }
+
+		FManagedLevel Managed;
+		Managed.Level = Level;
+		for (ALevelStreamingVolume* Volume : Level->EditorStreamingVolumes)
+		{
+			if (Volume && !Volume->bDisabled) { Managed.Volumes.Add(Volume); }
+		}
+		if (Managed.Volumes.Num() == 0) { continue; }
+		// The engine would only look at the current view, from here on we decide when these load
+		Level->bDisableDistanceStreaming = true;
+		ManagedLevels.Add(Managed);
+	}
+}
+
+void UTeleportStreamingSubsystem::PrefetchAround(const FVector& Location)
+{
+	float Now = GetWorld()->GetTimeSeconds();
+	for (FPrefetchTarget& Target : PrefetchTargets)
+	{
+		if (FVector::DistSquared(Target.Location, Location) < FMath::Square(PrefetchTargetMergeDistance))
+		{
+			Target.Location = Location;
+			Target.Time = Now;
+			return;
+		}
+	}
+	PrefetchTargets.Add({ Location, Now });
+}
+
+bool UTeleportStreamingSubsystem::bLevelNear(const FManagedLevel& Managed, const FVector& Location, float Radius) const
+{
+	for (const TWeakObjectPtr<ALevelStreamingVolume>& Volume : Managed.Volumes)
+	{
+		if (Volume.IsValid() && Volume->EncompassesPoint(Location, Radius)) { return true; }
+	}
+	return false;
+}
+
+void UTeleportStreamingSubsystem::SetLevelWanted(FManagedLevel& Managed, bool bWanted, float Now)
+{
+	ULevelStreaming* Level = Managed.Level.Get();
+	if (!Level) { return; }
+	if (bWanted) { Managed.LastWantedTime = Now; }
+	else if (Now - Managed.LastWantedTime < UnloadDelay) { return; }
+
+	if (Level->ShouldBeLoaded() != bWanted) { Level->SetShouldBeLoaded(bWanted); }
+	if (Level->ShouldBeVisible() != bWanted) { Level->SetShouldBeVisible(bWanted); }
+}
+
+void UTeleportStreamingSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TeleportStreamingUpdate);
+	if (!bGathered) { GatherManagedLevels(); }
+
+	float Now = GetWorld()->GetTimeSeconds();
+	PrefetchTargets.RemoveAllSwap([this, Now](const FPrefetchTarget& Target) { return Now - Target.Time > PrefetchHoldTime; });
+
+	// Every player on the server, only the local ones on clients
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (!PlayerController) { continue; }
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		ViewLocations.Add(ViewLocation);
+	}
+
+	int32 NumWanted = 0;
+	for (FManagedLevel& Managed : ManagedLevels)
+	{
+		bool bWanted = false;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			if (bLevelNear(Managed, ViewLocation, 0)) { bWanted = true; break; }
+		}
+		for (int32 i = 0; i < PrefetchTargets.Num() && !bWanted; i++)
+		{
+			bWanted = bLevelNear(Managed, PrefetchTargets[i].Location, PrefetchRadius);
+		}
+		SetLevelWanted(Managed, bWanted, Now);
+		if (bWanted) { NumWanted++; }
+	}
+	SET_DWORD_STAT(STAT_StreamedRoomsWanted, NumWanted);
+}
+
+bool UTeleportStreamingSubsystem::IsReadyAt(const FVector& Location) const
+{
+	for (const FManagedLevel& Managed : ManagedLevels)
+	{
+		if (!Managed.Level.IsValid() || !bLevelNear(Managed, Location, PrefetchRadius)) { continue; }
+		if (!Managed.Level->IsLevelVisible()) { return false; }
+	}
+	return true;
+}
+
+void UTeleportStreamingSubsystem::FlushAt(const FVector& Location)
+{
+	float Now = GetWorld()->GetTimeSeconds();
+	for (FManagedLevel& Managed : ManagedLevels)
+	{
+		if (bLevelNear(Managed, Location, PrefetchRadius)) { SetLevelWanted(Managed, true, Now); }
+	}
+	INC_DWORD_STAT(STAT_TeleportStreamingFlushes);
+	UE_LOG(LogTemp, Warning, TEXT("Rooms at teleport destination %s were not streamed in by the end of the fade, blocking"), *Location.ToString());
+	GetWorld()->BlockTillLevelStreamingCompleted();
+}
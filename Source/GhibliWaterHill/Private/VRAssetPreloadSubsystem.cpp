@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRAssetPreloadSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "UObject/UnrealType.h"
+
+namespace
+{
+	bool bLoggedFirstInteractiveFrame = false;
+}
+
+bool UVRAssetPreloadSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UVRAssetPreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	MapLoadStartTime = FPlatformTime::Seconds();
+
+	// The classes are needed first to find what their defaults reference
+	TArray<FSoftObjectPath> ClassPaths;
+	for (const TSoftClassPtr<UObject>& Class : PreloadClasses)
+	{
+		if (!Class.IsNull()) { ClassPaths.Add(Class.ToSoftObjectPath()); }
+	}
+	if (ClassPaths.Num() == 0 || !UAssetManager::IsValid())
+	{
+		OnAssetsLoaded();
+		return;
+	}
+	ClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassPaths, FStreamableDelegate::CreateUObject(this, &UVRAssetPreloadSubsystem::OnClassesLoaded));
+}
+
+void UVRAssetPreloadSubsystem::Deinitialize()
+{
+	if (ClassHandle.IsValid() && ClassHandle->IsLoadingInProgress()) { ClassHandle->CancelHandle(); }
+	if (AssetHandle.IsValid() && AssetHandle->IsLoadingInProgress()) { AssetHandle->CancelHandle(); }
+	ClassHandle.Reset();
+	AssetHandle.Reset();
+	PendingCallbacks.Empty();
+	Super::Deinitialize();
+}
+
+void UVRAssetPreloadSubsystem::OnClassesLoaded()
+{
+	TArray<FSoftObjectPath> AssetPaths;
+	for (const TSoftClassPtr<UObject>& Class : PreloadClasses)
+	{
+		UClass* LoadedClass = Class.Get();
+		if (!LoadedClass) { continue; }
+		UObject* Defaults = LoadedClass->GetDefaultObject();
+		for (TFieldIterator<USoftObjectProperty> It(LoadedClass); It; ++It)
+		{
+			FSoftObjectPath Path = It->GetPropertyValue_InContainer(Defaults).ToSoftObjectPath();
+			if (Path.IsValid()) { AssetPaths.AddUnique(Path); }
+		}
+	}
+	if (AssetPaths.Num() == 0)
+	{
+		OnAssetsLoaded();
+		return;
+	}
+	AssetHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetPaths, FStreamableDelegate::CreateUObject(this, &UVRAssetPreloadSubsystem::OnAssetsLoaded));
+}
+
+void UVRAssetPreloadSubsystem::OnAssetsLoaded()
+{
+	bPreloaded = true;
+	int32 NumAssets = 0, NumRequested = 0;
+	if (AssetHandle.IsValid()) { AssetHandle->GetLoadedCount(NumAssets, NumRequested); }
+	UE_LOG(LogTemp, Log, TEXT("Preloaded %d player assets in %.2f ms"), NumAssets, (FPlatformTime::Seconds() - MapLoadStartTime) * 1000);
+
+	TArray<FSimpleDelegate> Callbacks = MoveTemp(PendingCallbacks);
+	for (FSimpleDelegate& Callback : Callbacks) { Callback.ExecuteIfBound(); }
+}
+
+void UVRAssetPreloadSubsystem::CallWhenPreloaded(FSimpleDelegate Callback)
+{
+	if (bPreloaded) { Callback.ExecuteIfBound(); }
+	else { PendingCallbacks.Add(Callback); }
+}
+
+void UVRAssetPreloadSubsystem::NotifyFirstInteractiveFrame()
+{
+	if (bLoggedFirstInteractiveFrame) { return; }
+	bLoggedFirstInteractiveFrame = true;
+	double Now = FPlatformTime::Seconds();
+	UE_LOG(LogTemp, Display, TEXT("First interactive frame: %.2f s after start, %.2f s after map load (assets %s)"),
+		Now - GStartTime,
+		Now - MapLoadStartTime,
+		bPreloaded ? TEXT("preloaded") : TEXT("still loading"));
+}
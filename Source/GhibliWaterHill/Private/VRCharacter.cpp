@@ -15,7 +15,20 @@
 #include "InputCoreTypes.h"
 #include "Runtime/CoreUObject/Public/UObject/UObjectGlobals.h"
 #include "Components/PostProcessComponent.h"
-#include "Materials/MaterialInstanceDynamic.h"
+#include "Materials/MaterialInterface.h"
+#include "Net/UnrealNetwork.h"
+#include "GameFramework/PlayerState.h"
+#include "VRInteractionPoolSubsystem.h"
+#include "VRAssetPreloadSubsystem.h"
+#include "TeleportStreamingSubsystem.h"
+#include "VRInteractionEventSubsystem.h"
+#include "VRTelemetry.h"
+#include "VRMemoryTracking.h"
+
+namespace
+{
+	const float SmoothTurnTunedRate = 90;
+}
 
 // Sets default values
 AVRCharacter::AVRCharacter()
@@ -40,31 +53,100 @@ void AVRCharacter::BeginPlay()
 
 	// so that we aren't in the floor
 	UHeadMountedDisplayFunctionLibrary::SetTrackingOrigin(EHMDTrackingOrigin::Floor);
+
+	// The first pawn usually begins play in the same frame the map loads, before the preload is in. Waiting
+	// for it keeps the asset loads async, and the pool prewarms first as it asked to be called back earlier
+	UVRAssetPreloadSubsystem* Preload = GetWorld()->GetSubsystem<UVRAssetPreloadSubsystem>();
+	if (Preload && !Preload->IsPreloaded())
+	{
+		// Input would otherwise reach hands that aren't there yet
+		DisableInput(nullptr);
+		Preload->CallWhenPreloaded(FSimpleDelegate::CreateUObject(this, &AVRCharacter::BindPreloaded));
+		return;
+	}
+	BindPreloaded();
+}
+
+void AVRCharacter::BindPreloaded()
+{
+	if (IsActorBeingDestroyed()) { return; }
+	EnableInput(nullptr);
 	// we want to spawn the specific class here (BP)
-	LeftController = GetWorld()->SpawnActor<AVRController>(HandControllerClass);
+	LeftController = AcquireHandController(EControllerHand::Left);
 	if (!ensure(LeftController)) { return; }
-	LeftController->AttachToComponent(VRRoot, FAttachmentTransformRules::KeepRelativeTransform);
-	LeftController->SetOwner(this);
-	LeftController->SetHand(EControllerHand::Left);
-
-	RightController = GetWorld()->SpawnActor<AVRController>(HandControllerClass);
+	RightController = AcquireHandController(EControllerHand::Right);
 	if (!ensure(RightController)) { return; }
-	RightController->AttachToComponent(VRRoot, FAttachmentTransformRules::KeepRelativeTransform);
-	RightController->SetOwner(this);
-	RightController->SetHand(EControllerHand::Right);
 
-	SetupPlayerInputComponent(FindComponentByClass<UInputComponent>());
+	// Pawns of other players have no input component
+	if (UInputComponent* Input = FindComponentByClass<UInputComponent>()) { SetupPlayerInputComponent(Input); }
 
-	if (!ensure(HighlightMaterialBase)) { return; };
+	VR_LLM_SCOPE(Highlight);
+	// Resident by now, see UVRAssetPreloadSubsystem
+	UMaterialInterface* HighlightMaterial = UVRAssetPreloadSubsystem::GetResident(HighlightMaterialBase);
+	if (!ensure(HighlightMaterial)) { return; };
 	if (!ensure(PostProcess)) { return; };
-	UMaterialInstanceDynamic* HighlightInstance = UMaterialInstanceDynamic::Create(HighlightMaterialBase, NULL);
-	PostProcess->AddOrUpdateBlendable(HighlightInstance);
+	// Nothing sets parameters on it, so the material itself is the blendable and respawning creates no UObjects
+	PostProcess->AddOrUpdateBlendable(HighlightMaterial);
+}
+
+// Called when the game ends or when destroyed
+void AVRCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ReleaseHandController(LeftController);
+	ReleaseHandController(RightController);
+	LeftController = nullptr;
+	RightController = nullptr;
+	Super::EndPlay(EndPlayReason);
+}
+
+AVRController* AVRCharacter::AcquireHandController(EControllerHand Hand)
+{
+	// Taken from the pool prewarmed at map load, which only spawns if it has run out
+	AVRController* Controller = nullptr;
+	if (UVRInteractionPoolSubsystem* Pool = GetWorld()->GetSubsystem<UVRInteractionPoolSubsystem>())
+	{
+		Controller = Pool->AcquireController(HandControllerClass, this);
+	}
+	else
+	{
+		Controller = GetWorld()->SpawnActor<AVRController>(HandControllerClass);
+	}
+	if (!Controller) { return nullptr; }
+	Controller->AttachToComponent(VRRoot, FAttachmentTransformRules::KeepRelativeTransform);
+	Controller->SetOwner(this);
+	Controller->SetHand(Hand);
+	return Controller;
+}
+
+void AVRCharacter::ReleaseHandController(AVRController* Controller)
+{
+	if (!Controller) { return; }
+	UVRInteractionPoolSubsystem* Pool = GetWorld()->GetSubsystem<UVRInteractionPoolSubsystem>();
+	if (Pool) { Pool->ReleaseController(Controller); }
+	else { Controller->Destroy(); }
 }
 
 // Called every frame
 void AVRCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	// Still waiting on the preload to bind the hands
+	if (!LeftController || !RightController) { return; }
+
+	UpdateLocalTracking();
+	if (!bReportedInteractive && IsLocallyControlled() && LeftController && RightController)
+	{
+		bReportedInteractive = true;
+		if (UVRAssetPreloadSubsystem* Preload = GetWorld()->GetSubsystem<UVRAssetPreloadSubsystem>()) { Preload->NotifyFirstInteractiveFrame(); }
+	}
+	if (IsLocallyControlled())
+	{
+		TickLocomotion(DeltaTime);
+		SendPoses(DeltaTime);
+	}
+	// Simulated proxies get their location from movement replication
+	else if (!HasAuthority()) { return; }
+	else { SendGrabStates(DeltaTime); }
 
 	/*
 	Explanation:
@@ -150,7 +232,7 @@ void AVRCharacter::MoveForward(float Scale)
 	else if (MovementCoupling == EMovementCoupling::Hand)
 	{
 		// Adding both so you need both hands moving in one direction to make a difference.
-		FVector Input = GetTeleportController()->GetActorForwardVector() + GetMovementController()->GetActorForwardVector();
+		FVector Input = GetTeleportController()->GetPose().Forward + GetMovementController()->GetPose().Forward;
 		AddMovementInput(Input.GetSafeNormal(), Scale);
 	}
 }
@@ -162,12 +244,61 @@ void AVRCharacter::MoveRight(float Scale)
 
 void AVRCharacter::TurnRight(float Scale)
 {
-	FRotator CurrentRotation = VRRoot->GetComponentRotation();
+	TurnInput = Scale;
+}
+
+void AVRCharacter::TryTeleport(float Scale)
+{
+	TeleportInput = Scale;
+}
+
+void AVRCharacter::TickLocomotion(float DeltaTime)
+{
+	float StepTime = 1 / LocomotionStepRate;
+	LocomotionAccumulator += DeltaTime;
+	int32 NumSteps = FMath::FloorToInt(LocomotionAccumulator / StepTime);
+	if (NumSteps > MaxLocomotionStepsPerFrame)
+	{
+		NumSteps = MaxLocomotionStepsPerFrame;
+		LocomotionAccumulator = NumSteps * StepTime;
+	}
+
+	for (int32 i = 0; i < NumSteps; i++)
+	{
+		PreviousTurnYaw = TurnYaw;
+		StepTurn(TurnInput, StepTime);
+		// Axes are only read once a frame, spread the change over the steps so the gesture sees the same motion at any frame rate
+		StepTeleport(FMath::Lerp(LastTeleportInput, TeleportInput, (i + 1) / float(NumSteps)));
+		LocomotionAccumulator -= StepTime;
+	}
+	LastTeleportInput = TeleportInput;
+
+	float Alpha = FMath::Clamp(LocomotionAccumulator / StepTime, 0.f, 1.f);
+	float RenderYaw = FMath::Lerp(PreviousTurnYaw, TurnYaw, Alpha);
+	if (RenderYaw != AppliedTurnYaw)
+	{
+		VRRoot->SetWorldRotation(VRRoot->GetComponentRotation() + FRotator(0, RenderYaw - AppliedTurnYaw, 0));
+		AppliedTurnYaw = RenderYaw;
+	}
+	// Only the differences matter, keep them small
+	if (FMath::Abs(AppliedTurnYaw) > 360)
+	{
+		float Wrap = 360 * FMath::Sign(AppliedTurnYaw);
+		PreviousTurnYaw -= Wrap;
+		TurnYaw -= Wrap;
+		AppliedTurnYaw -= Wrap;
+	}
+}
+
+void AVRCharacter::StepTurn(float Scale, float StepTime)
+{
 	if (TurnType == ETurnType::Snap && !HaveSnapped && abs(Scale) > SnapTurnActivationScale)
 	{
 		if (Scale > SnapTurnActivationScale) { Scale = 1; }
 		else if (Scale < -SnapTurnActivationScale) {Scale = -1; }
-		VRRoot->SetWorldRotation(CurrentRotation + FRotator(0, AngleToSnap * Scale, 0));
+		// Snapping is meant to be instant, nothing to interpolate
+		TurnYaw += AngleToSnap * Scale;
+		PreviousTurnYaw = TurnYaw;
 		HaveSnapped = true;
 	}
 	else if (TurnType == ETurnType::Snap && abs(Scale) < SnapTurnActivationScale && abs(Scale) > 0)
@@ -176,18 +307,23 @@ void AVRCharacter::TurnRight(float Scale)
 	}
 	else if (TurnType == ETurnType::Smooth && abs(Scale) > SmoothTurnActivationScale)
 	{
-		VRRoot->SetWorldRotation(CurrentRotation + FRotator(0, Scale*SmoothTurnSpeed/50, 0));
+		// SmoothTurnSpeed was tuned as a fiftieth of a degree per frame at 90 Hz
+		TurnYaw += Scale * SmoothTurnSpeed / 50 * SmoothTurnTunedRate * StepTime;
 	}
 }
 
-void AVRCharacter::TryTeleport(float Scale)
+void AVRCharacter::StepTeleport(float Scale)
 {
 	if (GetTeleportController()->bAllowCharacterTeleport && bVelocityForTeleport(Scale) && !bCurrentlyTeleporting)
 	{
 		bCurrentlyTeleporting = true;
+		FVRTelemetry::Get().Record(EVRTelemetryEvent::Teleport);
 		// Fade out
 		PlayerCameraManager = UGameplayStatics::GetPlayerCameraManager(GetWorld(), 0);
 		PlayerCameraManager->StartCameraFade(0, 1, TeleportBlinkTime / 2, FLinearColor::Black, false, true); // last needs to be true otherwise flashes white
+		FVector Destination = GetTeleportController()->GetLastTeleportDestination();
+		if (UTeleportStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UTeleportStreamingSubsystem>()) { Streaming->PrefetchAround(Destination); }
+		if (!HasAuthority()) { ServerPrefetchTeleport(Destination); }
 		FTimerHandle Handle;
 		GetWorldTimerManager().SetTimer(Handle, this, &AVRCharacter::EndTeleport, TeleportBlinkTime / 2);
 	}
@@ -196,10 +332,33 @@ void AVRCharacter::TryTeleport(float Scale)
 void AVRCharacter::EndTeleport()
 {
 	PlayerCameraManager = UGameplayStatics::GetPlayerCameraManager(GetWorld(), 0);
-	FVector TeleportLocation;
-	GetTeleportController()->FindTeleportDestination(TeleportLocation); // could be more efficient to simply grab the position as usual instead of recalculating it all
+	GetTeleportController()->FindTeleportDestination(PendingTeleportLocation); // could be more efficient to simply grab the position as usual instead of recalculating it all
 	StopTeleportationCheck(); // we do this to reset the meshes sticking around
-	SetActorLocation(TeleportLocation + FVector(0, 0, GetCapsuleComponent()->GetScaledCapsuleHalfHeight())); // Capsule added to stop teleporting into floor
+	TeleportStreamingWait = 0;
+	FinishTeleport();
+}
+
+void AVRCharacter::FinishTeleport()
+{
+	// Stay faded out until the rooms at the destination are in, rather than teleporting into a pop-in
+	UTeleportStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UTeleportStreamingSubsystem>();
+	if (Streaming && !Streaming->IsReadyAt(PendingTeleportLocation))
+	{
+		if (TeleportStreamingWait < MaxTeleportStreamingWait)
+		{
+			Streaming->PrefetchAround(PendingTeleportLocation);
+			TeleportStreamingWait += TeleportTime;
+			FTimerHandle Handle;
+			GetWorldTimerManager().SetTimer(Handle, this, &AVRCharacter::FinishTeleport, TeleportTime);
+			return;
+		}
+		Streaming->FlushAt(PendingTeleportLocation);
+	}
+
+	FVector From = GetActorLocation();
+	SetActorLocation(PendingTeleportLocation + FVector(0, 0, GetCapsuleComponent()->GetScaledCapsuleHalfHeight())); // Capsule added to stop teleporting into floor
+	BroadcastTeleported(From);
+	if (!HasAuthority()) { ServerTeleport(PendingTeleportLocation); }
 	FTimerHandle Handle;
 	GetWorldTimerManager().SetTimer(Handle, this, &AVRCharacter::FadeOutFromTeleport, TeleportTime);
 }
@@ -250,32 +409,8 @@ void AVRCharacter::StopTeleportationCheck()
 
 bool AVRCharacter::bVelocityForTeleport(float Scale)
 {
-	if (ScaleHistory.Num() < ScaleHistoryMaxNum)
-		ScaleHistory.Add(Scale);
-	else
-	{
-		ScaleHistory.RemoveAt(0, 1, true);
-		ScaleHistory.Add(Scale);
-	}
-
-	if (ScaleHistory.Num() == ScaleHistoryMaxNum)
-	{
-		float Difference = ScaleHistory[ScaleHistoryMaxNum - 1] - ScaleHistory[0];
-		bool bAllScalesNegative = true;
-		for (float S : ScaleHistory) 
-		{ 
-			if (S > 0) 
-			{ 
-				bAllScalesNegative = false; 
-				break; 
-			} 
-		}
-		if (Difference > TeleportActivationScale && bAllScalesNegative) // Difference needs to be negative as only when pulling back up
-		{
-			return true;
-		}
-	}
-	return false;
+	// Difference needs to be positive while every sample is still pulled back, ie. only when pulling back up
+	return TeleportGesture.Push(Scale, TeleportActivationScale);
 }
 
 
@@ -289,4 +424,269 @@ void AVRCharacter::SendGrabRequestRight(float Scale)
 {
 	if (Scale > GrabActivationScale) { RightController->DetectGrabStyle(); }
 	else { RightController->DetectReleaseStyle(); }
-}
\ No newline at end of file
+}
+
+void AVRCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AVRCharacter, ReplicatedPoses, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AVRCharacter, AckedPoseSequence, COND_OwnerOnly);
+}
+
+AVRController* AVRCharacter::GetHandController(EControllerHand Hand)
+{
+	if (Hand == EControllerHand::Left) { return LeftController; }
+	return RightController;
+}
+
+void AVRCharacter::UpdateLocalTracking()
+{
+	// Only the owning player's devices drive the hands, everyone else gets them from ReplicatedPoses
+	bool bShouldTrack = IsLocallyControlled();
+	if (bShouldTrack == bLocallyTracked) { return; }
+	bLocallyTracked = bShouldTrack;
+	if (LeftController) { LeftController->SetLocallyTracked(bShouldTrack); }
+	if (RightController) { RightController->SetLocallyTracked(bShouldTrack); }
+}
+
+FVRReplicatedPoses AVRCharacter::CapturePoses() const
+{
+	// All relative to VRRoot, ie. tracking space, which keeps the quantised range small
+	FVRReplicatedPoses Poses;
+	Poses.Head.FromTransform(Camera->GetRelativeTransform());
+	if (LeftController) { Poses.Left.FromTransform(LeftController->GetRootComponent()->GetRelativeTransform()); }
+	if (RightController) { Poses.Right.FromTransform(RightController->GetRootComponent()->GetRelativeTransform()); }
+	return Poses;
+}
+
+void AVRCharacter::ApplyPoses(const FVRReplicatedPoses& Poses)
+{
+	Camera->SetRelativeTransform(Poses.Head.ToTransform());
+	if (LeftController) { LeftController->SetTrackedPose(Poses.Left.ToTransform()); }
+	if (RightController) { RightController->SetTrackedPose(Poses.Right.ToTransform()); }
+}
+
+void AVRCharacter::StorePoseHistory(uint16 Sequence, const FVRReplicatedPoses& Poses)
+{
+	FPoseHistoryEntry& Entry = PoseHistory[Sequence % PoseHistorySize];
+	Entry.Sequence = Sequence;
+	Entry.Poses = Poses;
+}
+
+void AVRCharacter::SendPoses(float DeltaTime)
+{
+	TimeSinceLastPoseSend += DeltaTime;
+	TimeSinceLastPoseRPC += DeltaTime;
+	if (TimeSinceLastPoseSend < 1 / PoseSendRate) { return; }
+	TimeSinceLastPoseSend = 0;
+
+	FVRReplicatedPoses Poses = CapturePoses();
+	// Listen server host, property replication takes it from here
+	if (HasAuthority())
+	{
+		ReplicatedPoses = Poses;
+		return;
+	}
+	if (PoseSequence != 0 && Poses == LastSentPoses)
+	{
+		// Keep going until the server has the last change, or a lost update would leave everyone on a stale pose
+		if (AckedPoseSequence == PoseSequence || TimeSinceLastPoseRPC < 1 / PoseResendRate) { return; }
+	}
+
+	// 0 means nothing acknowledged yet, so never use it as a sequence
+	if (++PoseSequence == 0) { PoseSequence = 1; }
+	const FPoseHistoryEntry& Acked = PoseHistory[AckedPoseSequence % PoseHistorySize];
+	bool bHasBaseline = AckedPoseSequence != 0 && Acked.Sequence == AckedPoseSequence;
+	FVRPoseDelta Delta = FVRPoseDelta::Make(PoseSequence, Poses, bHasBaseline ? &Acked.Poses : nullptr, AckedPoseSequence);
+
+	StorePoseHistory(PoseSequence, Poses);
+	LastSentPoses = Poses;
+	TimeSinceLastPoseRPC = 0;
+	ServerUpdatePoses(Delta);
+}
+
+bool AVRCharacter::ServerUpdatePoses_Validate(const FVRPoseDelta& Delta)
+{
+	return true;
+}
+
+void AVRCharacter::ServerUpdatePoses_Implementation(const FVRPoseDelta& Delta)
+{
+	// Unreliable, so drop anything older than what we already have
+	if (AckedPoseSequence != 0 && !IsNewerVRSequence(Delta.Sequence, AckedPoseSequence)) { return; }
+
+	FVRReplicatedPoses Baseline;
+	if (Delta.bHasBaseline)
+	{
+		const FPoseHistoryEntry& Entry = PoseHistory[Delta.BaselineSequence % PoseHistorySize];
+		if (Entry.Sequence != Delta.BaselineSequence) { return; }
+		Baseline = Entry.Poses;
+	}
+	FVRReplicatedPoses Poses = Delta.Apply(Baseline);
+
+	StorePoseHistory(Delta.Sequence, Poses);
+	AckedPoseSequence = Delta.Sequence;
+	ReplicatedPoses = Poses;
+	ApplyPoses(Poses);
+}
+
+void AVRCharacter::OnRep_ReplicatedPoses()
+{
+	ApplyPoses(ReplicatedPoses);
+}
+
+void AVRCharacter::NotifyGrabbed(EControllerHand Hand, UPrimitiveComponent* Component)
+{
+	if (!IsLocallyControlled()) { return; }
+	FVRTelemetry::Get().Record(EVRTelemetryEvent::Grabbed, (float)Hand);
+	if (HasAuthority()) { MulticastSetGrabbing(Hand, true); }
+	else { ServerTryGrab(Hand, Component); }
+}
+
+void AVRCharacter::NotifyReleased(EControllerHand Hand)
+{
+	if (!IsLocallyControlled()) { return; }
+	FVRTelemetry::Get().Record(EVRTelemetryEvent::Released, (float)Hand);
+	if (HasAuthority()) { MulticastSetGrabbing(Hand, false); }
+	else { ServerReleaseGrab(Hand); }
+}
+
+bool AVRCharacter::ServerTryGrab_Validate(EControllerHand Hand, UPrimitiveComponent* Component)
+{
+	return Hand == EControllerHand::Left || Hand == EControllerHand::Right;
+}
+
+void AVRCharacter::ServerTryGrab_Implementation(EControllerHand Hand, UPrimitiveComponent* Component)
+{
+	AVRController* Controller = GetHandController(Hand);
+	// The hand has to actually be near the object on the server, as far as its pose latency allows
+	if (!Controller || !Component || !Component->IsSimulatingPhysics() || !Controller->bCanReachComponent(Component, MaxGrabReach))
+	{
+		ClientRejectGrab(Hand);
+		return;
+	}
+	Controller->AuthorityGrab(Component);
+	MulticastSetGrabbing(Hand, true);
+}
+
+bool AVRCharacter::ServerReleaseGrab_Validate(EControllerHand Hand)
+{
+	return true;
+}
+
+void AVRCharacter::ServerReleaseGrab_Implementation(EControllerHand Hand)
+{
+	if (AVRController* Controller = GetHandController(Hand)) { Controller->ReleaseGrab(); }
+	MulticastSetGrabbing(Hand, false);
+}
+
+void AVRCharacter::ClientRejectGrab_Implementation(EControllerHand Hand)
+{
+	if (AVRController* Controller = GetHandController(Hand)) { Controller->RejectPredictedGrab(); }
+}
+
+void AVRCharacter::SendGrabStates(float DeltaTime)
+{
+	TimeSinceGrabStateSend += DeltaTime;
+	if (TimeSinceGrabStateSend < 1 / GrabStateSendRate) { return; }
+	TimeSinceGrabStateSend = 0;
+
+	for (AVRController* Controller : { LeftController, RightController })
+	{
+		if (!Controller) { continue; }
+		if (UPrimitiveComponent* Grabbed = Controller->GetGrabbedComponent()) { ClientGrabState(Controller->Hand, Grabbed->GetComponentLocation()); }
+	}
+}
+
+void AVRCharacter::ClientGrabState_Implementation(EControllerHand Hand, FVector_NetQuantize10 ServerLocation)
+{
+	if (AVRController* Controller = GetHandController(Hand)) { Controller->ReconcileGrab(ServerLocation, GetNetLatency()); }
+}
+
+float AVRCharacter::GetNetLatency() const
+{
+	// ExactPing is the round trip in milliseconds
+	return GetPlayerState() ? GetPlayerState()->ExactPing / 1000 : 0;
+}
+
+void AVRCharacter::MulticastSetGrabbing_Implementation(EControllerHand Hand, bool bGrabbing)
+{
+	if (IsLocallyControlled()) { return; }
+	if (AVRController* Controller = GetHandController(Hand)) { Controller->SetRemoteGrabbing(bGrabbing); }
+}
+
+void AVRCharacter::NotifyFlickStarted(const FVRFlickEvent& FlickEvent, UPrimitiveComponent* Component)
+{
+	if (!IsLocallyControlled()) { return; }
+	FVRTelemetry::Get().Record(EVRTelemetryEvent::FlickStarted, (float)FlickEvent.Hand);
+	if (HasAuthority()) { MulticastStartFlick(FlickEvent); }
+	else { ServerStartFlick(FlickEvent, Component); }
+}
+
+bool AVRCharacter::ServerStartFlick_Validate(const FVRFlickEvent& FlickEvent, UPrimitiveComponent* Component)
+{
+	return FlickEvent.Hand == EControllerHand::Left || FlickEvent.Hand == EControllerHand::Right;
+}
+
+void AVRCharacter::ServerStartFlick_Implementation(const FVRFlickEvent& FlickEvent, UPrimitiveComponent* Component)
+{
+	AVRController* Controller = GetHandController(FlickEvent.Hand);
+	if (!Controller || !Component || !Component->IsSimulatingPhysics() || !Controller->bCanReachComponent(Component, MaxFlickDistance))
+	{
+		ClientRejectFlick(FlickEvent.Hand);
+		return;
+	}
+	Controller->AuthorityFlick(Component, FlickEvent);
+	MulticastStartFlick(FlickEvent);
+}
+
+void AVRCharacter::ClientRejectFlick_Implementation(EControllerHand Hand)
+{
+	if (AVRController* Controller = GetHandController(Hand)) { Controller->RejectPredictedFlick(); }
+}
+
+void AVRCharacter::MulticastStartFlick_Implementation(const FVRFlickEvent& FlickEvent)
+{
+	if (IsLocallyControlled()) { return; }
+	// The server already runs the flight itself in ServerStartFlick
+	if (HasAuthority()) { return; }
+	if (AVRController* Controller = GetHandController(FlickEvent.Hand)) { Controller->PlayRemoteFlick(FlickEvent); }
+}
+
+bool AVRCharacter::ServerTeleport_Validate(FVector_NetQuantize Destination)
+{
+	return !Destination.ContainsNaN();
+}
+
+void AVRCharacter::ServerTeleport_Implementation(FVector_NetQuantize Destination)
+{
+	// Off the navmesh or out of the arc's reach isn't a teleport the client could have aimed, character movement corrects it back
+	AVRController* Controller = GetTeleportController();
+	if (!Controller || !Controller->bCanArcReach(Destination, TeleportRangeTolerance))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Rejected teleport of %s to %s"), *GetName(), *Destination.ToString());
+		return;
+	}
+	FVector From = GetActorLocation();
+	SetActorLocation(Destination + FVector(0, 0, GetCapsuleComponent()->GetScaledCapsuleHalfHeight()));
+	BroadcastTeleported(From);
+}
+
+void AVRCharacter::BroadcastTeleported(const FVector& From)
+{
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>())
+	{
+		Events->Teleported.Broadcast({ this, From, GetActorLocation() });
+	}
+}
+
+bool AVRCharacter::ServerPrefetchTeleport_Validate(FVector_NetQuantize Destination)
+{
+	return !Destination.ContainsNaN();
+}
+
+void AVRCharacter::ServerPrefetchTeleport_Implementation(FVector_NetQuantize Destination)
+{
+	if (UTeleportStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UTeleportStreamingSubsystem>()) { Streaming->PrefetchAround(Destination); }
+}
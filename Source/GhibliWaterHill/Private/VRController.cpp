@@ -11,6 +11,115 @@
 #include "PhysicsEngine/PhysicsHandleComponent.h"
 #include "Engine/StaticMeshActor.h" 
 #include "Kismet/KismetMathLibrary.h" 
+#include "InteractableSignificanceSubsystem.h"
+#include "VRCharacter.h"
+#include "VRNetTypes.h"
+#include "TimerManager.h"
+#include "GhibliWaterHill.h"
+#include "VRAssetPreloadSubsystem.h"
+#include "TeleportStreamingSubsystem.h"
+#include "MechanismNavSubsystem.h"
+#include "VRWorkSchedulerSubsystem.h"
+#include "VRTelemetry.h"
+#include "VRMemoryTracking.h"
+#include "VRMathCore.h"
+#include "VRInteractionEventSubsystem.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grab Reconciles"), STAT_GrabReconciles, STATGROUP_VRInteraction);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Grab Prediction Error"), STAT_GrabPredictionError, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Flight Reconciles"), STAT_FlightReconciles, STATGROUP_VRInteraction);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Flight Prediction Error"), STAT_FlightPredictionError, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hand Traces"), STAT_HandTraces, STATGROUP_VRInteraction);
+DECLARE_CYCLE_STAT(TEXT("Teleport Arc Fan"), STAT_TeleportArcFan, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Teleport Arcs Traced"), STAT_TeleportArcsTraced, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Teleport Arc Sweeps"), STAT_TeleportArcSweeps, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hand Transform Updates"), STAT_HandTransformUpdates, STATGROUP_VRInteraction);
+
+static_assert(sizeof(FVector) == sizeof(VRMath::FVec3), "FVector arrays are passed to VRMath as they are");
+static_assert(sizeof(int32) == sizeof(int), "So are int32 arrays");
+
+namespace
+{
+	namespace EHandWork
+	{
+		enum Type : uint8
+		{
+			None = 0,
+			GrabFollow = 1 << 0,
+			TeleportTrace = 1 << 1,
+			FlickPoseCheck = 1 << 2,
+			FlickTrace = 1 << 3,
+		};
+	}
+
+	// Indexed by EHandState, only this work is done in Tick for a hand in that state
+	const uint8 HandStateWork[] =
+	{
+		/* Idle */              EHandWork::FlickPoseCheck,
+		/* AimingTeleport */    EHandWork::TeleportTrace,
+		/* HighlightingFlick */ EHandWork::FlickPoseCheck | EHandWork::FlickTrace,
+		/* Flicking */          EHandWork::None,
+		/* Grabbing */          EHandWork::GrabFollow,
+	};
+	static_assert(UE_ARRAY_COUNT(HandStateWork) == (int32)EHandState::Grabbing + 1, "Every hand state needs its work listed");
+
+	struct FHandTransition
+	{
+		EHandState From;
+		EHandEvent Event;
+		EHandState To;
+	};
+
+	const FHandTransition HandTransitions[] =
+	{
+		{ EHandState::Idle,              EHandEvent::TeleportCheckStarted, EHandState::AimingTeleport },
+		// The highlight is only a preview, aiming a teleport takes over from it
+		{ EHandState::HighlightingFlick, EHandEvent::TeleportCheckStarted, EHandState::AimingTeleport },
+		{ EHandState::AimingTeleport,    EHandEvent::TeleportCheckStopped, EHandState::Idle },
+		{ EHandState::Idle,              EHandEvent::FlickPoseEntered,     EHandState::HighlightingFlick },
+		{ EHandState::HighlightingFlick, EHandEvent::FlickPoseLeft,        EHandState::Idle },
+		{ EHandState::HighlightingFlick, EHandEvent::FlickHeld,            EHandState::Flicking },
+		// The server only sees the launch
+		{ EHandState::Idle,              EHandEvent::FlickLaunched,        EHandState::Flicking },
+		{ EHandState::HighlightingFlick, EHandEvent::FlickLaunched,        EHandState::Flicking },
+		{ EHandState::Flicking,          EHandEvent::FlickFinished,        EHandState::Idle },
+		{ EHandState::Idle,              EHandEvent::Grabbed,              EHandState::Grabbing },
+		{ EHandState::AimingTeleport,    EHandEvent::Grabbed,              EHandState::Grabbing },
+		{ EHandState::HighlightingFlick, EHandEvent::Grabbed,              EHandState::Grabbing },
+		// Once released the flicked object flies on its own, the hand is free to grab
+		{ EHandState::Flicking,          EHandEvent::Grabbed,              EHandState::Grabbing },
+		{ EHandState::Grabbing,          EHandEvent::Released,             EHandState::Idle },
+	};
+
+	const FHandTransition* FindHandTransition(EHandState From, EHandEvent Event)
+	{
+		for (const FHandTransition& Transition : HandTransitions)
+		{
+			if (Transition.From == From && Transition.Event == Event) { return &Transition; }
+		}
+		return nullptr;
+	}
+
+	// For components placed in world space with SetWorldLocation, so the hand moving doesn't have to update them as well
+	void SetWorldSpace(USceneComponent* Component)
+	{
+		Component->SetUsingAbsoluteLocation(true);
+		Component->SetUsingAbsoluteRotation(true);
+		Component->SetUsingAbsoluteScale(true);
+	}
+
+	// How many components a move of Parent updates, USceneComponent::UpdateChildTransforms skips fully absolute children
+	int32 CountTransformFollowers(const USceneComponent* Parent)
+	{
+		int32 Count = 0;
+		for (const USceneComponent* Child : Parent->GetAttachChildren())
+		{
+			if (!Child || (Child->IsUsingAbsoluteLocation() && Child->IsUsingAbsoluteRotation() && Child->IsUsingAbsoluteScale())) { continue; }
+			Count += 1 + CountTransformFollowers(Child);
+		}
+		return Count;
+	}
+}
 
 #include "DrawDebugHelpers.h" 
 
@@ -27,16 +136,21 @@ AVRController::AVRController()
 
 	DestinationMarker = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("DestinationMarker"));
 	DestinationMarker->SetupAttachment(GetRootComponent());
+	SetWorldSpace(DestinationMarker);
 	DestinationMarker->SetWorldScale3D(DestinationMarkerScale);
 
+	// Only moves with the marker now
 	MarkerPoint = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MarkerPoint"));
 	MarkerPoint->SetupAttachment(DestinationMarker);
 
+	// The arcs are given world space points, so the splines sit at the origin instead of following the hand
 	TeleportPath = CreateDefaultSubobject<USplineComponent>(TEXT("TeleportPath"));
 	TeleportPath->SetupAttachment(GetRootComponent());
+	SetWorldSpace(TeleportPath);
 
 	FlickPath = CreateDefaultSubobject<USplineComponent>(TEXT("FlickPath"));
 	FlickPath->SetupAttachment(GetRootComponent());
+	SetWorldSpace(FlickPath);
 
 	PhysicsHandle = CreateDefaultSubobject<UPhysicsHandleComponent>(TEXT("PhysicsHandle"));
 
@@ -52,48 +166,121 @@ AVRController::AVRController()
 	FlickVolume = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("FlickVolume"));
 	FlickVolume->SetupAttachment(FlickRoot);
 
-	DebugMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("DebugMesh"));
-	DebugMesh->SetupAttachment(GetRootComponent());
+	// Null outside the editor, so packaged builds neither create nor move it
+	DebugMesh = CreateEditorOnlyDefaultSubobject<UStaticMeshComponent>(TEXT("DebugMesh"));
+	if (DebugMesh) { DebugMesh->SetupAttachment(GetRootComponent()); }
 }
 
 // Called when the game starts or when spawned
 void AVRController::BeginPlay()
 {
 	Super::BeginPlay();
+
+	MotionController->TransformUpdated.AddUObject(this, &AVRController::OnHandMoved);
+	// So the pose Tick snapshots is this frame's tracking, not the last
+	AddTickPrerequisiteComponent(MotionController);
+	if (UVRWorkSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UVRWorkSchedulerSubsystem>())
+	{
+		TeleportWorkHandle = Scheduler->RegisterWork(this, TEXT("TeleportTrace"), EVRWorkPriority::Critical, 0.2f, [this](float DeltaTime) { TeleportTraceWork(DeltaTime); });
+		FlickWorkHandle = Scheduler->RegisterWork(this, TEXT("FlickTrace"), EVRWorkPriority::High, 0.2f, [this](float DeltaTime) { FlickTraceWork(DeltaTime); });
+	}
+
+	// Pooled controllers register when they are handed out
+	if (bInPool) { return; }
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->RegisterActor(this);
+	}
+}
+
+// Called when the game ends or when destroyed
+void AVRController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVRWorkSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UVRWorkSchedulerSubsystem>())
+	{
+		Scheduler->UnregisterWork(TeleportWorkHandle);
+		Scheduler->UnregisterWork(FlickWorkHandle);
+	}
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		Significance->UnregisterActor(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
 void AVRController::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	
-	if (bCanHandTeleport() && bCanCheckTeleport) 
-	{ 
-		bAllowCharacterTeleport = UpdateTeleportationCheck();
-	}
+	RefreshPose(DeltaTime);
+#if STATS
+	// The hand moves every frame it's tracked, and everything that follows it is updated with it
+	INC_DWORD_STAT_BY(STAT_HandTransformUpdates, 1 + CountTransformFollowers(MotionController));
+#endif
 
-	if (bIsGrabbing)
+	if (HandStateWork[(uint8)HandState] & EHandWork::GrabFollow)
 	{
+		FVRTelemetryScope TelemetryScope(EVRTelemetryEvent::GrabPhase);
+		VR_LLM_SCOPE(Grab);
+		FVRLatencyTrace GrabLatency = BeginLatencyTrace();
 		// move object we're holding 
-		FVector MoveVector = GetActorForwardVector() + GetActorRotation().Vector() * GrabbedComponentInitDistance;
-		FRotator MoveRotator = GetActorRotation() - ControllerRotationOnGrab;
-		PhysicsHandle->SetTargetLocation(GetActorLocation() + MoveVector);
+		const FVRControllerPose& CurrentPose = GetPose();
+		FVector MoveVector = CurrentPose.Forward + CurrentPose.Forward * GrabbedComponentInitDistance;
+		bool bPredicting = bLocallyTracked && !bOnServer();
+		if (bPredicting) { ApplyGrabCorrection(DeltaTime); }
+		PhysicsHandle->SetTargetLocation(CurrentPose.Location + MoveVector + GrabCorrectionOffset);
 		PhysicsHandle->SetTargetRotation(GetActorRotation());
+		// No query, and the physics step that actually moves the object counts as the rest of the frame
+		FVRLatency::Get().Submit(EVRLatencyMechanic::HeldObject, GrabLatency);
+		if (bPredicting) { RecordPredictedGrab(); }
+	}
+	// Other players' hands only follow their grabs here, the checks below are for the local player
+	if (!bLocallyTracked) { return; }
+	if (SettlingFlight.IsValid()) { UpdateFlightSettle(DeltaTime); }
+
+	if (HandStateWork[(uint8)HandState] & EHandWork::TeleportTrace)
+	{ 
+		RequestHandWork(TeleportWorkHandle, &AVRController::TeleportTraceWork, DeltaTime);
+	}
+	if (HandStateWork[(uint8)HandState] & EHandWork::FlickPoseCheck)
+	{
+		FVRTelemetryScope TelemetryScope(EVRTelemetryEvent::FlickPhase);
+		VR_LLM_SCOPE(Flick);
+		UpdateFlickPose();
 	}
-	if (Hand == EControllerHand::Left)
+	// Checked after the pose check as it can change the state
+	if (HandStateWork[(uint8)HandState] & EHandWork::FlickTrace)
 	{
-		//if (bHoldingFlick)
-		//{
-		//	UE_LOG(LogTemp, Warning, TEXT("true!"))
-		//}
-		//else
-		//{
-		//	UE_LOG(LogTemp, Warning, TEXT("false!"))
-		//}
+		RequestHandWork(FlickWorkHandle, &AVRController::FlickTraceWork, DeltaTime);
+	}
+}
 
+void AVRController::RequestHandWork(int32 Handle, void (AVRController::*Work)(float), float DeltaTime)
+{
+	UVRWorkSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UVRWorkSchedulerSubsystem>();
+	if (!Scheduler || !Scheduler->RequestWork(Handle)) { (this->*Work)(DeltaTime); }
+}
 
-		FlickHighlight();
-	}
+void AVRController::TeleportTraceWork(float DeltaTime)
+{
+	FVRTelemetryScope TelemetryScope(EVRTelemetryEvent::TeleportPhase);
+	VR_LLM_SCOPE(Teleport);
+	TeleportLatency = BeginLatencyTrace();
+	bAllowCharacterTeleport = UpdateTeleportationCheck();
+	FVRLatency::Get().Submit(EVRLatencyMechanic::TeleportArc, TeleportLatency);
+	TeleportLatency = FVRLatencyTrace();
+}
+
+void AVRController::FlickTraceWork(float DeltaTime)
+{
+	// Deferred work can run after the hand has left HighlightingFlick
+	if (!(HandStateWork[(uint8)HandState] & EHandWork::FlickTrace)) { return; }
+	FVRTelemetryScope TelemetryScope(EVRTelemetryEvent::FlickPhase);
+	VR_LLM_SCOPE(Flick);
+	FlickLatency = BeginLatencyTrace();
+	FlickHighlight();
+	FVRLatency::Get().Submit(EVRLatencyMechanic::FlickHighlight, FlickLatency);
+	FlickLatency = FVRLatencyTrace();
 }
 
 void AVRController::SetHand(EControllerHand SetHand) {
@@ -101,43 +288,183 @@ void AVRController::SetHand(EControllerHand SetHand) {
 	MotionController->SetTrackingSource(Hand);
 	if (Hand == EControllerHand::Left) 
 	{ 
-		ControllerMesh->SetStaticMesh(LeftControllerMesh);
+		ControllerMesh->SetStaticMesh(UVRAssetPreloadSubsystem::GetResident(LeftControllerMesh));
 		GrabVolume->SetWorldScale3D(FVector(0.22, 0.22, 0.38)/2); // TODO remove magic numbers
 		GrabVolume->SetRelativeLocation(FVector(7.261321, 5.595972, 0.0));
 	}
 	else if (Hand == EControllerHand::Right) 
 	{ 
-		ControllerMesh->SetStaticMesh(RightControllerMesh);
+		ControllerMesh->SetStaticMesh(UVRAssetPreloadSubsystem::GetResident(RightControllerMesh));
 		GrabVolume->SetWorldScale3D(FVector(0.22, 0.22, 0.38)/2);
 		GrabVolume->SetRelativeLocation(FVector(7.261321, -8.009752, 0.0));
 	}
 }
 
+const FVRControllerPose& AVRController::GetPose()
+{
+	// Only before the first tick, after that it's the snapshot Tick took
+	if (!bHasPose) { RefreshPose(0); }
+	return Pose;
+}
+
+void AVRController::RefreshPose(float DeltaTime)
+{
+	FVector PreviousPoseLocation = Pose.Location;
+	bool bHadPose = bHasPose;
+	bHasPose = true;
+	// A hand that hasn't moved since the last pose has nothing to be late for
+	bPoseMoved = HandMovedTime != PoseSampleTime;
+	PoseSampleTime = HandMovedTime;
+
+	FTransform Transform = GetActorTransform();
+	FRotator Rotation = Transform.Rotator();
+	Pose.Location = Transform.GetLocation();
+	Pose.Forward = Transform.GetUnitAxis(EAxis::X);
+	Pose.Right = Transform.GetUnitAxis(EAxis::Y);
+	Pose.HandDirection = Transform.GetUnitAxis(EAxis::Z).RotateAngleAxis(100, Pose.Right);
+	// Snapshots are taken every tick, so this is one frame's movement
+	Pose.Velocity = (bHadPose && DeltaTime > 0) ? (Pose.Location - PreviousPoseLocation) / DeltaTime : FVector::ZeroVector;
+
+	// Palm turned up, which is the opposite roll on the right hand
+	Pose.bGoodFlickRotation = VRMath::IsGoodFlickRotation(Rotation.Pitch, Rotation.Roll, Hand == EControllerHand::Right);
+}
+
+void AVRController::OnHandMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (FVRLatency::Get().IsEnabled()) { HandMovedTime = FVRLatency::Get().Now(); }
+}
+
+FVRLatencyTrace AVRController::BeginLatencyTrace()
+{
+	// The pose the mechanics see is the one the motion controller had when it was refreshed
+	GetPose();
+	if (!bLocallyTracked || !bPoseMoved) { return FVRLatencyTrace(); }
+	return FVRLatency::Get().BeginTrace(PoseSampleTime);
+}
+
 bool AVRController::FindTeleportDestination(FVector& Location)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TeleportArcFan);
 	/// Using rotateangleaxis for easiness in teleportation handling (rotates it down from the controller)
 
-	FVector StartLocation = GetActorLocation() + GetActorForwardVector()*5;
-	FVector Direction = GetActorForwardVector().RotateAngleAxis(15, GetActorRightVector());
+	const FVRControllerPose& CurrentPose = GetPose();
+	FVector StartLocation = CurrentPose.Location + CurrentPose.Forward*5;
+	FVector Direction = CurrentPose.Forward.RotateAngleAxis(15, CurrentPose.Right);
 
-	FPredictProjectilePathResult Result;
-	bool bHit = ProjectilePathingUpdate(Result,
-		TeleportProjectileRadius,
-		StartLocation,
-		Direction,
-		TeleportProjectileSpeed,
+	// Every arc of the fan is integrated at once, it's the sweeps that cost, and those stop at the first arc that lands
+	if (TeleportFanOffsets.Num() == 0) { BuildTeleportFan(); }
+	int32 NumArcs = TeleportFanOffsets.Num();
+	int32 MaxPoints = VRMath::ArcPointCount(TeleportSimulationTime, TeleportSimulationFrequency);
+	TeleportFanVelocities.SetNumUninitialized(NumArcs, false);
+	for (int32 Arc = 0; Arc < NumArcs; Arc++)
+	{
+		const FVector2D& Offset = TeleportFanOffsets[Arc];
+		TeleportFanVelocities[Arc] = Direction.RotateAngleAxis(Offset.X, CurrentPose.Right).RotateAngleAxis(Offset.Y, FVector::UpVector) * TeleportProjectileSpeed;
+	}
+	TeleportFanPoints.SetNumUninitialized(NumArcs * MaxPoints, false);
+	TeleportFanCounts.SetNumUninitialized(NumArcs, false);
+	VRMath::IntegrateArcFan(reinterpret_cast<const VRMath::FVec3&>(StartLocation),
+		reinterpret_cast<const VRMath::FVec3*>(TeleportFanVelocities.GetData()),
+		NumArcs,
+		GetWorld()->GetGravityZ(),
 		TeleportSimulationTime,
-		ECollisionChannel::ECC_Visibility);
-	UpdateSpline(PathPointDataToFVector(Result.PathData), TeleportPath);
+		TeleportSimulationFrequency,
+		StartLocation.Z - TeleportMaxDrop,
+		reinterpret_cast<VRMath::FVec3*>(TeleportFanPoints.GetData()),
+		MaxPoints,
+		TeleportFanCounts.GetData());
 
+	/// The aimed arc is drawn unless one of the others lands instead
+	int32 ShownArc = 0;
+	int32 ShownSegment = INDEX_NONE;
+	FHitResult ShownHit;
+	bool bValidDestination = false;
+	for (int32 Arc = 0; Arc < NumArcs && !bValidDestination; Arc++)
+	{
+		INC_DWORD_STAT(STAT_TeleportArcsTraced);
+		FHitResult Hit;
+		int32 HitSegment = INDEX_NONE;
+		if (!TraceTeleportArc(&TeleportFanPoints[Arc * MaxPoints], TeleportFanCounts[Arc], Hit, HitSegment)) { continue; }
+		bValidDestination = bValidTeleportLocation(Hit.Location, Location);
+		if (Arc == 0 || bValidDestination)
+		{
+			ShownArc = Arc;
+			ShownSegment = HitSegment;
+			ShownHit = Hit;
+		}
+	}
+	TeleportLatency.MarkQueried();
+
+	const FVector* ShownPoints = &TeleportFanPoints[ShownArc * MaxPoints];
+	TeleportPathPoints.Reset();
+	if (ShownSegment == INDEX_NONE) { TeleportPathPoints.Append(ShownPoints, TeleportFanCounts[ShownArc]); }
+	else
+	{
+		TeleportPathPoints.Append(ShownPoints, ShownSegment + 1);
+		TeleportPathPoints.Add(ShownHit.Location);
+	}
+	UpdateSpline(TeleportPathPoints, TeleportPath);
+	return bValidDestination;
+}
+
+void AVRController::BuildTeleportFan()
+{
+	TeleportFanOffsets.Reset();
+	int32 Steps = FMath::Max(TeleportAssistSteps, 0);
+	for (int32 PitchStep = -Steps; PitchStep <= Steps; PitchStep++)
+	{
+		for (int32 YawStep = -Steps; YawStep <= Steps; YawStep++)
+		{
+			TeleportFanOffsets.Add(FVector2D(PitchStep * TeleportAssistPitchStep, YawStep * TeleportAssistYawStep));
+		}
+	}
+	// So the first arc that lands is the one closest to where the hand points
+	TeleportFanOffsets.StableSort([](const FVector2D& A, const FVector2D& B) { return A.SizeSquared() < B.SizeSquared(); });
+}
+
+bool AVRController::TraceTeleportArc(const FVector* Points, int32 NumPoints, FHitResult& OutHit, int32& OutHitSegment) const
+{
+	UWorld* World = GetWorld();
+	// The same query PredictProjectilePath made for each segment
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(TeleportArc), true, this); // complex to stop it not showing teleport places due to weird collisions in the map
+	const FCollisionShape Sphere = FCollisionShape::MakeSphere(TeleportProjectileRadius);
+	// Grown by how far the arc bows away from a straight sweep between the span's ends, so the coarse sweep can't miss anything
+	int32 Span = FMath::Max(TeleportCoarseSamples, 1);
+	const FCollisionShape CoarseSphere = FCollisionShape::MakeSphere(TeleportProjectileRadius + VRMath::ArcSagitta(World->GetGravityZ(), Span / TeleportSimulationFrequency));
+
+	for (int32 First = 0; First < NumPoints - 1; First += Span)
+	{
+		int32 Last = FMath::Min(First + Span, NumPoints - 1);
+		if (Last - First > 1)
+		{
+			INC_DWORD_STAT(STAT_TeleportArcSweeps);
+			if (!World->SweepTestByChannel(Points[First], Points[Last], FQuat::Identity, ECollisionChannel::ECC_Visibility, CoarseSphere, Params)) { continue; }
+		}
+		for (int32 i = First; i < Last; i++)
+		{
+			INC_DWORD_STAT(STAT_TeleportArcSweeps);
+			if (World->SweepSingleByChannel(OutHit, Points[i], Points[i + 1], FQuat::Identity, ECollisionChannel::ECC_Visibility, Sphere, Params))
+			{
+				OutHitSegment = i;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool AVRController::bValidTeleportLocation(const FVector& HitLocation, FVector& OutLocation) const
+{
 	/// We want to make sure we are also allowed to teleport there
-	UNavigationSystemV1* UNavSystem = UNavigationSystemV1::GetCurrent(GetWorld());
-	if (!ensure(UNavSystem)) { return false; }
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!ensure(NavSystem)) { return false; }
 	FNavLocation NavLocation;
-	bool bValidDestination = UNavSystem->ProjectPointToNavigation(FVector(Result.HitResult.Location), NavLocation, TeleportNavExtent);
-	Location = NavLocation.Location;
-
-	return bHit && bValidDestination;
+	if (!NavSystem->ProjectPointToNavigation(HitLocation, NavLocation, TeleportNavExtent)) { return false; }
+	/// A bridge or door still moving, or whose navmesh is still being rebuilt, isn't safe to land on
+	UMechanismNavSubsystem* MechanismNav = GetWorld()->GetSubsystem<UMechanismNavSubsystem>();
+	if (MechanismNav && !MechanismNav->IsSettledAt(NavLocation.Location)) { return false; }
+	OutLocation = NavLocation.Location;
+	return true;
 }
 
 bool AVRController::ProjectilePathingUpdate(FPredictProjectilePathResult& Result, float ProjectileRadius, FVector StartLocation, FVector Direction, float ProjectileSpeed, float SimulationTime, ECollisionChannel CollisionChannel)
@@ -156,14 +483,7 @@ bool AVRController::ProjectilePathingUpdate(FPredictProjectilePathResult& Result
 	return bHit;
 }
 
-TArray<FVector> AVRController::PathPointDataToFVector(TArray<FPredictProjectilePathPointData> PathData)
-{
-	TArray<FVector> OutArray;
-	for (FPredictProjectilePathPointData Point : PathData) { OutArray.Add(Point.Location); }
-	return OutArray;
-}
-
-void AVRController::UpdateSpline(TArray<FVector> PathData, USplineComponent* PathToUpdate)
+void AVRController::UpdateSpline(const TArray<FVector>& PathData, USplineComponent* PathToUpdate)
 {
 	// to hide left over spline components
 	ModifySplinePoints(PathToUpdate, true, true);
@@ -171,13 +491,8 @@ void AVRController::UpdateSpline(TArray<FVector> PathData, USplineComponent* Pat
 	{
 		if (PathData.Num() > MeshObjects.Num()) // only add if we need to add another one
 		{
-
-			SplineMesh = NewObject<USplineMeshComponent>(this);
-			SplineMesh->SetStaticMesh(TeleportArcMesh);
-			SplineMesh->SetMaterial(0, TeleportArcMaterial);
-			SplineMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-			SplineMesh->RegisterComponent();
-			MeshObjects.Add(SplineMesh);
+			// Should already exist from PrewarmArcMeshes, unless the arc settings were changed at runtime
+			AddArcMesh();
 		}
 		PathToUpdate->AddSplinePoint(PathData[i], ESplineCoordinateSpace::Local, ESplinePointType::Curve);
 		/// Orienting the meshes
@@ -189,7 +504,7 @@ void AVRController::UpdateSpline(TArray<FVector> PathData, USplineComponent* Pat
 			PathToUpdate->GetLocalLocationAndTangentAtSplinePoint(i, LocationEnd, TangentEnd);
 			SplineMesh->SetStartAndEnd(LocationStart, TangentStart, LocationEnd, TangentEnd);
 			MeshObjects[i - 1]->SetVisibility(true);
-			if (bCanCheckTeleport)
+			if (PathToUpdate == TeleportPath)
 			{
 				if (i == PathData.Num() - 1)
 				{
@@ -198,7 +513,31 @@ void AVRController::UpdateSpline(TArray<FVector> PathData, USplineComponent* Pat
 			}
 		}
 	}
-	if (bCanCheckTeleport) { MarkerPoint->SetVisibility(true); }
+	NumArcMeshesInUse = FMath::Max(PathData.Num() - 1, 0);
+	if (PathToUpdate == TeleportPath) { MarkerPoint->SetVisibility(true); }
+}
+
+USplineMeshComponent* AVRController::AddArcMesh()
+{
+	// Shared by the teleport and flick arcs
+	VR_LLM_SCOPE(Teleport);
+	SplineMesh = NewObject<USplineMeshComponent>(this);
+	SplineMesh->SetStaticMesh(UVRAssetPreloadSubsystem::GetResident(TeleportArcMesh));
+	SplineMesh->SetMaterial(0, UVRAssetPreloadSubsystem::GetResident(TeleportArcMaterial));
+	SplineMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SplineMesh->SetVisibility(false);
+	SplineMesh->RegisterComponent();
+	MeshObjects.Add(SplineMesh);
+	return SplineMesh;
+}
+
+void AVRController::PrewarmArcMeshes()
+{
+	// Nothing is drawn on a dedicated server, and it never aims or shows a flick itself
+	if (GetNetMode() == NM_DedicatedServer) { return; }
+	int32 TeleportArcPoints = VRMath::ArcPointCount(TeleportSimulationTime, TeleportSimulationFrequency);
+	int32 MaxArcPoints = FMath::Max(TeleportArcPoints, FlickSplinePointCount);
+	while (MeshObjects.Num() < MaxArcPoints) { AddArcMesh(); }
 }
 
 bool AVRController::UpdateTeleportationCheck()
@@ -206,7 +545,8 @@ bool AVRController::UpdateTeleportationCheck()
 	/// Destination for teleport
 	FVector TeleportLocation;
 	bool bTeleportDestinationExists = FindTeleportDestination(TeleportLocation);
-	if (bTeleportDestinationExists && bCanHandTeleport() && bCanCheckTeleport)
+	INC_DWORD_STAT(STAT_HandTraces);
+	if (bTeleportDestinationExists && HandState == EHandState::AimingTeleport)
 	{
 		FCollisionQueryParams TraceParams(FName(TEXT("Trace")), false, GetOwner());
 		/// Ray-cast out to reach distance
@@ -222,6 +562,12 @@ bool AVRController::UpdateTeleportationCheck()
 
 		DestinationMarker->SetWorldRotation(FRotator::ZeroRotator);
 		DestinationMarker->SetVisibility(true);
+		// Start streaming the rooms there in while the player is still aiming
+		LastTeleportDestination = TeleportLocation;
+		if (UTeleportStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UTeleportStreamingSubsystem>())
+		{
+			Streaming->PrefetchAround(TeleportLocation);
+		}
 		return true && !bGoodFlickRotation(); // We only want to allow teleporting if not trying to flick
 	}
 	else
@@ -247,10 +593,73 @@ bool AVRController::bCanHandMove()
 
 void AVRController::SetCanCheckTeleport(bool bCheck)
 {
-	bCanCheckTeleport = bCheck;
-	DestinationMarker->SetVisibility(false);
-	MarkerPoint->SetVisibility(false);
-	ModifySplinePoints(TeleportPath, true, true);
+	if (bCheck && !bCanHandTeleport()) { return; }
+	// The press only comes once, so while grabbing or flicking it's held until the hand is free instead of dropped
+	bTeleportCheckPending = bCheck && !HandleHandEvent(EHandEvent::TeleportCheckStarted);
+	if (!bCheck) { HandleHandEvent(EHandEvent::TeleportCheckStopped); }
+}
+
+bool AVRController::bCanHandleHandEvent(EHandEvent Event) const
+{
+	return FindHandTransition(HandState, Event) != nullptr;
+}
+
+bool AVRController::HandleHandEvent(EHandEvent Event)
+{
+	const FHandTransition* Transition = FindHandTransition(HandState, Event);
+	if (!Transition) { return false; }
+	SetHandState(Transition->To);
+	return true;
+}
+
+void AVRController::SetHandState(EHandState NewState)
+{
+	EHandState OldState = HandState;
+	HandState = NewState;
+	// Clean up whatever the old state was showing
+	if (OldState == EHandState::AimingTeleport)
+	{
+		bAllowCharacterTeleport = false;
+		DestinationMarker->SetVisibility(false);
+		MarkerPoint->SetVisibility(false);
+		ModifySplinePoints(TeleportPath, true, true);
+	}
+	if ((OldState == EHandState::HighlightingFlick && NewState != EHandState::Flicking) || OldState == EHandState::Flicking)
+	{
+		ClearFlickHighlight();
+	}
+	if (NewState == EHandState::Idle && bTeleportCheckPending)
+	{
+		bTeleportCheckPending = false;
+		HandleHandEvent(EHandEvent::TeleportCheckStarted);
+	}
+}
+
+void AVRController::UpdateFlickPose()
+{
+	bool bFlickPose = GetPose().bGoodFlickRotation;
+	if (HandState == EHandState::HighlightingFlick && !bFlickPose)
+	{
+		HandleHandEvent(EHandEvent::FlickPoseLeft);
+		return;
+	}
+	if (HandState != EHandState::Idle || !bFlickPose || ComponentCurrentlyFlicking) { return; }
+
+	// Only one hand highlights at a time, so flicking with either hand costs the same as it did with one
+	AVRCharacter* Character = GetOwningCharacter();
+	AVRController* OtherHand = Character ? Character->GetOtherController(this) : nullptr;
+	if (OtherHand && (OtherHand->HandState == EHandState::HighlightingFlick || OtherHand->HandState == EHandState::Flicking)) { return; }
+	HandleHandEvent(EHandEvent::FlickPoseEntered);
+}
+
+void AVRController::ClearFlickHighlight()
+{
+	if (RegisteredFlickComponent) { RegisteredFlickComponent->SetRenderCustomDepth(false); }
+	RegisteredFlickComponent = nullptr;
+	RegisteredControllerLocation = FVector::ZeroVector;
+	bOnOldComponent = true;
+	// A flicked object that is still flying follows FlickPath, so leave it alone
+	if (!ComponentCurrentlyFlicking) { ModifySplinePoints(FlickPath, true, true); }
 }
 
 void AVRController::DetectGrabStyle()
@@ -267,117 +676,109 @@ void AVRController::DetectReleaseStyle()
 
 bool AVRController::bGoodFlickRotation()
 {
-	FRotator Rotation = GetActorRotation();
-	// TODO we can deal with the magic numbers here at least for now
-	if (Hand == EControllerHand::Left) // since we need to change it/flip it based on the hand
-	{
-		if (( Rotation.Pitch < 25 && Rotation.Pitch > -45 ) && (Rotation.Roll < 120 && Rotation.Roll > 15))
-		{
-			//UE_LOG(LogTemp, Warning, TEXT("Trying to highlight"))
-			return true;
-		}
-	}
-	return false;
+	return GetPose().bGoodFlickRotation;
 }
 
 void AVRController::FlickHighlight()
 {
-	if (bGoodFlickRotation() && !bHoldingFlick && !ComponentCurrentlyFlicking && !bIsGrabbing)
+	// Only runs in HighlightingFlick, which the pose check has already confirmed this frame
+	//UE_LOG(LogTemp, Warning, TEXT("Trying to find object to flick"))
+	/// Ray-cast out to reach distance
+	const FVRControllerPose& CurrentPose = GetPose();
+	FVector StartLocation = CurrentPose.Location;
+	FVector HandDirection = CurrentPose.HandDirection;
+	FPredictProjectilePathResult FlickResult;
+	bool bHit = ProjectilePathingUpdate(FlickResult,
+		TeleportProjectileRadius,
+		StartLocation,
+		HandDirection,
+		TeleportProjectileSpeed*1,
+		TeleportSimulationTime*2,
+		ECollisionChannel::ECC_PhysicsBody);
+	INC_DWORD_STAT(STAT_HandTraces);
+
+	// Getting a larger area to detect objects
+	FlickRoot->SetWorldRotation(HandDirection.Rotation());
+	TArray<UPrimitiveComponent*> PotentialFlickComponents;
+	TArray<float> Distances;
+	GetOverlappingComponents(PotentialFlickComponents);
+	FlickLatency.MarkQueried();
+
+	for (UPrimitiveComponent* Comp : PotentialFlickComponents)
 	{
-		//UE_LOG(LogTemp, Warning, TEXT("Trying to find object to flick"))
-		/// Ray-cast out to reach distance
-		FVector StartLocation = GetActorLocation();
-		FVector HandDirection = GetActorUpVector().RotateAngleAxis(100, GetActorRightVector()).RotateAngleAxis(0, GetActorUpVector()).RotateAngleAxis(0, GetActorForwardVector());
-		FPredictProjectilePathResult FlickResult;
-		bool bHit = ProjectilePathingUpdate(FlickResult,
-			TeleportProjectileRadius,
-			StartLocation,
-			HandDirection,
-			TeleportProjectileSpeed*1,
-			TeleportSimulationTime*2,
-			ECollisionChannel::ECC_PhysicsBody);
-		
-
-		// Getting a larger area to detect objects
-		FlickRoot->SetWorldRotation(HandDirection.Rotation());
-		TArray<UPrimitiveComponent*> PotentialFlickComponents;
-		TArray<float> Distances;
-		GetOverlappingComponents(PotentialFlickComponents);
-
-		for (UPrimitiveComponent* Comp : PotentialFlickComponents)
-		{
-			if (ensure(Comp) && Comp->IsSimulatingPhysics())
-			{
-				Distances.Add(FVector::Distance(Comp->GetComponentLocation(), FlickVolume->GetComponentLocation()));
-			}
-		}
-		int32 MinIndex = 0;
-		float MinValue = 0;
-		UPrimitiveComponent* Component = nullptr;
-		if (Distances.Num() > 0)
+		if (ensure(Comp) && Comp->IsSimulatingPhysics())
 		{
-			UKismetMathLibrary::MinOfFloatArray(Distances, MinIndex, MinValue);
-			Component = PotentialFlickComponents[MinIndex];
+			Distances.Add(FVector::Distance(Comp->GetComponentLocation(), FlickVolume->GetComponentLocation()));
 		}
-		else { Component = FlickResult.HitResult.GetComponent(); }
-		if (RegisteredFlickComponent != FlickResult.HitResult.GetComponent())
-		{
-			//UE_LOG(LogTemp, Warning, TEXT("false"))
-			bOnOldComponent = false;
-		}
-		else
-		{
-			//UE_LOG(LogTemp, Warning, TEXT("true"))
-			bOnOldComponent = true;
-		}
-		if (RegisteredFlickComponent != Component ||
-			(FVector::Distance(RegisteredControllerLocation, GetActorLocation()) > 1 && RegisteredControllerLocation != FVector::ZeroVector))
+	}
+	int32 MinIndex = 0;
+	float MinValue = 0;
+	UPrimitiveComponent* Component = nullptr;
+	if (Distances.Num() > 0)
+	{
+		UKismetMathLibrary::MinOfFloatArray(Distances, MinIndex, MinValue);
+		Component = PotentialFlickComponents[MinIndex];
+	}
+	else { Component = FlickResult.HitResult.GetComponent(); }
+	if (RegisteredFlickComponent != FlickResult.HitResult.GetComponent())
+	{
+		//UE_LOG(LogTemp, Warning, TEXT("false"))
+		bOnOldComponent = false;
+	}
+	else
+	{
+		//UE_LOG(LogTemp, Warning, TEXT("true"))
+		bOnOldComponent = true;
+	}
+	if (RegisteredFlickComponent != Component ||
+		(FVector::Distance(RegisteredControllerLocation, CurrentPose.Location) > 1 && RegisteredControllerLocation != FVector::ZeroVector))
+	{
+		if (!bHoldingFlick)
 		{
-			if (!bHoldingFlick)
-			{
-				ResetRegisteredComponents();
-			}
+			ResetRegisteredComponents();
 		}
-		if (bHit && Component != ControllerMesh && Component->IsSimulatingPhysics() && !ComponentCurrentlyFlicking )
-		{
-			//UE_LOG(LogTemp, Warning, TEXT("Found object to flick %s"), *Component->GetName())
-			RegisteredFlickComponent = Component;
-			RegisteredFlickComponent->SetRenderCustomDepth(true);
-			RegisteredControllerLocation = GetActorLocation();
+	}
+	if (bHit && Component != ControllerMesh && Component->IsSimulatingPhysics() && !ComponentCurrentlyFlicking )
+	{
+		//UE_LOG(LogTemp, Warning, TEXT("Found object to flick %s"), *Component->GetName())
+		RegisteredFlickComponent = Component;
+		RegisteredFlickComponent->SetRenderCustomDepth(true);
+		RegisteredControllerLocation = CurrentPose.Location;
 
-			UpdateFlickSpline();
-			//UE_LOG(LogTemp, Warning, TEXT("2"))
-		}
-		else 
-		{ 
-			ModifySplinePoints(FlickPath, true, true);
-		}
+		UpdateFlickSpline();
+		//UE_LOG(LogTemp, Warning, TEXT("2"))
+	}
+	else 
+	{ 
+		ModifySplinePoints(FlickPath, true, true);
 	}
 }
 
 void AVRController::UpdateFlickSpline()
 {
-	FVector Vec1 = GetActorLocation();
+	const FVRControllerPose& CurrentPose = GetPose();
+	FVector Vec1 = CurrentPose.Location;
 	FVector Vec2 = RegisteredFlickComponent->GetComponentLocation();
-	FVector Direction = GetActorUpVector().RotateAngleAxis(100, GetActorRightVector()).RotateAngleAxis(0, GetActorUpVector()).RotateAngleAxis(0, GetActorForwardVector());
+	FVector Direction = CurrentPose.HandDirection;
 	float DirectionAngle = acos(FVector::DotProduct(Direction, Vec2 - Vec1) / (Direction.Size() * (Vec2 - Vec1).Size()));
 	//UE_LOG(LogTemp, Warning, TEXT("Angle %f"), DirectionAngle)
 	float CurveFloat = 0;
 	if (ensure(FlickAngleCurve)) { CurveFloat = FlickAngleCurve->GetFloatValue(DirectionAngle); }
 	float CpMultiplier = 250 * CurveFloat; // Remove magic number and deal with angle going down
 	//UE_LOG(LogTemp, Warning, TEXT("3"))
-	FVector CpDirection = (FVector(0, 0, -1) + GetActorRightVector()).GetSafeNormal();
+	// The arc bows out to the side of the palm, mirrored for the right hand
+	FVector CpDirection = (FVector(0, 0, -1) + CurrentPose.Right * (Hand == EControllerHand::Right ? -1 : 1)).GetSafeNormal();
 	FVector Cp1 = Vec1 - CpDirection * CpMultiplier;
 	FVector Cp2 = Vec2 - CpDirection * CpMultiplier;
 	//DebugMesh->SetWorldLocation(FVector::ZeroVector);
-	FVector ControlPoints[4] = { Vec1,
-	Cp1,
-	Cp2,
-	Vec2 };
-	int32 NumPoints = 100;
+	FlickControlPoints[0] = Vec1;
+	FlickControlPoints[1] = Cp1;
+	FlickControlPoints[2] = Cp2;
+	FlickControlPoints[3] = Vec2;
 	TArray<FVector> OutPoints;
 	//UE_LOG(LogTemp, Warning, TEXT("5"))
-	FVector::EvaluateBezier(ControlPoints, NumPoints, OutPoints);
+	OutPoints.SetNumUninitialized(FlickSplinePointCount);
+	VRMath::EvaluateBezier(reinterpret_cast<const VRMath::FVec3*>(FlickControlPoints), FlickSplinePointCount, reinterpret_cast<VRMath::FVec3*>(OutPoints.GetData()));
 	UpdateSpline(OutPoints, FlickPath);
 	ModifySplinePoints(FlickPath, true, false); // DO hide points, DO NOT remove them
 	RegisteredSplineComponent = FlickPath;
@@ -390,11 +791,14 @@ void AVRController::TryFlick()
 
 	*/
 	//UE_LOG(LogTemp, Warning, TEXT("Trying to flick"))
+	VR_LLM_SCOPE(Flick);
+	if (HandState == EHandState::HighlightingFlick) { HandleHandEvent(EHandEvent::FlickHeld); }
+	if (HandState != EHandState::Flicking) { return; }
 	bHoldingFlick = true;
 	UpdateFlickSpline();
 	ModifySplinePoints(FlickPath, false, false);
 	//UE_LOG(LogTemp, Warning, TEXT("Hodl"))
-	if (RegisteredFlickComponent && !bIsGrabbing)
+	if (RegisteredFlickComponent)
 	{
 		//UE_LOG(LogTemp, Warning, TEXT("s"))
 		if (bUpVelocityForFlick() && !bOnOldComponent)
@@ -404,7 +808,19 @@ void AVRController::TryFlick()
 			RegisteredFlickComponent = nullptr;
 			ModifySplinePoints(FlickPath, true, false); // we only want to hide the spline points
 			ComponentCurrentlyFlicking->SetRenderCustomDepth(false);
-			StartComponentFling.Broadcast(RegisteredSplineComponent, ComponentCurrentlyFlicking);
+			BroadcastFlingStarted();
+
+			SetPredictingComponent(ComponentCurrentlyFlicking, true);
+			if (AVRCharacter* Character = GetOwningCharacter())
+			{
+				FVRFlickEvent FlickEvent;
+				FlickEvent.Hand = Hand;
+				FlickEvent.Start = FlickControlPoints[0];
+				FlickEvent.ControlPoint1 = FlickControlPoints[1];
+				FlickEvent.ControlPoint2 = FlickControlPoints[2];
+				FlickEvent.End = FlickControlPoints[3];
+				Character->NotifyFlickStarted(FlickEvent, ComponentCurrentlyFlicking);
+			}
 		}
 		else
 		{ 
@@ -427,6 +843,8 @@ void AVRController::ReleaseFlick()
 	bHoldingFlick = false;
 	//UE_LOG(LogTemp, Warning, TEXT("Resetting! 1"))
 	//ComponentCurrentlyFlicking = nullptr; Not sure if we want this, wtf do i do
+	// Let go before it was launched
+	if (HandState == EHandState::Flicking && !ComponentCurrentlyFlicking) { HandleHandEvent(EHandEvent::FlickFinished); }
 }
 
 void AVRController::ResetRegisteredComponents()
@@ -434,6 +852,9 @@ void AVRController::ResetRegisteredComponents()
 	if (ComponentCurrentlyFlicking) 
 	{ 
 		ComponentCurrentlyFlicking->SetRenderCustomDepth(false);
+		// Flight is over, the server's state takes over again once we agree on where it ended
+		if (bLocallyTracked && !bOnServer()) { BeginFlightSettle(ComponentCurrentlyFlicking); }
+		else { SetPredictingComponent(ComponentCurrentlyFlicking, false); }
 	}
 	if (RegisteredFlickComponent) { RegisteredFlickComponent->SetRenderCustomDepth(false); }
 	ComponentCurrentlyFlicking = nullptr;
@@ -441,15 +862,22 @@ void AVRController::ResetRegisteredComponents()
 	//UE_LOG(LogTemp, Warning, TEXT("0"))
 	RegisteredSplineComponent = nullptr;
 	RegisteredControllerLocation = FVector::ZeroVector;
+	// Called from the Blueprint once the flicked object has landed
+	if (HandState == EHandState::Flicking && !bHoldingFlick) { HandleHandEvent(EHandEvent::FlickFinished); }
 }
 
 void AVRController::ModifySplinePoints(USplineComponent* PathToUpdate, bool bHidePoints, bool bClear)
 {
-	for (USplineMeshComponent* u : MeshObjects)
+	// Only the meshes the last arc used, the rest are already hidden
+	for (int32 i = 0; i < NumArcMeshesInUse; i++)
 	{
-		u->SetVisibility(!bHidePoints);
+		MeshObjects[i]->SetVisibility(!bHidePoints);
+	}
+	if (bClear)
+	{
+		PathToUpdate->ClearSplinePoints(true);
+		NumArcMeshesInUse = 0;
 	}
-	if (bClear) { PathToUpdate->ClearSplinePoints(true); }
 	//UE_LOG(LogTemp, Error, TEXT("ClearSplinePoints"))
 }
 
@@ -461,24 +889,303 @@ void AVRController::TryGrab()
 	Use PhysicsHandle or socket
 	*/
 	//UE_LOG(LogTemp, Warning, TEXT("Trying to grab"))
-	if (bIsGrabbing) { return; }
+	if (!bCanHandleHandEvent(EHandEvent::Grabbed)) { return; }
+	VR_LLM_SCOPE(Grab);
 
 	TArray<UPrimitiveComponent*> OverlappingComponents;
 	GrabVolume->GetOverlappingComponents(OverlappingComponents);
 	if (OverlappingComponents.Num() == 0) { return; }
-	bIsGrabbing = true;
-	GrabbedComponent = OverlappingComponents[0];
+	// Predicted, the server validates it and tells us if it disagrees
+	GrabComponent(OverlappingComponents[0]);
+	SetPredictingComponent(GrabbedComponent, true);
+	if (AVRCharacter* Character = GetOwningCharacter()) { Character->NotifyGrabbed(Hand, GrabbedComponent); }
+}
+
+void AVRController::GrabComponent(UPrimitiveComponent* Component)
+{
+	HandleHandEvent(EHandEvent::Grabbed);
+	GrabbedComponent = Component;
 	//UE_LOG(LogTemp, Warning, TEXT("grab"))
 	PhysicsHandle->GrabComponentAtLocationWithRotation(GrabbedComponent, NAME_None, GrabbedComponent->GetComponentLocation(), GetOwner()->GetActorRotation());
-	GrabbedComponentInitDistance = FVector::Distance(GetActorLocation(), GrabbedComponent->GetComponentLocation());
+	GrabbedComponentInitDistance = FVector::Distance(GetPose().Location, GrabbedComponent->GetComponentLocation());
 	ControllerRotationOnGrab = GetActorRotation();
+	PendingGrabCorrection = FVector::ZeroVector;
+	GrabCorrectionOffset = FVector::ZeroVector;
+	bGrabErrorUnderThreshold = true;
+	PredictedGrabHistoryHead = 0;
+	for (FPredictedGrabSample& Sample : PredictedGrabHistory) { Sample.Time = 0; }
+
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>()) { Events->Grabbed.Broadcast({ this, GrabbedComponent }); }
 }
 
 void AVRController::ReleaseGrab()
 {
-	if (bIsGrabbing)
+	if (bIsGrabbing())
 	{
 		PhysicsHandle->ReleaseComponent();
-		bIsGrabbing = false;
+		HandleHandEvent(EHandEvent::Released);
+		SetPredictingComponent(GrabbedComponent, false);
+		if (AVRCharacter* Character = GetOwningCharacter()) { Character->NotifyReleased(Hand); }
+		if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>()) { Events->Released.Broadcast({ this, GrabbedComponent }); }
 	}
-}
\ No newline at end of file
+}
+
+void AVRController::BroadcastFlingStarted()
+{
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>())
+	{
+		Events->FlingStarted.Broadcast({ this, RegisteredSplineComponent, ComponentCurrentlyFlicking });
+	}
+	// The Blueprint flies the component along the path, the only reason this stays a dynamic delegate
+	if (StartComponentFling.IsBound()) { StartComponentFling.Broadcast(RegisteredSplineComponent, ComponentCurrentlyFlicking); }
+}
+
+void AVRController::SetPredictingComponent(UPrimitiveComponent* Component, bool bPredicting)
+{
+	if (!Component || !Component->GetOwner()) { return; }
+	AActor* Owner = Component->GetOwner();
+	// Sub components (eg. a lever's rod) replicate through their owner's own state, not actor movement
+	if (Component != Owner->GetRootComponent()) { return; }
+	// Picked up again before its last flight settled, it's predicted from here on
+	if (bPredicting && SettlingFlight == Component)
+	{
+		SettlingFlight = nullptr;
+		bFlightBlending = false;
+	}
+	if (bOnServer())
+	{
+		// Props are static level actors until someone picks them up, dormant puzzle pieces wake while held
+		Owner->SetReplicates(true);
+		Owner->SetReplicateMovement(true);
+		Owner->SetNetDormancy(DORM_Awake);
+	}
+	else if (bLocallyTracked)
+	{
+		// While we predict it the server's movement would only fight us, corrections come through ReconcileGrab instead
+		Owner->SetReplicateMovement(!bPredicting);
+	}
+}
+
+bool AVRController::bCanReachComponent(UPrimitiveComponent* Component, float Reach) const
+{
+	if (!Component) { return false; }
+	return Component->Bounds.GetBox().ComputeSquaredDistanceToPoint(GetActorLocation()) <= FMath::Square(Reach);
+}
+
+bool AVRController::bCanArcReach(const FVector& Destination, float Tolerance) const
+{
+	// Furthest out is flat at full speed, highest is straight up, lowest is where the arcs are cut off
+	FVector Offset = Destination - GetActorLocation();
+	float Gravity = FMath::Max(FMath::Abs(GetWorld()->GetGravityZ()), 1.f);
+	float MaxRange = TeleportProjectileSpeed * TeleportSimulationTime + Tolerance;
+	float MaxRise = FMath::Square(TeleportProjectileSpeed) / (2 * Gravity) + Tolerance;
+	if (Offset.SizeSquared2D() > FMath::Square(MaxRange) || Offset.Z > MaxRise || Offset.Z < -(TeleportMaxDrop + Tolerance)) { return false; }
+
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSystem) { return false; }
+	FNavLocation NavLocation;
+	return NavSystem->ProjectPointToNavigation(Destination, NavLocation, TeleportNavExtent);
+}
+
+void AVRController::AuthorityGrab(UPrimitiveComponent* Component)
+{
+	if (bIsGrabbing()) { ReleaseGrab(); }
+	GrabComponent(Component);
+	SetPredictingComponent(Component, true);
+}
+
+void AVRController::AuthorityFlick(UPrimitiveComponent* Component, const FVRFlickEvent& FlickEvent)
+{
+	FlickControlPoints[0] = FlickEvent.Start;
+	FlickControlPoints[1] = FlickEvent.ControlPoint1;
+	FlickControlPoints[2] = FlickEvent.ControlPoint2;
+	FlickControlPoints[3] = FlickEvent.End;
+	TArray<FVector> OutPoints;
+	FVector::EvaluateBezier(FlickControlPoints, FlickSplinePointCount, OutPoints);
+	// Only the path is needed here, not the arc meshes
+	FlickPath->SetSplinePoints(OutPoints, ESplineCoordinateSpace::Local);
+
+	ComponentCurrentlyFlicking = Component;
+	RegisteredSplineComponent = FlickPath;
+	SetPredictingComponent(Component, true);
+	HandleHandEvent(EHandEvent::FlickLaunched);
+	BroadcastFlingStarted();
+}
+
+void AVRController::RejectPredictedGrab()
+{
+	if (!bIsGrabbing()) { return; }
+	PhysicsHandle->ReleaseComponent();
+	HandleHandEvent(EHandEvent::Released);
+	SetPredictingComponent(GrabbedComponent, false);
+}
+
+void AVRController::RejectPredictedFlick()
+{
+	bHoldingFlick = false;
+	ModifySplinePoints(FlickPath, true, true);
+	ResetRegisteredComponents();
+}
+
+void AVRController::RecordPredictedGrab()
+{
+	FPredictedGrabSample& Sample = PredictedGrabHistory[PredictedGrabHistoryHead];
+	Sample.Time = GetWorld()->GetTimeSeconds();
+	Sample.Location = GrabbedComponent->GetComponentLocation();
+	PredictedGrabHistoryHead = (PredictedGrabHistoryHead + 1) % PredictedGrabHistorySize;
+}
+
+void AVRController::ReconcileGrab(const FVector& ServerLocation, float Latency)
+{
+	if (!bIsGrabbing() || !GrabbedComponent) { return; }
+
+	// The server's state is roughly a round trip behind what we have predicted, so compare against where we were then
+	float SampleTime = GetWorld()->GetTimeSeconds() - Latency;
+	const FPredictedGrabSample* Closest = nullptr;
+	for (const FPredictedGrabSample& Sample : PredictedGrabHistory)
+	{
+		if (Sample.Time <= 0) { continue; }
+		if (!Closest || FMath::Abs(Sample.Time - SampleTime) < FMath::Abs(Closest->Time - SampleTime)) { Closest = &Sample; }
+	}
+	if (!Closest) { return; }
+
+	FVector Error = ServerLocation - Closest->Location;
+	SET_FLOAT_STAT(STAT_GrabPredictionError, Error.Size());
+	bGrabErrorUnderThreshold = Error.SizeSquared() < FMath::Square(GrabReconcileThreshold);
+	if (bGrabErrorUnderThreshold) { return; }
+
+	INC_DWORD_STAT(STAT_GrabReconciles);
+	PendingGrabCorrection = Error;
+}
+
+void AVRController::ApplyGrabCorrection(float DeltaTime)
+{
+	if (!PendingGrabCorrection.IsNearlyZero())
+	{
+		FVector Step = PendingGrabCorrection * FMath::Min(1.f, DeltaTime / GrabReconcileBlendTime);
+		PendingGrabCorrection -= Step;
+		// Moving the body itself would only have the physics handle pull it straight back to the old target
+		GrabCorrectionOffset += Step;
+	}
+	else if (bGrabErrorUnderThreshold && !GrabCorrectionOffset.IsNearlyZero())
+	{
+		// Whatever it made up for has passed, if it hasn't the server's next state brings it back
+		GrabCorrectionOffset -= GrabCorrectionOffset * FMath::Min(1.f, DeltaTime / GrabCorrectionDecayTime);
+	}
+}
+
+void AVRController::BeginFlightSettle(UPrimitiveComponent* Component)
+{
+	if (SettlingFlight.IsValid() && SettlingFlight != Component) { EndFlightSettle(); }
+	SettlingFlight = Component;
+	FlightSettleTime = 0;
+	bFlightBlending = false;
+}
+
+void AVRController::UpdateFlightSettle(float DeltaTime)
+{
+	UPrimitiveComponent* Component = SettlingFlight.Get();
+	FlightSettleTime += DeltaTime;
+	// The server ends its own flight about half a round trip after us, and we hear of it half a round trip later
+	AVRCharacter* Character = GetOwningCharacter();
+	if (Character && FlightSettleTime < Character->GetNetLatency()) { return; }
+
+	FVector Error = Component->GetOwner()->GetReplicatedMovement().Location - Component->GetComponentLocation();
+	SET_FLOAT_STAT(STAT_FlightPredictionError, Error.Size());
+	if (Error.SizeSquared() < FMath::Square(GrabReconcileThreshold) || FlightSettleTime > FlightSettleTimeout)
+	{
+		EndFlightSettle();
+		return;
+	}
+	if (!bFlightBlending)
+	{
+		bFlightBlending = true;
+		INC_DWORD_STAT(STAT_FlightReconciles);
+	}
+	// Teleported so the body keeps its velocity, the server's state keeps arriving as it settles
+	FVector Step = Error * FMath::Min(1.f, DeltaTime / GrabReconcileBlendTime);
+	Component->SetWorldLocation(Component->GetComponentLocation() + Step, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void AVRController::EndFlightSettle()
+{
+	UPrimitiveComponent* Component = SettlingFlight.Get();
+	SettlingFlight = nullptr;
+	bFlightBlending = false;
+	SetPredictingComponent(Component, false);
+}
+
+bool AVRController::bOnServer() const
+{
+	// Controllers are spawned locally on every machine and never replicated, so they have authority everywhere
+	return GetNetMode() != NM_Client;
+}
+
+AVRCharacter* AVRController::GetOwningCharacter() const
+{
+	return Cast<AVRCharacter>(GetOwner());
+}
+
+void AVRController::SetLocallyTracked(bool bTracked)
+{
+	bLocallyTracked = bTracked;
+	MotionController->SetComponentTickEnabled(bTracked);
+	MotionController->bDisableLowLatencyUpdate = !bTracked;
+}
+
+void AVRController::SetTrackedPose(const FTransform& RelativeTransform)
+{
+	MotionController->SetRelativeTransform(RelativeTransform);
+}
+
+void AVRController::PlayRemoteFlick(const FVRFlickEvent& FlickEvent)
+{
+	FlickControlPoints[0] = FlickEvent.Start;
+	FlickControlPoints[1] = FlickEvent.ControlPoint1;
+	FlickControlPoints[2] = FlickEvent.ControlPoint2;
+	FlickControlPoints[3] = FlickEvent.End;
+	TArray<FVector> OutPoints;
+	FVector::EvaluateBezier(FlickControlPoints, FlickSplinePointCount, OutPoints);
+	UpdateSpline(OutPoints, FlickPath);
+	GetWorldTimerManager().SetTimer(RemoteFlickTimer, this, &AVRController::HideRemoteFlick, RemoteFlickDisplayTime);
+}
+
+void AVRController::HideRemoteFlick()
+{
+	ModifySplinePoints(FlickPath, true, true);
+}
+
+void AVRController::SetPooledActive(bool bActive)
+{
+	bInPool = !bActive;
+	if (!bActive)
+	{
+		// Back to how a freshly spawned controller would be, without telling the server as the pawn is going away
+		RejectPredictedGrab();
+		RejectPredictedFlick();
+		if (SettlingFlight.IsValid()) { EndFlightSettle(); }
+		GetWorldTimerManager().ClearTimer(RemoteFlickTimer);
+		SetCanCheckTeleport(false);
+		bAllowCharacterTeleport = false;
+		bRemoteGrabbing = false;
+		bOnOldComponent = true;
+		GrabbedComponent = nullptr;
+		PendingGrabCorrection = FVector::ZeroVector;
+		GrabCorrectionOffset = FVector::ZeroVector;
+		bGrabErrorUnderThreshold = true;
+		// The next owner's hands start somewhere else
+		bHasPose = false;
+		SetHandState(EHandState::Idle);
+	}
+	SetLocallyTracked(bActive);
+	SetActorHiddenInGame(!bActive);
+	SetActorEnableCollision(bActive);
+	SetActorTickEnabled(bActive);
+
+	if (!HasActorBegunPlay()) { return; }
+	if (UInteractableSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UInteractableSignificanceSubsystem>())
+	{
+		if (bActive) { Significance->RegisterActor(this); }
+		else { Significance->UnregisterActor(this); }
+	}
+}
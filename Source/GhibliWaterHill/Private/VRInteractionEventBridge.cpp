@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRInteractionEventBridge.h"
+#include "Engine/World.h"
+#include "VRInteractionEventSubsystem.h"
+
+UVRInteractionEventBridge::UVRInteractionEventBridge()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UVRInteractionEventBridge::BeginPlay()
+{
+	Super::BeginPlay();
+	UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>();
+	if (!ensure(Events)) { return; }
+	FlingStartedSubscription = Events->FlingStarted.Subscribe<UVRInteractionEventBridge, &UVRInteractionEventBridge::HandleFlingStarted>(this);
+	GrabbedSubscription = Events->Grabbed.Subscribe<UVRInteractionEventBridge, &UVRInteractionEventBridge::HandleGrabbed>(this);
+	ReleasedSubscription = Events->Released.Subscribe<UVRInteractionEventBridge, &UVRInteractionEventBridge::HandleReleased>(this);
+	TeleportedSubscription = Events->Teleported.Subscribe<UVRInteractionEventBridge, &UVRInteractionEventBridge::HandleTeleported>(this);
+	DoorLockChangedSubscription = Events->DoorLockChanged.Subscribe<UVRInteractionEventBridge, &UVRInteractionEventBridge::HandleDoorLockChanged>(this);
+	LeverChangedSubscription = Events->LeverChanged.Subscribe<UVRInteractionEventBridge, &UVRInteractionEventBridge::HandleLeverChanged>(this);
+}
+
+void UVRInteractionEventBridge::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVRInteractionEventSubsystem* Events = GetWorld()->GetSubsystem<UVRInteractionEventSubsystem>())
+	{
+		Events->FlingStarted.Unsubscribe(FlingStartedSubscription);
+		Events->Grabbed.Unsubscribe(GrabbedSubscription);
+		Events->Released.Unsubscribe(ReleasedSubscription);
+		Events->Teleported.Unsubscribe(TeleportedSubscription);
+		Events->DoorLockChanged.Unsubscribe(DoorLockChangedSubscription);
+		Events->LeverChanged.Unsubscribe(LeverChangedSubscription);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void UVRInteractionEventBridge::HandleFlingStarted(const FVRFlingStartedEvent& Event)
+{
+	if (OnFlingStarted.IsBound()) { OnFlingStarted.Broadcast(Event.Controller, Event.Path, Event.Component); }
+}
+
+void UVRInteractionEventBridge::HandleGrabbed(const FVRGrabEvent& Event)
+{
+	if (OnGrabbed.IsBound()) { OnGrabbed.Broadcast(Event.Controller, Event.Component); }
+}
+
+void UVRInteractionEventBridge::HandleReleased(const FVRGrabEvent& Event)
+{
+	if (OnReleased.IsBound()) { OnReleased.Broadcast(Event.Controller, Event.Component); }
+}
+
+void UVRInteractionEventBridge::HandleTeleported(const FVRTeleportEvent& Event)
+{
+	if (OnTeleported.IsBound()) { OnTeleported.Broadcast(Event.Character, Event.From, Event.To); }
+}
+
+void UVRInteractionEventBridge::HandleDoorLockChanged(const FVRDoorLockEvent& Event)
+{
+	if (OnDoorLockChanged.IsBound()) { OnDoorLockChanged.Broadcast(Event.Door, Event.bLocked); }
+}
+
+void UVRInteractionEventBridge::HandleLeverChanged(const FVRLeverEvent& Event)
+{
+	if (OnLeverChanged.IsBound()) { OnLeverChanged.Broadcast(Event.Lever, Event.Scale); }
+}
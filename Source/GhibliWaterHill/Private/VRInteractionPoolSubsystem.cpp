@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRInteractionPoolSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "VRController.h"
+#include "VRAssetPreloadSubsystem.h"
+#include "Materials/MaterialInstanceDynamic.h"
+
+DECLARE_CYCLE_STAT(TEXT("Controller Acquire"), STAT_ControllerAcquire, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Controllers Free"), STAT_PooledControllersFree, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Controllers Active"), STAT_PooledControllersActive, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Controller Pool Misses"), STAT_ControllerPoolMisses, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shared Material Instances"), STAT_SharedMaterialInstances, STATGROUP_VRInteraction);
+
+bool UVRInteractionPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UVRInteractionPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	ActorsInitializedHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UVRInteractionPoolSubsystem::OnActorsInitialized);
+}
+
+void UVRInteractionPoolSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(ActorsInitializedHandle);
+	// The controllers themselves go with the world
+	FreeControllers.Empty();
+	ActiveControllers.Empty();
+	SharedMaterialInstances.Empty();
+	SharedMaterialKeys.Empty();
+	Super::Deinitialize();
+}
+
+void UVRInteractionPoolSubsystem::OnActorsInitialized(const UWorld::FActorsInitializedParams& Params)
+{
+	if (Params.World != GetWorld()) { return; }
+
+	// Arc meshes and controller meshes bind on spawn, so wait for them rather than loading them synchronously
+	UVRAssetPreloadSubsystem* Preload = GetWorld()->GetSubsystem<UVRAssetPreloadSubsystem>();
+	if (Preload && !Preload->IsPreloaded())
+	{
+		Preload->CallWhenPreloaded(FSimpleDelegate::CreateUObject(this, &UVRInteractionPoolSubsystem::Prewarm));
+		return;
+	}
+	Prewarm();
+}
+
+void UVRInteractionPoolSubsystem::Prewarm()
+{
+	// Normally already loaded by UVRAssetPreloadSubsystem, otherwise this is still part of the map load
+	TSubclassOf<AVRController> ControllerClass = PrewarmControllerClass.LoadSynchronous();
+	if (!ControllerClass) { return; }
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = FreeControllers.Num(); i < PrewarmControllerCount; i++)
+	{
+		if (AVRController* Controller = SpawnPooledController(ControllerClass)) { FreeControllers.Add(Controller); }
+	}
+	UE_LOG(LogTemp, Log, TEXT("Prewarmed %d %s in %.2f ms"), FreeControllers.Num(), *ControllerClass->GetName(), (FPlatformTime::Seconds() - StartTime) * 1000);
+	UpdateStats();
+}
+
+AVRController* UVRInteractionPoolSubsystem::SpawnPooledController(TSubclassOf<AVRController> ControllerClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	AVRController* Controller = GetWorld()->SpawnActor<AVRController>(ControllerClass, SpawnParams);
+	if (!ensure(Controller)) { return nullptr; }
+	Controller->PrewarmArcMeshes();
+	Controller->SetPooledActive(false);
+	return Controller;
+}
+
+AVRController* UVRInteractionPoolSubsystem::AcquireController(TSubclassOf<AVRController> ControllerClass, AActor* NewOwner)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ControllerAcquire);
+	if (!ensure(ControllerClass)) { return nullptr; }
+
+	AVRController* Controller = nullptr;
+	for (int32 i = FreeControllers.Num() - 1; i >= 0; i--)
+	{
+		if (!IsValid(FreeControllers[i])) { FreeControllers.RemoveAtSwap(i); continue; }
+		if (FreeControllers[i]->GetClass() != ControllerClass) { continue; }
+		Controller = FreeControllers[i];
+		FreeControllers.RemoveAtSwap(i);
+		break;
+	}
+	if (!Controller)
+	{
+		INC_DWORD_STAT(STAT_ControllerPoolMisses);
+		UE_LOG(LogTemp, Log, TEXT("Controller pool empty for %s, spawning"), *ControllerClass->GetName());
+		Controller = SpawnPooledController(ControllerClass);
+		if (!Controller) { return nullptr; }
+	}
+
+	Controller->SetOwner(NewOwner);
+	Controller->SetPooledActive(true);
+	ActiveControllers.Add(Controller);
+	UpdateStats();
+	return Controller;
+}
+
+void UVRInteractionPoolSubsystem::ReleaseController(AVRController* Controller)
+{
+	if (!IsValid(Controller) || Controller->IsActorBeingDestroyed()) { return; }
+
+	Controller->SetPooledActive(false);
+	Controller->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	Controller->SetOwner(nullptr);
+	ActiveControllers.RemoveSwap(Controller);
+	FreeControllers.AddUnique(Controller);
+	UpdateStats();
+}
+
+UMaterialInstanceDynamic* UVRInteractionPoolSubsystem::GetSharedMaterialInstance(UMaterialInterface* Parent, FName ScalarParameter, float Value)
+{
+	if (!ensure(Parent)) { return nullptr; }
+	for (int32 i = 0; i < SharedMaterialKeys.Num(); i++)
+	{
+		const FSharedMaterialKey& Key = SharedMaterialKeys[i];
+		if (Key.Parent == Parent && Key.ScalarParameter == ScalarParameter && Key.Value == Value) { return SharedMaterialInstances[i]; }
+	}
+
+	UMaterialInstanceDynamic* Instance = UMaterialInstanceDynamic::Create(Parent, this);
+	Instance->SetScalarParameterValue(ScalarParameter, Value);
+	SharedMaterialInstances.Add(Instance);
+	SharedMaterialKeys.Add({ Parent, ScalarParameter, Value });
+	UpdateStats();
+	return Instance;
+}
+
+void UVRInteractionPoolSubsystem::UpdateStats() const
+{
+	SET_DWORD_STAT(STAT_PooledControllersFree, FreeControllers.Num());
+	SET_DWORD_STAT(STAT_PooledControllersActive, ActiveControllers.Num());
+	SET_DWORD_STAT(STAT_SharedMaterialInstances, SharedMaterialInstances.Num());
+}
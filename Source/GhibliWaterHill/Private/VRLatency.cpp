@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRLatency.h"
+#include "GhibliWaterHill.h"
+#include "VRTelemetry.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "CoreGlobals.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Motion To Photon Traces"), STAT_LatencyTraces, STATGROUP_VRInteraction);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Teleport Arc Latency P50 (ms)"), STAT_TeleportArcLatencyP50, STATGROUP_VRInteraction);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Teleport Arc Latency P95 (ms)"), STAT_TeleportArcLatencyP95, STATGROUP_VRInteraction);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Flick Highlight Latency P50 (ms)"), STAT_FlickHighlightLatencyP50, STATGROUP_VRInteraction);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Flick Highlight Latency P95 (ms)"), STAT_FlickHighlightLatencyP95, STATGROUP_VRInteraction);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Held Object Latency P50 (ms)"), STAT_HeldObjectLatencyP50, STATGROUP_VRInteraction);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Held Object Latency P95 (ms)"), STAT_HeldObjectLatencyP95, STATGROUP_VRInteraction);
+
+static int32 GVRLatency = 1;
+static FAutoConsoleVariableRef CVarVRLatency(
+	TEXT("vr.Latency"),
+	GVRLatency,
+	TEXT("1 to measure motion to photon latency of the teleport arc, flick highlight and held objects, 0 to stop"));
+
+static int32 GVRLatencySimulate = -1;
+static FAutoConsoleVariableRef CVarVRLatencySimulate(
+	TEXT("vr.LatencySimulate"),
+	GVRLatencySimulate,
+	TEXT("1 to time frames as if vsynced at vr.LatencyDisplayHz instead of measuring them, 0 to measure, -1 to simulate only without a renderer"));
+
+static float GVRLatencyDisplayHz = 90;
+static FAutoConsoleVariableRef CVarVRLatencyDisplayHz(
+	TEXT("vr.LatencyDisplayHz"),
+	GVRLatencyDisplayHz,
+	TEXT("Refresh rate of the headset, scanout is taken to finish one refresh after the render thread submits"));
+
+namespace
+{
+	const TCHAR* MechanicNames[] = { TEXT("Teleport arc"), TEXT("Flick highlight"), TEXT("Held object") };
+	const EVRTelemetryEvent MechanicTelemetry[] = { EVRTelemetryEvent::TeleportArcLatency, EVRTelemetryEvent::FlickHighlightLatency, EVRTelemetryEvent::HeldObjectLatency };
+	static_assert(UE_ARRAY_COUNT(MechanicNames) == (int32)EVRLatencyMechanic::Count, "A name for each mechanic");
+	static_assert(UE_ARRAY_COUNT(MechanicTelemetry) == (int32)EVRLatencyMechanic::Count, "A telemetry event for each mechanic");
+}
+
+void FVRLatencyHistogram::Add(float TotalMs, const float (&StageMs)[(int32)EVRLatencyStage::Count])
+{
+	int32 Bucket = FMath::Clamp((int32)(TotalMs / BucketMs), 0, NumBuckets - 1);
+	Buckets[Bucket]++;
+	Count++;
+	MaxMs = FMath::Max(MaxMs, TotalMs);
+	for (int32 Stage = 0; Stage < (int32)EVRLatencyStage::Count; Stage++) { StageSumMs[Stage] += StageMs[Stage]; }
+}
+
+float FVRLatencyHistogram::GetPercentileMs(float Percentile) const
+{
+	if (Count == 0) { return 0; }
+	uint32 Target = FMath::Max(1u, (uint32)FMath::CeilToInt(Percentile * Count));
+	uint32 Seen = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets - 1; Bucket++)
+	{
+		Seen += Buckets[Bucket];
+		if (Seen >= Target) { return (Bucket + 1) * BucketMs; }
+	}
+	return MaxMs;
+}
+
+FVRLatency& FVRLatency::Get()
+{
+	static FVRLatency Latency;
+	return Latency;
+}
+
+double FVRLatency::Now() const
+{
+	double RealNow = FPlatformTime::Seconds();
+	return bSimulated ? SimulatedFrameStart + (RealNow - RealFrameStart) : RealNow;
+}
+
+FVRLatencyTrace FVRLatency::BeginTrace(double PoseTime) const
+{
+	FVRLatencyTrace Trace;
+	if (!bEnabled || PoseTime <= 0) { return Trace; }
+	Trace.PoseTime = PoseTime;
+	Trace.TickTime = Now();
+	return Trace;
+}
+
+void FVRLatency::Submit(EVRLatencyMechanic Mechanic, const FVRLatencyTrace& Trace)
+{
+	if (!bEnabled || !Trace.IsValid()) { return; }
+	checkSlow(IsInGameThread());
+	Pending.Add({ Trace, Now(), GFrameNumber, Mechanic });
+}
+
+void FVRLatency::Reset()
+{
+	for (FVRLatencyHistogram& Histogram : Histograms) { Histogram = FVRLatencyHistogram(); }
+}
+
+void FVRLatency::BeginFrame()
+{
+	double RealNow = FPlatformTime::Seconds();
+	bool bWantEnabled = GVRLatency != 0;
+	bool bWantSimulated = GVRLatencySimulate > 0 || (GVRLatencySimulate < 0 && !FApp::CanEverRender());
+	if (bWantEnabled != bEnabled || bWantSimulated != bSimulated)
+	{
+		// Timestamps from the other clock can't be compared with the new one
+		Pending.Reset();
+		Reset();
+		bEnabled = bWantEnabled;
+		bSimulated = bWantSimulated;
+		SimulatedFrameStart = RealNow;
+	}
+	else if (bSimulated)
+	{
+		// The last frame took however many refreshes its work needed, at least one
+		double Period = GetDisplayPeriod();
+		SimulatedFrameStart += Period * FMath::Max(1.0, FMath::CeilToDouble((RealNow - RealFrameStart) / Period));
+	}
+	RealFrameStart = RealNow;
+}
+
+void FVRLatency::EndFrame()
+{
+	if (!bEnabled) { return; }
+	if (bSimulated)
+	{
+		// The game thread's work rounded up to the next vsync, then a frame for the render thread
+		double Period = GetDisplayPeriod();
+		double GameThreadTime = FPlatformTime::Seconds() - RealFrameStart;
+		double SubmitTime = SimulatedFrameStart + Period * (FMath::Max(1.0, FMath::CeilToDouble(GameThreadTime / Period)) + 1);
+		for (const FPendingTrace& Trace : Pending) { Finish(Trace, SubmitTime); }
+		Pending.Reset();
+	}
+	else
+	{
+		// The render thread runs a frame or two behind, so traces wait here until their frame has been submitted
+		for (int32 i = Pending.Num() - 1; i >= 0; i--)
+		{
+			const FPendingTrace& Trace = Pending[i];
+			const FSubmitSlot& Slot = SubmitSlots[Trace.Frame % NumSubmitSlots];
+			uint32 SlotFrame = Slot.Frame.load(std::memory_order_acquire);
+			double SubmitTime = Slot.Time.load(std::memory_order_acquire);
+			bool bSubmitted = SlotFrame == Trace.Frame && Slot.Frame.load(std::memory_order_acquire) == SlotFrame;
+			if (bSubmitted) { Finish(Trace, SubmitTime); }
+			// Its slot has been reused, the frame was never seen
+			if (bSubmitted || GFrameNumber - Trace.Frame >= NumSubmitSlots) { Pending.RemoveAtSwap(i, 1, false); }
+		}
+	}
+
+	// Set at the end of the frame, so they are accumulators holding their value rather than per frame counters
+	uint32 NumTraces = 0;
+	for (const FVRLatencyHistogram& Histogram : Histograms) { NumTraces += Histogram.Count; }
+	SET_DWORD_STAT(STAT_LatencyTraces, NumTraces);
+	SET_FLOAT_STAT(STAT_TeleportArcLatencyP50, Histograms[(int32)EVRLatencyMechanic::TeleportArc].GetPercentileMs(0.5f));
+	SET_FLOAT_STAT(STAT_TeleportArcLatencyP95, Histograms[(int32)EVRLatencyMechanic::TeleportArc].GetPercentileMs(0.95f));
+	SET_FLOAT_STAT(STAT_FlickHighlightLatencyP50, Histograms[(int32)EVRLatencyMechanic::FlickHighlight].GetPercentileMs(0.5f));
+	SET_FLOAT_STAT(STAT_FlickHighlightLatencyP95, Histograms[(int32)EVRLatencyMechanic::FlickHighlight].GetPercentileMs(0.95f));
+	SET_FLOAT_STAT(STAT_HeldObjectLatencyP50, Histograms[(int32)EVRLatencyMechanic::HeldObject].GetPercentileMs(0.5f));
+	SET_FLOAT_STAT(STAT_HeldObjectLatencyP95, Histograms[(int32)EVRLatencyMechanic::HeldObject].GetPercentileMs(0.95f));
+}
+
+void FVRLatency::RenderFrameEnded()
+{
+	// Cleared first, so the game thread never pairs this frame with the slot's last time
+	uint32 Frame = GFrameNumberRenderThread;
+	FSubmitSlot& Slot = SubmitSlots[Frame % NumSubmitSlots];
+	Slot.Frame.store(0, std::memory_order_release);
+	Slot.Time.store(FPlatformTime::Seconds(), std::memory_order_release);
+	Slot.Frame.store(Frame, std::memory_order_release);
+}
+
+double FVRLatency::GetDisplayPeriod() const
+{
+	return 1.0 / FMath::Max(GVRLatencyDisplayHz, 1.f);
+}
+
+void FVRLatency::Finish(const FPendingTrace& Finished, double SubmitTime)
+{
+	const FVRLatencyTrace& Trace = Finished.Trace;
+	double PhotonTime = SubmitTime + GetDisplayPeriod();
+	double QueryTime = Trace.QueryTime > 0 ? Trace.QueryTime : Trace.TickTime;
+	float StageMs[(int32)EVRLatencyStage::Count] = {
+		(float)((Trace.TickTime - Trace.PoseTime) * 1000),
+		(float)((QueryTime - Trace.TickTime) * 1000),
+		(float)((Finished.UpdateTime - QueryTime) * 1000),
+		(float)((SubmitTime - Finished.UpdateTime) * 1000),
+		(float)((PhotonTime - SubmitTime) * 1000) };
+	float TotalMs = (float)((PhotonTime - Trace.PoseTime) * 1000);
+	Histograms[(int32)Finished.Mechanic].Add(TotalMs, StageMs);
+	FVRTelemetry::Get().Record(MechanicTelemetry[(int32)Finished.Mechanic], TotalMs);
+}
+
+void FVRLatency::LogReport() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Motion to photon latency, %s frame timing at %.0f Hz:"), bSimulated ? TEXT("simulated") : TEXT("measured"), GVRLatencyDisplayHz);
+	for (int32 Mechanic = 0; Mechanic < (int32)EVRLatencyMechanic::Count; Mechanic++)
+	{
+		const FVRLatencyHistogram& Histogram = Histograms[Mechanic];
+		UE_LOG(LogTemp, Display, TEXT("  %s: %u traces, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, worst %.1f ms"),
+			MechanicNames[Mechanic], Histogram.Count, Histogram.GetPercentileMs(0.5f), Histogram.GetPercentileMs(0.95f), Histogram.GetPercentileMs(0.99f), Histogram.MaxMs);
+		if (Histogram.Count == 0) { continue; }
+		UE_LOG(LogTemp, Display, TEXT("    average ms: pose to tick %.2f, tick to query %.2f, query to update %.2f, update to submit %.2f, submit to photon %.2f"),
+			Histogram.GetStageAverageMs(EVRLatencyStage::PoseToTick), Histogram.GetStageAverageMs(EVRLatencyStage::TickToQuery), Histogram.GetStageAverageMs(EVRLatencyStage::QueryToUpdate),
+			Histogram.GetStageAverageMs(EVRLatencyStage::UpdateToSubmit), Histogram.GetStageAverageMs(EVRLatencyStage::SubmitToPhoton));
+
+		uint32 Largest = 0;
+		for (uint32 Bucket : Histogram.Buckets) { Largest = FMath::Max(Largest, Bucket); }
+		for (int32 Bucket = 0; Bucket < FVRLatencyHistogram::NumBuckets; Bucket++)
+		{
+			if (Histogram.Buckets[Bucket] == 0) { continue; }
+			FString Bar = FString::ChrN(FMath::Max(1, (int32)(40.f * Histogram.Buckets[Bucket] / Largest)), TEXT('#'));
+			bool bLast = Bucket == FVRLatencyHistogram::NumBuckets - 1;
+			UE_LOG(LogTemp, Display, TEXT("    %s%5.1f ms %6u %s"), bLast ? TEXT(">") : TEXT(" "), Bucket * FVRLatencyHistogram::BucketMs, Histogram.Buckets[Bucket], *Bar);
+		}
+	}
+}
+
+static FAutoConsoleCommand VRLatencyReportCommand(
+	TEXT("vr.LatencyReport"),
+	TEXT("Logs the motion to photon latency histogram of each interaction mechanic, with where the time went"),
+	FConsoleCommandDelegate::CreateLambda([]() { FVRLatency::Get().LogReport(); }));
+
+static FAutoConsoleCommand VRLatencyResetCommand(
+	TEXT("vr.LatencyReset"),
+	TEXT("Clears the motion to photon latency histograms"),
+	FConsoleCommandDelegate::CreateLambda([]() { FVRLatency::Get().Reset(); }));
@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRMemoryBudgetSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
+#include "GhibliWaterHill.h"
+#include "VRTelemetry.h"
+
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last GC Pause (ms)"), STAT_LastGCPause, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Garbage Collections"), STAT_GarbageCollections, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live UObjects"), STAT_LiveUObjects, STATGROUP_VRInteraction);
+
+static int32 GVRMemorySteadyState = 0;
+static FAutoConsoleVariableRef CVarVRMemorySteadyState(
+	TEXT("vr.MemorySteadyState"),
+	GVRMemorySteadyState,
+	TEXT("1 to log an error when a VR memory tag grows after the warmup, 2 to also exit with an error code (for headless runs)"));
+
+bool UVRMemoryBudgetSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UVRMemoryBudgetSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UVRMemoryBudgetSubsystem::OnPreGarbageCollect);
+	PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &UVRMemoryBudgetSubsystem::OnPostGarbageCollect);
+}
+
+void UVRMemoryBudgetSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGCHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGCHandle);
+	Super::Deinitialize();
+}
+
+void UVRMemoryBudgetSubsystem::OnPreGarbageCollect()
+{
+	GCStartCycles = FPlatformTime::Cycles64();
+}
+
+void UVRMemoryBudgetSubsystem::OnPostGarbageCollect()
+{
+	if (GCStartCycles == 0) { return; }
+	// Reachability analysis and the start of the purge, which is when the game thread is stopped
+	float PauseMs = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - GCStartCycles);
+	GCStartCycles = 0;
+	GCCount++;
+	GCTotalMs += PauseMs;
+	GCMaxMs = FMath::Max(GCMaxMs, PauseMs);
+	SET_FLOAT_STAT(STAT_LastGCPause, PauseMs);
+	SET_DWORD_STAT(STAT_GarbageCollections, GCCount);
+	FVRTelemetry::Get().Record(EVRTelemetryEvent::GarbageCollect, PauseMs);
+}
+
+TStatId UVRMemoryBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVRMemoryBudgetSubsystem, STATGROUP_Tickables);
+}
+
+float UVRMemoryBudgetSubsystem::GetBudgetKB(int32 TagIndex) const
+{
+	const float Budgets[NumVRLLMTags] = { TeleportBudgetKB, FlickBudgetKB, GrabBudgetKB, HighlightBudgetKB, InteractablesBudgetKB };
+	return Budgets[TagIndex];
+}
+
+void UVRMemoryBudgetSubsystem::Tick(float DeltaTime)
+{
+	TimeRunning += DeltaTime;
+	TimeSinceCheck += DeltaTime;
+	if (TimeSinceCheck < CheckInterval) { return; }
+	TimeSinceCheck = 0;
+
+	int32 NumObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	SET_DWORD_STAT(STAT_LiveUObjects, NumObjects);
+	if (GVRMemorySteadyState > 0) { CheckObjectSteadyState(NumObjects); }
+
+	int64 TagBytes[NumVRLLMTags];
+	for (int32 i = 0; i < NumVRLLMTags; i++) { TagBytes[i] = GetVRLLMTagBytes(i); }
+	if (TagBytes[0] < 0)
+	{
+		if (!bWarnedNoLLM && GVRMemorySteadyState > 0) { UE_LOG(LogTemp, Warning, TEXT("vr.MemorySteadyState needs -llm on the command line")); }
+		bWarnedNoLLM = true;
+		return;
+	}
+
+	for (int32 i = 0; i < NumVRLLMTags; i++)
+	{
+		float KB = TagBytes[i] / 1024.f;
+		bool bOver = KB > GetBudgetKB(i);
+		// Once per time over, so a tag sitting over its budget doesn't spam the log
+		if (bOver && !bOverBudget[i])
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s is over its memory budget: %.1f KB of %.1f KB"), GetVRLLMTagName(i), KB, GetBudgetKB(i));
+		}
+		bOverBudget[i] = bOver;
+	}
+	if (GVRMemorySteadyState > 0) { CheckSteadyState(TagBytes); }
+}
+
+void UVRMemoryBudgetSubsystem::CheckSteadyState(const int64* TagBytes)
+{
+	if (TimeRunning < SteadyStateWarmup || bSteadyStateFailed) { return; }
+	if (!bHasBaseline)
+	{
+		FMemory::Memcpy(SteadyStateBaseline, TagBytes, sizeof(SteadyStateBaseline));
+		bHasBaseline = true;
+		UE_LOG(LogTemp, Log, TEXT("VR memory steady state baseline taken after %.0f s"), TimeRunning);
+		return;
+	}
+
+	for (int32 i = 0; i < NumVRLLMTags; i++)
+	{
+		float GrowthKB = (TagBytes[i] - SteadyStateBaseline[i]) / 1024.f;
+		if (GrowthKB <= SteadyStateToleranceKB) { continue; }
+		bSteadyStateFailed = true;
+		UE_LOG(LogTemp, Error, TEXT("VR memory steady state FAILED: %s grew %.1f KB in %.0f s since the baseline"), GetVRLLMTagName(i), GrowthKB, TimeRunning - SteadyStateWarmup);
+	}
+	if (bSteadyStateFailed) { FailSteadyState(); }
+}
+
+void UVRMemoryBudgetSubsystem::CheckObjectSteadyState(int32 NumObjects)
+{
+	if (TimeRunning < SteadyStateWarmup || bSteadyStateFailed) { return; }
+	if (ObjectBaseline == 0)
+	{
+		ObjectBaseline = NumObjects;
+		return;
+	}
+	// Counts objects waiting for the next GC too, so anything created every frame shows up even if it's dropped again
+	int32 Growth = NumObjects - ObjectBaseline;
+	if (Growth <= SteadyStateToleranceObjects) { return; }
+	bSteadyStateFailed = true;
+	UE_LOG(LogTemp, Error, TEXT("VR memory steady state FAILED: %d more UObjects in %.0f s since the baseline"), Growth, TimeRunning - SteadyStateWarmup);
+	FailSteadyState();
+}
+
+void UVRMemoryBudgetSubsystem::FailSteadyState()
+{
+	LogReport();
+	if (GVRMemorySteadyState > 1) { FPlatformMisc::RequestExitWithStatus(false, 1); }
+}
+
+void UVRMemoryBudgetSubsystem::LogReport() const
+{
+	int32 NumObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	UE_LOG(LogTemp, Display, TEXT("UObjects: %d (%+d since baseline)"), NumObjects, ObjectBaseline > 0 ? NumObjects - ObjectBaseline : 0);
+	UE_LOG(LogTemp, Display, TEXT("Garbage collection: %d passes in %.0f s, %.2f ms average, %.2f ms max pause"),
+		GCCount, TimeRunning, GCCount > 0 ? GCTotalMs / GCCount : 0.0, GCMaxMs);
+	for (int32 i = 0; i < NumVRLLMTags; i++)
+	{
+		int64 Bytes = GetVRLLMTagBytes(i);
+		if (Bytes < 0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("VR memory isn't tracked, run with -llm"));
+			return;
+		}
+		UE_LOG(LogTemp, Display, TEXT("%s: %.1f KB of %.1f KB budget (%+.1f KB since baseline)"),
+			GetVRLLMTagName(i), Bytes / 1024.f, GetBudgetKB(i), bHasBaseline ? (Bytes - SteadyStateBaseline[i]) / 1024.f : 0.f);
+	}
+}
+
+static void LogVRMemoryReport(UWorld* World)
+{
+	if (UVRMemoryBudgetSubsystem* Budgets = World ? World->GetSubsystem<UVRMemoryBudgetSubsystem>() : nullptr) { Budgets->LogReport(); }
+}
+
+static FAutoConsoleCommandWithWorld VRMemoryReportCommand(
+	TEXT("vr.MemoryReport"),
+	TEXT("Logs memory tracked under each VR tag against its budget (needs -llm), the UObject count and garbage collection pauses"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&LogVRMemoryReport));
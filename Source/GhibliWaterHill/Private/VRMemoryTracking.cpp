@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRMemoryTracking.h"
+#include "HAL/LowLevelMemStats.h"
+
+namespace
+{
+	const TCHAR* const VRLLMTagNames[NumVRLLMTags] = { TEXT("VR Teleport"), TEXT("VR Flick"), TEXT("VR Grab"), TEXT("VR Highlight"), TEXT("VR Interactables") };
+}
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+static_assert((int32)EVRLLMTag::End - (int32)ELLMTag::ProjectTagStart == NumVRLLMTags, "Every tag needs a name");
+
+DECLARE_LLM_MEMORY_STAT(TEXT("VR Teleport"), STAT_VRTeleportLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("VR Flick"), STAT_VRFlickLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("VR Grab"), STAT_VRGrabLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("VR Highlight"), STAT_VRHighlightLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("VR Interactables"), STAT_VRInteractablesLLM, STATGROUP_LLMFULL);
+// All of the above together in stat LLM
+DECLARE_LLM_MEMORY_STAT(TEXT("VR Interaction"), STAT_VRInteractionSummaryLLM, STATGROUP_LLM);
+
+void RegisterVRLLMTags()
+{
+	const FName StatNames[NumVRLLMTags] = {
+		GET_STATFNAME(STAT_VRTeleportLLM),
+		GET_STATFNAME(STAT_VRFlickLLM),
+		GET_STATFNAME(STAT_VRGrabLLM),
+		GET_STATFNAME(STAT_VRHighlightLLM),
+		GET_STATFNAME(STAT_VRInteractablesLLM)
+	};
+	for (int32 i = 0; i < NumVRLLMTags; i++)
+	{
+		FLowLevelMemTracker::Get().RegisterProjectTag((int32)ELLMTag::ProjectTagStart + i, VRLLMTagNames[i], StatNames[i], GET_STATFNAME(STAT_VRInteractionSummaryLLM));
+	}
+}
+
+int64 GetVRLLMTagBytes(int32 TagIndex)
+{
+	if (!FLowLevelMemTracker::IsEnabled()) { return -1; }
+	return FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, (ELLMTag)((int32)ELLMTag::ProjectTagStart + TagIndex));
+}
+
+#else
+
+void RegisterVRLLMTags() {}
+int64 GetVRLLMTagBytes(int32 TagIndex) { return -1; }
+
+#endif
+
+const TCHAR* GetVRLLMTagName(int32 TagIndex)
+{
+	return VRLLMTagNames[TagIndex];
+}
@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRNetStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/NetworkObjectList.h"
+#include "HAL/PlatformTime.h"
+#include "CoreGlobals.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/*
+Per player bandwidth and server replication cost, for sizing the pose replication against a local dedicated server.
+Either run vr.NetReport on the server console or set vr.NetReportInterval to log it periodically.
+With vr.NetReportCsv the periodic reports also go to a CSV, which is how bot load tests are read.
+*/
+
+static float GVRNetReportInterval = 0;
+static FAutoConsoleVariableRef CVarVRNetReportInterval(
+	TEXT("vr.NetReportInterval"),
+	GVRNetReportInterval,
+	TEXT("Seconds between per player bandwidth reports on the server, 0 to disable"));
+
+static int32 GVRNetReportCsv = 0;
+static FAutoConsoleVariableRef CVarVRNetReportCsv(
+	TEXT("vr.NetReportCsv"),
+	GVRNetReportCsv,
+	TEXT("1 to also append each periodic report to Saved/Stress/VRServer-<time>.csv, for load tests with bots"));
+
+// Time spent replicating, from the net drivers' TickFlush to PostTickFlush, split over the connections serviced
+static TWeakObjectPtr<UWorld> TimedWorld;
+static FDelegateHandle TickFlushHandle;
+static FDelegateHandle PostTickFlushHandle;
+static double ReplicationStartTime = 0;
+static double IntervalReplicationMs = 0;
+static double IntervalReplicationMsPerConnection = 0;
+static int32 IntervalReplicationFrames = 0;
+
+static int32 CountServicedConnections(UNetDriver* NetDriver)
+{
+	// Replication skips connections without a view target, as ServerReplicateActors does
+	int32 NumServiced = 0;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection && Connection->ViewTarget) { NumServiced++; }
+	}
+	return NumServiced;
+}
+
+static void OnTickFlush(float DeltaSeconds)
+{
+	ReplicationStartTime = FPlatformTime::Seconds();
+}
+
+static void OnPostTickFlush()
+{
+	UWorld* World = TimedWorld.Get();
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	if (!NetDriver || ReplicationStartTime <= 0) { return; }
+	double ReplicationMs = (FPlatformTime::Seconds() - ReplicationStartTime) * 1000;
+	ReplicationStartTime = 0;
+	IntervalReplicationMs += ReplicationMs;
+	IntervalReplicationMsPerConnection += ReplicationMs / FMath::Max(1, CountServicedConnections(NetDriver));
+	IntervalReplicationFrames++;
+}
+
+static void StopTimingReplication()
+{
+	if (UWorld* World = TimedWorld.Get())
+	{
+		World->OnTickFlush().Remove(TickFlushHandle);
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+	TimedWorld = nullptr;
+	TickFlushHandle.Reset();
+	PostTickFlushHandle.Reset();
+}
+
+static void TimeReplication(UWorld* World)
+{
+	if (TimedWorld == World) { return; }
+	StopTimingReplication();
+	TimedWorld = World;
+	// Multicast delegates run the last bound first, so binding after the net driver stamps the start before it replicates
+	TickFlushHandle = World->OnTickFlush().AddStatic(&OnTickFlush);
+	PostTickFlushHandle = World->OnPostTickFlush().AddStatic(&OnPostTickFlush);
+}
+
+static void ReportNetUsage(UWorld* World)
+{
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	if (!NetDriver || !NetDriver->IsServer()) { return; }
+
+	int32 TotalOut = 0, TotalIn = 0;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (!Connection) { continue; }
+		UE_LOG(LogTemp, Display, TEXT("VRNet %s: out %d B/s, in %d B/s, lost out %d in %d, ping %.0f ms"),
+			*GetNameSafe(Connection->PlayerController),
+			Connection->OutBytesPerSecond,
+			Connection->InBytesPerSecond,
+			Connection->OutPacketsLost,
+			Connection->InPacketsLost,
+			Connection->AvgLag * 1000);
+		TotalOut += Connection->OutBytesPerSecond;
+		TotalIn += Connection->InBytesPerSecond;
+	}
+	UE_LOG(LogTemp, Display, TEXT("VRNet total for %d players: out %d B/s, in %d B/s"), NetDriver->ClientConnections.Num(), TotalOut, TotalIn);
+
+	// Server cost of replication, which dormancy and relevancy are meant to keep flat as puzzle actors are added.
+	// Timed from the first report on, vr.NetReportInterval keeps it going
+	TimeReplication(World);
+	int32 NumFrames = FMath::Max(1, IntervalReplicationFrames);
+	UE_LOG(LogTemp, Display, TEXT("VRNet server game thread %.2f ms, replication %.3f ms (%.3f ms per connection), %d active and %d dormant replicated actors"),
+		FPlatformTime::ToMilliseconds(GGameThreadTime),
+		IntervalReplicationMs / NumFrames,
+		IntervalReplicationMsPerConnection / NumFrames,
+		NetDriver->GetNetworkObjectList().GetActiveObjects().Num(),
+		NetDriver->GetNetworkObjectList().GetDormantObjectsOnAllConnections().Num());
+}
+
+static FAutoConsoleCommandWithWorld VRNetReportCommand(
+	TEXT("vr.NetReport"),
+	TEXT("Logs bandwidth per connected player. Run on the server."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&ReportNetUsage));
+
+// The engine only keeps the last frame's game thread time, so the CSV averages it over the interval
+static float IntervalTickMs = 0;
+static float IntervalMaxTickMs = 0;
+static int32 IntervalFrames = 0;
+static FString NetCsvPath;
+
+static void WriteNetCsvRow(UWorld* World)
+{
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	if (!NetDriver || !NetDriver->IsServer()) { return; }
+
+	if (NetCsvPath.IsEmpty())
+	{
+		NetCsvPath = FPaths::ProjectSavedDir() / TEXT("Stress") / FString::Printf(TEXT("VRServer-%s.csv"), *FDateTime::Now().ToString());
+		FFileHelper::SaveStringToFile(TEXT("Seconds,Clients,AvgTickMs,MaxTickMs,OutBytesPerSec,InBytesPerSec,OutBytesPerClient,CpuPct,ReplicationMs,ReplicationMsPerClient,ActiveActors,DormantActors\n"), *NetCsvPath);
+		UE_LOG(LogTemp, Display, TEXT("VRNet writing reports to %s"), *NetCsvPath);
+	}
+
+	int32 TotalOut = 0, TotalIn = 0;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (!Connection) { continue; }
+		TotalOut += Connection->OutBytesPerSecond;
+		TotalIn += Connection->InBytesPerSecond;
+	}
+	int32 NumClients = NetDriver->ClientConnections.Num();
+	int32 PerClient = FMath::Max(1, NumClients);
+	// Of one core, so a busy server can go over 100
+	float CpuPct = FPlatformTime::GetCPUTime().CPUTimePct;
+	int32 NumReplicationFrames = FMath::Max(1, IntervalReplicationFrames);
+	FString Row = FString::Printf(TEXT("%.1f,%d,%.3f,%.3f,%d,%d,%d,%.1f,%.3f,%.4f,%d,%d\n"),
+		World->GetRealTimeSeconds(),
+		NumClients,
+		IntervalFrames > 0 ? IntervalTickMs / IntervalFrames : 0.f,
+		IntervalMaxTickMs,
+		TotalOut,
+		TotalIn,
+		TotalOut / PerClient,
+		CpuPct,
+		IntervalReplicationMs / NumReplicationFrames,
+		IntervalReplicationMsPerConnection / NumReplicationFrames,
+		NetDriver->GetNetworkObjectList().GetActiveObjects().Num(),
+		NetDriver->GetNetworkObjectList().GetDormantObjectsOnAllConnections().Num());
+	FFileHelper::SaveStringToFile(Row, *NetCsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+static float TimeSinceNetReport = 0;
+static FDelegateHandle NetReportTickerHandle;
+
+static bool TickNetReport(float DeltaTime)
+{
+	if (GVRNetReportInterval <= 0 || !GEngine) { return true; }
+	float TickMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	IntervalTickMs += TickMs;
+	IntervalMaxTickMs = FMath::Max(IntervalMaxTickMs, TickMs);
+	IntervalFrames++;
+	TimeSinceNetReport += DeltaTime;
+	if (TimeSinceNetReport < GVRNetReportInterval) { return true; }
+	TimeSinceNetReport = 0;
+
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		if (!Context.World() || !Context.World()->IsGameWorld()) { continue; }
+		ReportNetUsage(Context.World());
+		if (GVRNetReportCsv > 0) { WriteNetCsvRow(Context.World()); }
+	}
+	IntervalTickMs = 0;
+	IntervalMaxTickMs = 0;
+	IntervalFrames = 0;
+	IntervalReplicationMs = 0;
+	IntervalReplicationMsPerConnection = 0;
+	IntervalReplicationFrames = 0;
+	return true;
+}
+
+void StartVRNetReports()
+{
+	NetReportTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickNetReport));
+}
+
+void StopVRNetReports()
+{
+	FTicker::GetCoreTicker().RemoveTicker(NetReportTickerHandle);
+	NetReportTickerHandle.Reset();
+	StopTimingReplication();
+}
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRNetTypes.h"
+
+namespace
+{
+	// Smallest-three components all lie in [-1/sqrt(2), 1/sqrt(2)]
+	const float RotationComponentRange = 0.70710678f;
+	const uint32 RotationComponentMax = (1 << FVRQuantizedTransform::RotationComponentBits) - 1;
+
+	// Small deltas cover normal hand and head movement between two updates
+	const int32 SmallDeltaBits = 8;
+	const int32 SmallDeltaLimit = (1 << (SmallDeltaBits - 1)) - 1;
+
+	void SerializeSignedInt(FArchive& Ar, int32& Value, int32 NumBits)
+	{
+		uint32 Offset = 1 << (NumBits - 1);
+		uint32 Encoded = (uint32)(Value + (int32)Offset);
+		Ar.SerializeInt(Encoded, 1 << NumBits);
+		Value = (int32)Encoded - (int32)Offset;
+	}
+}
+
+void FVRQuantizedTransform::FromTransform(const FTransform& Transform)
+{
+	FVector Location = Transform.GetLocation();
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		Position[Axis] = FMath::Clamp(FMath::RoundToInt(Location[Axis] * 10), -MaxPosition, MaxPosition);
+	}
+
+	FQuat Quat = Transform.GetRotation().GetNormalized();
+	float Components[4] = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+	uint32 Largest = 0;
+	for (uint32 i = 1; i < 4; i++)
+	{
+		if (FMath::Abs(Components[i]) > FMath::Abs(Components[Largest])) { Largest = i; }
+	}
+	// q and -q are the same rotation, so flip to keep the dropped component positive
+	float Sign = Components[Largest] < 0 ? -1.f : 1.f;
+
+	PackedRotation = Largest;
+	uint32 Shift = 2;
+	for (uint32 i = 0; i < 4; i++)
+	{
+		if (i == Largest) { continue; }
+		float Normalised = (Components[i] * Sign / RotationComponentRange + 1.f) * 0.5f;
+		uint32 Quantized = (uint32)FMath::Clamp(FMath::RoundToInt(Normalised * RotationComponentMax), 0, (int32)RotationComponentMax);
+		PackedRotation |= Quantized << Shift;
+		Shift += RotationComponentBits;
+	}
+}
+
+FTransform FVRQuantizedTransform::ToTransform() const
+{
+	FVector Location(Position[0] * 0.1f, Position[1] * 0.1f, Position[2] * 0.1f);
+
+	uint32 Largest = PackedRotation & 3;
+	float Components[4];
+	float SumSquares = 0;
+	uint32 Shift = 2;
+	for (uint32 i = 0; i < 4; i++)
+	{
+		if (i == Largest) { continue; }
+		uint32 Quantized = (PackedRotation >> Shift) & RotationComponentMax;
+		Components[i] = ((float)Quantized / RotationComponentMax * 2.f - 1.f) * RotationComponentRange;
+		SumSquares += Components[i] * Components[i];
+		Shift += RotationComponentBits;
+	}
+	Components[Largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSquares));
+
+	FQuat Quat(Components[0], Components[1], Components[2], Components[3]);
+	Quat.Normalize();
+	return FTransform(Quat, Location);
+}
+
+bool FVRQuantizedTransform::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	for (int32 Axis = 0; Axis < 3; Axis++) { SerializeSignedInt(Ar, Position[Axis], PositionBits); }
+	Ar << PackedRotation;
+	bOutSuccess = true;
+	return true;
+}
+
+FVRPoseDelta FVRPoseDelta::Make(uint16 Sequence, const FVRReplicatedPoses& Current, const FVRReplicatedPoses* Baseline, uint16 BaselineSequence)
+{
+	FVRPoseDelta Delta;
+	Delta.Sequence = Sequence;
+	Delta.bHasBaseline = Baseline != nullptr;
+	Delta.BaselineSequence = BaselineSequence;
+	for (int32 i = 0; i < FVRReplicatedPoses::NumPoses; i++)
+	{
+		const FVRQuantizedTransform& Pose = Current.GetPose(i);
+		if (Baseline && Pose == Baseline->GetPose(i)) { continue; }
+
+		Delta.ChangedMask |= 1 << i;
+		Delta.Poses[i] = Pose;
+		if (Baseline)
+		{
+			for (int32 Axis = 0; Axis < 3; Axis++) { Delta.Poses[i].Position[Axis] -= Baseline->GetPose(i).Position[Axis]; }
+		}
+	}
+	return Delta;
+}
+
+FVRReplicatedPoses FVRPoseDelta::Apply(const FVRReplicatedPoses& Baseline) const
+{
+	FVRReplicatedPoses Result = Baseline;
+	for (int32 i = 0; i < FVRReplicatedPoses::NumPoses; i++)
+	{
+		if (!(ChangedMask & (1 << i))) { continue; }
+
+		FVRQuantizedTransform& Pose = Result.GetPose(i);
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			Pose.Position[Axis] = bHasBaseline ? Pose.Position[Axis] + Poses[i].Position[Axis] : Poses[i].Position[Axis];
+		}
+		Pose.PackedRotation = Poses[i].PackedRotation;
+	}
+	return Result;
+}
+
+bool FVRPoseDelta::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << Sequence;
+	uint8 bBaseline = bHasBaseline;
+	Ar.SerializeBits(&bBaseline, 1);
+	bHasBaseline = bBaseline != 0;
+	if (bHasBaseline) { Ar << BaselineSequence; }
+
+	uint32 Mask = ChangedMask;
+	Ar.SerializeInt(Mask, 1 << FVRReplicatedPoses::NumPoses);
+	ChangedMask = (uint8)Mask;
+
+	for (int32 i = 0; i < FVRReplicatedPoses::NumPoses; i++)
+	{
+		if (!(ChangedMask & (1 << i))) { continue; }
+
+		FVRQuantizedTransform& Pose = Poses[i];
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (!bHasBaseline)
+			{
+				SerializeSignedInt(Ar, Pose.Position[Axis], FVRQuantizedTransform::PositionBits);
+				continue;
+			}
+			uint8 bSmall = FMath::Abs(Pose.Position[Axis]) <= SmallDeltaLimit;
+			Ar.SerializeBits(&bSmall, 1);
+			SerializeSignedInt(Ar, Pose.Position[Axis], bSmall ? SmallDeltaBits : FVRQuantizedTransform::PositionBits + 1);
+		}
+		Ar << Pose.PackedRotation;
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
@@ -2,4 +2,157 @@
 
 
 #include "VRPlayerController.h"
+#include "Camera/CameraComponent.h"
+#include "InputCoreTypes.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformProcess.h"
+#include "VRCharacter.h"
+#include "VRController.h"
 
+namespace
+{
+	// Standing eye height above the floor tracking origin
+	const float BotEyeHeight = 170;
+	// Hands relative to the head, before it turns
+	const FVector BotLeftHandOffset(30, -20, -45);
+	const FVector BotRightHandOffset(30, 20, -45);
+	// Palm up, mirrored on the right hand
+	const float BotFlickRoll = 60;
+}
+
+void AVRPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	bBot = IsLocalController() && FParse::Param(FCommandLine::Get(), TEXT("vrbot"));
+	if (!bBot) { return; }
+	// Every bot process does something different
+	BotRandom.Initialize(FPlatformProcess::GetCurrentProcessId());
+	BotPhase = BotRandom.FRand() * 100;
+	UE_LOG(LogTemp, Display, TEXT("VR bot driving %s"), *GetName());
+}
+
+void AVRPlayerController::PlayerTick(float DeltaTime)
+{
+	// Before Super, which processes the input fed in here
+	if (bBot) { TickBot(DeltaTime); }
+	Super::PlayerTick(DeltaTime);
+}
+
+bool AVRPlayerController::bBotTeleportsLeft(AVRCharacter* Character) const
+{
+	AVRController* Left = Character->GetLeftController();
+	return Left && Left->bCanHandTeleport();
+}
+
+void AVRPlayerController::TickBot(float DeltaTime)
+{
+	AVRCharacter* Character = Cast<AVRCharacter>(GetPawn());
+	if (!Character || !Character->GetLeftController() || !Character->GetRightController()) { return; }
+
+	BotTime += DeltaTime;
+	BotActionTime += DeltaTime;
+	if (BotActionTime >= BotActionLength) { StartBotAction(); }
+
+	TickBotPoses(Character, DeltaTime);
+	TickBotInput(Character, DeltaTime);
+}
+
+void AVRPlayerController::StartBotAction()
+{
+	// Mostly looking around, with an interaction now and then
+	if (BotAction != EVRBotAction::Idle)
+	{
+		BotAction = EVRBotAction::Idle;
+		BotActionLength = BotRandom.FRandRange(BotMinIdleTime, BotMaxIdleTime);
+	}
+	else
+	{
+		BotAction = (EVRBotAction)BotRandom.RandRange((int32)EVRBotAction::Teleport, (int32)EVRBotAction::Grab);
+		const float Lengths[] = { 0, 2, 0.5, 2, 3 };
+		BotActionLength = Lengths[(int32)BotAction];
+		BotTurnDirection = BotRandom.FRand() < 0.5f ? -1 : 1;
+	}
+	BotActionTime = 0;
+}
+
+void AVRPlayerController::TickBotPoses(AVRCharacter* Character, float DeltaTime)
+{
+	UCameraComponent* Camera = Character->FindComponentByClass<UCameraComponent>();
+	if (!Camera) { return; }
+
+	// Slow sway and looking around, roughly what a standing player's head does
+	float T = BotTime + BotPhase;
+	FVector HeadLocation(FMath::Sin(T * 0.7f) * 5, FMath::Sin(T * 0.5f) * 5, BotEyeHeight + FMath::Sin(T * 1.1f) * 2);
+	FRotator HeadRotation(FMath::Sin(T * 0.3f) * 10, FMath::Sin(T * 0.2f) * BotLookYaw, 0);
+	Camera->SetRelativeLocationAndRotation(HeadLocation, HeadRotation);
+
+	// Hands stay in front of the body, drifting a little each
+	FRotator BodyYaw(0, HeadRotation.Yaw, 0);
+	FVector LeftLocation = HeadLocation + BodyYaw.RotateVector(BotLeftHandOffset + FVector(FMath::Sin(T * 1.3f), FMath::Sin(T * 0.9f), FMath::Sin(T * 1.7f)) * 4);
+	FVector RightLocation = HeadLocation + BodyYaw.RotateVector(BotRightHandOffset + FVector(FMath::Sin(T * 1.1f), FMath::Sin(T * 1.5f), FMath::Sin(T * 0.8f)) * 4);
+	FRotator LeftRotation(-20, HeadRotation.Yaw, 0);
+	FRotator RightRotation(-20, HeadRotation.Yaw, 0);
+
+	bool bLeftTeleports = bBotTeleportsLeft(Character);
+	if (BotAction == EVRBotAction::Teleport)
+	{
+		// Aim level, so the arc lands a few metres ahead
+		(bLeftTeleports ? LeftRotation : RightRotation).Pitch = 0;
+	}
+	else if (BotAction == EVRBotAction::Flick)
+	{
+		// The other hand flicks, palm up
+		if (bLeftTeleports) { RightRotation = FRotator(0, HeadRotation.Yaw, -BotFlickRoll); }
+		else { LeftRotation = FRotator(0, HeadRotation.Yaw, BotFlickRoll); }
+	}
+	Character->GetLeftController()->SetActorRelativeLocation(LeftLocation);
+	Character->GetLeftController()->SetActorRelativeRotation(LeftRotation);
+	Character->GetRightController()->SetActorRelativeLocation(RightLocation);
+	Character->GetRightController()->SetActorRelativeRotation(RightRotation);
+}
+
+void AVRPlayerController::TickBotInput(AVRCharacter* Character, float DeltaTime)
+{
+	// The keys AVRCharacter::SetupPlayerInputComponent maps for this teleport hand
+	bool bLeftTeleports = bBotTeleportsLeft(Character);
+	FKey TeleportAxis = bLeftTeleports ? EKeys::OculusTouch_Left_Thumbstick_Y : EKeys::OculusTouch_Right_Thumbstick_Y;
+	FKey TeleportButton = bLeftTeleports ? EKeys::OculusTouch_Left_Thumbstick_Down : EKeys::OculusTouch_Right_Thumbstick_Down;
+	FKey TurnAxis = bLeftTeleports ? EKeys::OculusTouch_Left_Thumbstick_X : EKeys::OculusTouch_Right_Thumbstick_X;
+	FKey Grip = bLeftTeleports ? EKeys::OculusTouch_Right_Grip_Axis : EKeys::OculusTouch_Left_Grip_Axis;
+
+	float Progress = BotActionLength > 0 ? BotActionTime / BotActionLength : 1;
+	float TeleportValue = 0, TurnValue = 0, GripValue = 0;
+	bool bHoldTeleportButton = false;
+	switch (BotAction)
+	{
+	case EVRBotAction::Teleport:
+		// Aim with the stick pressed, then pull it back and let go to go there
+		bHoldTeleportButton = Progress < 0.9f;
+		if (Progress > 0.6f && Progress < 0.8f) { TeleportValue = -1; }
+		break;
+	case EVRBotAction::Turn:
+		if (Progress < 0.5f) { TurnValue = BotTurnDirection; }
+		break;
+	case EVRBotAction::Flick:
+		// Highlight for a second, then grip to flick and let go
+		if (Progress > 0.5f && Progress < 0.8f) { GripValue = 1; }
+		break;
+	case EVRBotAction::Grab:
+		if (Progress < 0.8f) { GripValue = 1; }
+		break;
+	default:
+		break;
+	}
+
+	if (bHoldTeleportButton != bBotTeleportPressed)
+	{
+		InputKey(TeleportButton, bHoldTeleportButton ? IE_Pressed : IE_Released, bHoldTeleportButton ? 1 : 0, true);
+		bBotTeleportPressed = bHoldTeleportButton;
+	}
+	// Axes are sent every frame, as a real controller does
+	InputAxis(TeleportAxis, TeleportValue, DeltaTime, 1, true);
+	InputAxis(TurnAxis, TurnValue, DeltaTime, 1, true);
+	InputAxis(Grip, GripValue, DeltaTime, 1, true);
+}
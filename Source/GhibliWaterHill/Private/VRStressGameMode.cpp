@@ -0,0 +1,348 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRStressGameMode.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMisc.h"
+#include "PhysicsPropActivitySubsystem.h"
+#include "VRCharacter.h"
+#include "VRController.h"
+#include "Lever.h"
+#include "Bridge.h"
+#include "Keycard.h"
+#include "KeycardReader.h"
+#include "Door.h"
+#include "VRLatency.h"
+
+AVRStressGameMode::AVRStressGameMode()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AVRStressGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	if (UClass* Pawn = StressPawnClass.LoadSynchronous()) { DefaultPawnClass = Pawn; }
+	if (UClass* PlayerController = StressPlayerControllerClass.LoadSynchronous()) { PlayerControllerClass = PlayerController; }
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	NumProps = FMath::Max(0, UGameplayStatics::GetIntOption(Options, TEXT("Props"), NumProps));
+	NumLevers = FMath::Max(0, UGameplayStatics::GetIntOption(Options, TEXT("Levers"), NumLevers));
+	NumChains = FMath::Max(0, UGameplayStatics::GetIntOption(Options, TEXT("Chains"), NumChains));
+	NumRooms = FMath::Max(1, UGameplayStatics::GetIntOption(Options, TEXT("Rooms"), NumRooms));
+	NumSteps = FMath::Max(1, UGameplayStatics::GetIntOption(Options, TEXT("Steps"), NumSteps));
+	bWalls = UGameplayStatics::GetIntOption(Options, TEXT("Walls"), 1) != 0;
+	bExitWhenDone = UGameplayStatics::GetIntOption(Options, TEXT("Exit"), 1) != 0;
+	bLineLayout = UGameplayStatics::ParseOption(Options, TEXT("Layout")) == TEXT("Line");
+	Random.Initialize(UGameplayStatics::GetIntOption(Options, TEXT("Seed"), 1));
+
+	FString SweepOption = UGameplayStatics::ParseOption(Options, TEXT("Sweep"));
+	if (SweepOption == TEXT("None")) { Sweep = EStressSweep::None; }
+	else if (SweepOption == TEXT("All")) { Sweep = EStressSweep::All; }
+	BuildSteps();
+}
+
+void AVRStressGameMode::BuildSteps()
+{
+	auto AddStep = [this](const TCHAR* Dimension, int32 Props, int32 Levers, int32 Chains)
+	{
+		FStressStep& Step = Steps.AddDefaulted_GetRef();
+		Step.Dimension = Dimension;
+		Step.Props = Props;
+		Step.Levers = Levers;
+		Step.Chains = Chains;
+	};
+
+	if (Sweep == EStressSweep::None)
+	{
+		AddStep(TEXT("Fixed"), NumProps, NumLevers, NumChains);
+		return;
+	}
+	if (Sweep == EStressSweep::All)
+	{
+		for (int32 i = 1; i <= NumSteps; i++) { AddStep(TEXT("All"), NumProps * i / NumSteps, NumLevers * i / NumSteps, NumChains * i / NumSteps); }
+		return;
+	}
+
+	AddStep(TEXT("Baseline"), 0, 0, 0);
+	for (int32 i = 1; i <= NumSteps && NumProps > 0; i++) { AddStep(TEXT("Props"), NumProps * i / NumSteps, 0, 0); }
+	for (int32 i = 1; i <= NumSteps && NumLevers > 0; i++) { AddStep(TEXT("Levers"), 0, NumLevers * i / NumSteps, 0); }
+	for (int32 i = 1; i <= NumSteps && NumChains > 0; i++) { AddStep(TEXT("Chains"), 0, 0, NumChains * i / NumSteps); }
+}
+
+void AVRStressGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	BuildRooms();
+	CsvPath = FPaths::ProjectSavedDir() / TEXT("Stress") / FString::Printf(TEXT("VRStress-%s.csv"), *FDateTime::Now().ToString());
+	Csv = TEXT("Dimension,Props,Levers,Chains,Rooms,Frames,AvgMs,P50Ms,P95Ms,MaxMs,ArcLatencyP50Ms,ArcLatencyP95Ms,FlickLatencyP50Ms,FlickLatencyP95Ms,HeldLatencyP50Ms,HeldLatencyP95Ms\n");
+	UE_LOG(LogTemp, Display, TEXT("VR stress test: %d steps over %d rooms, writing %s"), Steps.Num(), NumRooms, *CsvPath);
+	StartStep(0);
+}
+
+FVector AVRStressGameMode::GetRoomLocation(int32 Room) const
+{
+	if (bLineLayout) { return RoomOrigin + FVector(Room * RoomSize, 0, 0); }
+	int32 Columns = FMath::CeilToInt(FMath::Sqrt((float)NumRooms));
+	return RoomOrigin + FVector((Room % Columns) * RoomSize, (Room / Columns) * RoomSize, 0);
+}
+
+FVector AVRStressGameMode::GetSpawnLocation(int32 Index)
+{
+	// Round robin over the rooms, anywhere but right up against the walls
+	FVector Offset(Random.FRandRange(-0.4f, 0.4f) * RoomSize, Random.FRandRange(-0.4f, 0.4f) * RoomSize, 0);
+	return GetRoomLocation(Index % NumRooms) + Offset;
+}
+
+AStaticMeshActor* AVRStressGameMode::SpawnCube(const FVector& Location, const FVector& Scale, bool bSimulate)
+{
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!ensure(Cube)) { return nullptr; }
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AStaticMeshActor* Actor = GetWorld()->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator, SpawnParams);
+	if (!Actor) { return nullptr; }
+	// Static meshes can't be changed once play has started
+	UStaticMeshComponent* Mesh = Actor->GetStaticMeshComponent();
+	Mesh->SetMobility(EComponentMobility::Movable);
+	Mesh->SetStaticMesh(Cube);
+	Mesh->SetWorldScale3D(Scale);
+	Mesh->SetSimulatePhysics(bSimulate);
+	return Actor;
+}
+
+void AVRStressGameMode::BuildRooms()
+{
+	// The engine cube is 100 units across
+	float Tiles = RoomSize / 100;
+	for (int32 Room = 0; Room < NumRooms; Room++)
+	{
+		FVector Center = GetRoomLocation(Room);
+		SpawnCube(Center - FVector(0, 0, 25), FVector(Tiles, Tiles, 0.5f), false);
+		if (!bWalls) { continue; }
+		float Half = RoomSize / 2;
+		SpawnCube(Center + FVector(Half, 0, 150), FVector(0.5f, Tiles, 3), false);
+		SpawnCube(Center + FVector(-Half, 0, 150), FVector(0.5f, Tiles, 3), false);
+		SpawnCube(Center + FVector(0, Half, 150), FVector(Tiles, 0.5f, 3), false);
+		SpawnCube(Center + FVector(0, -Half, 150), FVector(Tiles, 0.5f, 3), false);
+	}
+}
+
+void AVRStressGameMode::StartStep(int32 Index)
+{
+	CurrentStep = Index;
+	StepTime = 0;
+	LastFrameSeconds = 0;
+	FrameTimesMs.Reset();
+	const FStressStep& Step = Steps[Index];
+	UWorld* World = GetWorld();
+	int32 SpawnIndex = 0;
+
+	UPhysicsPropActivitySubsystem* Activity = World->GetSubsystem<UPhysicsPropActivitySubsystem>();
+	for (int32 i = 0; i < Step.Props; i++)
+	{
+		AStaticMeshActor* Prop = SpawnCube(GetSpawnLocation(SpawnIndex++) + FVector(0, 0, 100), FVector(0.2f), true);
+		if (!Prop) { continue; }
+		StepActors.Add(Prop);
+		StepProps.Add(Prop->GetStaticMeshComponent());
+		if (Activity) { Activity->RegisterProp(Prop->GetStaticMeshComponent()); }
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	UClass* LoadedLeverClass = LeverClass.LoadSynchronous();
+	UClass* LoadedBridgeClass = BridgeClass.LoadSynchronous();
+	if (Step.Levers > 0 && (!LoadedLeverClass || !LoadedBridgeClass)) { UE_LOG(LogTemp, Warning, TEXT("VR stress test: LeverClass or BridgeClass isn't set, skipping levers")); }
+	for (int32 i = 0; i < Step.Levers && LoadedLeverClass && LoadedBridgeClass; i++)
+	{
+		FVector Location = GetSpawnLocation(SpawnIndex++);
+		ALever* Lever = World->SpawnActor<ALever>(LoadedLeverClass, Location, FRotator::ZeroRotator, SpawnParams);
+		// The link has to be there before the bridge's BeginPlay
+		FTransform BridgeTransform(Location + FVector(400, 0, 0));
+		ABridge* Bridge = World->SpawnActorDeferred<ABridge>(LoadedBridgeClass, BridgeTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (!Lever || !Bridge) { continue; }
+		Bridge->SetLinkedLever(Lever);
+		Bridge->FinishSpawning(BridgeTransform);
+		StepActors.Add(Lever);
+		StepActors.Add(Bridge);
+
+		FStressLever& Entry = Levers.AddDefaulted_GetRef();
+		Entry.Lever = Lever;
+		Entry.Phase = Random.FRand() * LeverPeriod;
+	}
+
+	UClass* LoadedKeycardClass = KeycardClass.LoadSynchronous();
+	UClass* LoadedReaderClass = KeycardReaderClass.LoadSynchronous();
+	UClass* LoadedDoorClass = DoorClass.LoadSynchronous();
+	bool bChainClasses = LoadedKeycardClass && LoadedReaderClass && LoadedDoorClass;
+	if (Step.Chains > 0 && !bChainClasses) { UE_LOG(LogTemp, Warning, TEXT("VR stress test: KeycardClass, KeycardReaderClass or DoorClass isn't set, skipping chains")); }
+	for (int32 i = 0; i < Step.Chains && bChainClasses; i++)
+	{
+		FVector Location = GetSpawnLocation(SpawnIndex++);
+		// The reader locks its door in BeginPlay, so the door has to be playing first
+		ADoor* Door = World->SpawnActor<ADoor>(LoadedDoorClass, Location + FVector(0, 400, 0), FRotator::ZeroRotator, SpawnParams);
+		FVector RestLocation = Location + FVector(0, -150, 50);
+		AKeycard* Keycard = World->SpawnActor<AKeycard>(LoadedKeycardClass, RestLocation, FRotator::ZeroRotator, SpawnParams);
+		FTransform ReaderTransform(Location + FVector(0, 0, 100));
+		AKeycardReader* Reader = World->SpawnActorDeferred<AKeycardReader>(LoadedReaderClass, ReaderTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (!Door || !Keycard || !Reader) { continue; }
+		Reader->SetLinks(Door, Keycard);
+		Reader->FinishSpawning(ReaderTransform);
+		StepActors.Add(Door);
+		StepActors.Add(Keycard);
+		StepActors.Add(Reader);
+
+		FStressChain& Chain = Chains.AddDefaulted_GetRef();
+		Chain.Keycard = Keycard;
+		Chain.Reader = Reader;
+		Chain.RestLocation = RestLocation;
+		Chain.Phase = Random.FRand() * KeycardPeriod;
+	}
+}
+
+void AVRStressGameMode::ClearStep()
+{
+	AVRCharacter* Character = Cast<AVRCharacter>(UGameplayStatics::GetPlayerPawn(this, 0));
+	if (bHandGrabbing && Character && Character->GetRightController()) { Character->GetRightController()->ReleaseGrab(); }
+	bHandGrabbing = false;
+
+	if (UPhysicsPropActivitySubsystem* Activity = GetWorld()->GetSubsystem<UPhysicsPropActivitySubsystem>())
+	{
+		for (UStaticMeshComponent* Prop : StepProps) { Activity->UnregisterProp(Prop); }
+	}
+	for (AActor* Actor : StepActors)
+	{
+		if (Actor) { Actor->Destroy(); }
+	}
+	StepActors.Reset();
+	StepProps.Reset();
+	Levers.Reset();
+	Chains.Reset();
+}
+
+void AVRStressGameMode::FinishStep()
+{
+	const FStressStep& Step = Steps[CurrentStep];
+	float AverageMs = 0, P50Ms = 0, P95Ms = 0, MaxMs = 0;
+	if (FrameTimesMs.Num() > 0)
+	{
+		FrameTimesMs.Sort();
+		for (float FrameMs : FrameTimesMs) { AverageMs += FrameMs; }
+		AverageMs /= FrameTimesMs.Num();
+		P50Ms = FrameTimesMs[FrameTimesMs.Num() / 2];
+		P95Ms = FrameTimesMs[FMath::Min(FrameTimesMs.Num() - 1, FrameTimesMs.Num() * 95 / 100)];
+		MaxMs = FrameTimesMs.Last();
+	}
+
+	FString Row = FString::Printf(TEXT("%s,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f"),
+		*Step.Dimension, Step.Props, Step.Levers, Step.Chains, NumRooms, FrameTimesMs.Num(), AverageMs, P50Ms, P95Ms, MaxMs);
+	// Motion to photon over the measured part of the step, simulated frame timing when headless
+	for (int32 Mechanic = 0; Mechanic < (int32)EVRLatencyMechanic::Count; Mechanic++)
+	{
+		const FVRLatencyHistogram& Histogram = FVRLatency::Get().GetHistogram((EVRLatencyMechanic)Mechanic);
+		Row += FString::Printf(TEXT(",%.1f,%.1f"), Histogram.GetPercentileMs(0.5f), Histogram.GetPercentileMs(0.95f));
+	}
+	UE_LOG(LogTemp, Display, TEXT("VR stress step %d/%d: %s"), CurrentStep + 1, Steps.Num(), *Row);
+	// Written after every step so a crash part way still leaves the curve so far
+	Csv += Row + TEXT("\n");
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+
+	ClearStep();
+	if (CurrentStep + 1 < Steps.Num())
+	{
+		StartStep(CurrentStep + 1);
+		return;
+	}
+	CurrentStep = INDEX_NONE;
+	UE_LOG(LogTemp, Display, TEXT("VR stress test done, results in %s"), *CsvPath);
+	if (bExitWhenDone) { FPlatformMisc::RequestExit(false); }
+}
+
+void AVRStressGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	if (CurrentStep == INDEX_NONE) { return; }
+
+	// Wall clock, as headless runs may be on a fixed delta time
+	double NowSeconds = FPlatformTime::Seconds();
+	float FrameMs = LastFrameSeconds > 0 ? (NowSeconds - LastFrameSeconds) * 1000 : 0;
+	LastFrameSeconds = NowSeconds;
+
+	TickScriptedInput(DeltaSeconds);
+
+	if (StepTime <= WarmupTime && StepTime + DeltaSeconds > WarmupTime) { FVRLatency::Get().Reset(); }
+	StepTime += DeltaSeconds;
+	if (StepTime > WarmupTime && FrameMs > 0) { FrameTimesMs.Add(FrameMs); }
+	if (StepTime >= WarmupTime + MeasureTime) { FinishStep(); }
+}
+
+void AVRStressGameMode::TickScriptedInput(float DeltaSeconds)
+{
+	ScriptTime += DeltaSeconds;
+
+	AVRCharacter* Character = Cast<AVRCharacter>(UGameplayStatics::GetPlayerPawn(this, 0));
+	if (Character && !bPawnPlaced)
+	{
+		Character->SetActorLocation(GetRoomLocation(0) + FVector(0, 0, 200), false, nullptr, ETeleportType::TeleportPhysics);
+		bPawnPlaced = true;
+	}
+	if (Character) { TickHands(Character, DeltaSeconds); }
+
+	// Levers swing all the way each way, so their bridges follow them
+	for (const FStressLever& Entry : Levers)
+	{
+		if (ALever* Lever = Entry.Lever.Get()) { Lever->RestoreRodScale(FMath::Sin(2 * PI * (ScriptTime + Entry.Phase) / LeverPeriod)); }
+	}
+
+	// Keycards spend half of each period in their reader, which is locked again when they come out
+	for (FStressChain& Chain : Chains)
+	{
+		AKeycard* Keycard = Chain.Keycard.Get();
+		AKeycardReader* Reader = Chain.Reader.Get();
+		if (!Keycard || !Reader) { continue; }
+		bool bInsert = FMath::Fmod(ScriptTime + Chain.Phase, KeycardPeriod) < KeycardPeriod / 2;
+		if (bInsert == Chain.bInserted) { continue; }
+		Chain.bInserted = bInsert;
+		Keycard->SetActorLocation(bInsert ? Reader->GetDetectLocation() : Chain.RestLocation, false, nullptr, ETeleportType::TeleportPhysics);
+		if (!bInsert) { Reader->RestoreLocked(true); }
+	}
+}
+
+void AVRStressGameMode::TickHands(AVRCharacter* Character, float DeltaSeconds)
+{
+	AVRController* Left = Character->GetLeftController();
+	AVRController* Right = Character->GetRightController();
+	if (!Left || !Right) { return; }
+
+	// Half of each period with both palms up, which highlights flick targets, the other half holding a prop
+	bool bFlickPhase = FMath::Fmod(ScriptTime, HandPeriod) < HandPeriod / 2;
+	if (bFlickPhase && bHandGrabbing)
+	{
+		Right->ReleaseGrab();
+		bHandGrabbing = false;
+	}
+	// Keep both hands drifting like a player's would, since a hand that holds still starts no latency traces.
+	// Only the yaw sways, so the palm up roll still counts as a flick
+	float T = ScriptTime;
+	FVector LeftSway = FVector(FMath::Sin(T * 1.3f), FMath::Sin(T * 0.9f), FMath::Sin(T * 1.7f)) * 4;
+	FVector RightSway = FVector(FMath::Sin(T * 1.1f), FMath::Sin(T * 1.5f), FMath::Sin(T * 0.8f)) * 4;
+	Left->SetActorRelativeLocationAndRotation(FVector(30, -20, 0) + LeftSway, FRotator(0, FMath::Sin(T * 0.7f) * 10, bFlickPhase ? 60 : 0));
+	Right->SetActorRelativeLocationAndRotation(FVector(30, 20, 0) + RightSway, FRotator(0, FMath::Sin(T * 0.6f) * 10, bFlickPhase ? -60 : 0));
+
+	if (!bFlickPhase && !bHandGrabbing && StepProps.Num() > 0)
+	{
+		// Put a prop in the hand so TryGrab has something to find
+		UStaticMeshComponent* Prop = StepProps[Random.RandRange(0, StepProps.Num() - 1)];
+		if (!Prop) { return; }
+		Prop->SetWorldLocation(Right->GetActorLocation(), false, nullptr, ETeleportType::TeleportPhysics);
+		Right->TryGrab();
+		bHandGrabbing = true;
+	}
+}
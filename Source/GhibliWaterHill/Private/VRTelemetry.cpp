@@ -0,0 +1,217 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRTelemetry.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "CoreGlobals.h"
+
+static int32 GVRTelemetry = 0;
+static FAutoConsoleVariableRef CVarVRTelemetry(
+	TEXT("vr.Telemetry"),
+	GVRTelemetry,
+	TEXT("1 to record session telemetry to Saved/Telemetry in game, 2 to record in the editor as well, 0 to stop. Off unless set in [SystemSettings] or with -ExecCmds"));
+
+static int32 GVRTelemetryMaxMB = 256;
+static FAutoConsoleVariableRef CVarVRTelemetryMaxMB(
+	TEXT("vr.TelemetryMaxMB"),
+	GVRTelemetryMaxMB,
+	TEXT("The session file stops growing past this many megabytes, hitch reports are still written"));
+
+static float GVRTelemetryHitchMs = 22.2f;
+static FAutoConsoleVariableRef CVarVRTelemetryHitchMs(
+	TEXT("vr.TelemetryHitchMs"),
+	GVRTelemetryHitchMs,
+	TEXT("Frames longer than this write a hitch report, two frames at 90 Hz by default"));
+
+static float GVRTelemetryHitchWindow = 5;
+static FAutoConsoleVariableRef CVarVRTelemetryHitchWindow(
+	TEXT("vr.TelemetryHitchWindow"),
+	GVRTelemetryHitchWindow,
+	TEXT("Seconds of telemetry before a hitch that go in its report"));
+
+namespace
+{
+	const uint32 TelemetryMagic = 0x4C545256; // "VRTL"
+	const uint32 TelemetryVersion = 1;
+	const int32 MaxHitchReports = 32;
+
+	struct FTelemetryFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		double SecondsPerCycle;
+	};
+
+	IFileHandle* OpenTelemetryFile(const FString& Path)
+	{
+		IFileHandle* File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path);
+		if (!File)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Couldn't open %s for telemetry"), *Path);
+			return nullptr;
+		}
+		FTelemetryFileHeader Header = { TelemetryMagic, TelemetryVersion, FPlatformTime::GetSecondsPerCycle64() };
+		File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+		return File;
+	}
+}
+
+/** Drains the ring on its own thread, everything that touches the disk happens here */
+class FVRTelemetryWriter : public FRunnable
+{
+public:
+	FVRTelemetryWriter(FVRTelemetry& InTelemetry, const FString& InDirectory, const FString& InSessionName)
+		: Telemetry(InTelemetry)
+		, Directory(InDirectory)
+		, SessionName(InSessionName)
+	{
+	}
+
+	virtual uint32 Run() override
+	{
+		SessionFile = OpenTelemetryFile(Directory / SessionName + TEXT(".vrtl"));
+		double LastFlushTime = FPlatformTime::Seconds();
+		while (!bStopping)
+		{
+			if (Drain() == 0) { FPlatformProcess::Sleep(0.005f); }
+			if (SessionFile && SessionFile->Tell() > (int64)GVRTelemetryMaxMB * 1024 * 1024)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Telemetry session %s reached vr.TelemetryMaxMB, no longer writing it"), *SessionName);
+				delete SessionFile;
+				SessionFile = nullptr;
+			}
+			if (SessionFile && FPlatformTime::Seconds() - LastFlushTime > 1)
+			{
+				SessionFile->Flush();
+				LastFlushTime = FPlatformTime::Seconds();
+			}
+		}
+		Drain();
+		delete SessionFile;
+		SessionFile = nullptr;
+		return 0;
+	}
+
+	virtual void Stop() override { bStopping = true; }
+
+private:
+	FVRTelemetry& Telemetry;
+	FString Directory;
+	FString SessionName;
+	IFileHandle* SessionFile = nullptr;
+	FThreadSafeBool bStopping = false;
+
+	TArray<FVRTelemetryRecord> Batch;
+	// The last vr.TelemetryHitchWindow seconds, from HistoryStart on
+	TArray<FVRTelemetryRecord> History;
+	int32 HistoryStart = 0;
+	int32 NumHitchReports = 0;
+
+	int32 Drain()
+	{
+		uint32 Read = Telemetry.ReadIndex.load(std::memory_order_relaxed);
+		uint32 Write = Telemetry.WriteIndex.load(std::memory_order_acquire);
+		Batch.Reset();
+		for (uint32 i = Read; i != Write; i++) { Batch.Add(Telemetry.Ring[i & (FVRTelemetry::RingSize - 1)]); }
+		// Copied out, the game thread can have the slots back
+		Telemetry.ReadIndex.store(Write, std::memory_order_release);
+
+		uint32 Dropped = Telemetry.DroppedCount.exchange(0, std::memory_order_relaxed);
+		if (Dropped > 0) { Batch.Add({ FPlatformTime::Cycles64(), (float)Dropped, EVRTelemetryEvent::Dropped }); }
+		if (Batch.Num() == 0) { return 0; }
+
+		if (SessionFile) { SessionFile->Write(reinterpret_cast<const uint8*>(Batch.GetData()), Batch.Num() * sizeof(FVRTelemetryRecord)); }
+		for (const FVRTelemetryRecord& Record : Batch)
+		{
+			History.Add(Record);
+			if (Record.Type == EVRTelemetryEvent::FrameTime && Record.Value > GVRTelemetryHitchMs) { WriteHitchReport(Record); }
+		}
+		TrimHistory();
+		return Batch.Num();
+	}
+
+	void TrimHistory()
+	{
+		if (History.Num() == 0) { return; }
+		uint64 WindowCycles = (uint64)(GVRTelemetryHitchWindow / FPlatformTime::GetSecondsPerCycle64());
+		uint64 Newest = History.Last().Cycles;
+		while (HistoryStart < History.Num() && Newest - History[HistoryStart].Cycles > WindowCycles) { HistoryStart++; }
+		// Compacted now and again rather than removing from the front every batch
+		if (HistoryStart > History.Num() / 2)
+		{
+			History.RemoveAt(0, HistoryStart, false);
+			HistoryStart = 0;
+		}
+	}
+
+	void WriteHitchReport(const FVRTelemetryRecord& Hitch)
+	{
+		if (NumHitchReports >= MaxHitchReports) { return; }
+		TrimHistory();
+		FString Path = Directory / FString::Printf(TEXT("%s-Hitch%02d.vrtl"), *SessionName, NumHitchReports++);
+		if (IFileHandle* File = OpenTelemetryFile(Path))
+		{
+			File->Write(reinterpret_cast<const uint8*>(History.GetData() + HistoryStart), (History.Num() - HistoryStart) * sizeof(FVRTelemetryRecord));
+			delete File;
+		}
+		UE_LOG(LogTemp, Warning, TEXT("%.1f ms frame, wrote the last %.0f s of telemetry to %s"), Hitch.Value, GVRTelemetryHitchWindow, *Path);
+	}
+};
+
+FVRTelemetry& FVRTelemetry::Get()
+{
+	static FVRTelemetry Telemetry;
+	return Telemetry;
+}
+
+void FVRTelemetry::Start()
+{
+	if (bRecording) { return; }
+	FString Directory = FPaths::ProjectSavedDir() / TEXT("Telemetry");
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+	FString SessionName = TEXT("Session-") + FDateTime::Now().ToString();
+
+	Writer = new FVRTelemetryWriter(*this, Directory, SessionName);
+	WriterThread = FRunnableThread::Create(Writer, TEXT("VRTelemetryWriter"), 0, TPri_BelowNormal);
+	if (!WriterThread)
+	{
+		delete Writer;
+		Writer = nullptr;
+		return;
+	}
+	bRecording = true;
+	UE_LOG(LogTemp, Log, TEXT("Recording telemetry to %s"), *(Directory / SessionName));
+}
+
+void FVRTelemetry::Stop()
+{
+	if (!bRecording) { return; }
+	bRecording = false;
+	// Kill waits for the thread, which drains what is left before exiting
+	WriterThread->Kill(true);
+	delete WriterThread;
+	delete Writer;
+	WriterThread = nullptr;
+	Writer = nullptr;
+}
+
+void FVRTelemetry::RecordFrame()
+{
+	bool bWanted = (GVRTelemetry > 1 || (GVRTelemetry == 1 && !GIsEditor)) && FPlatformProcess::SupportsMultithreading();
+	if (bWanted != bRecording)
+	{
+		if (bWanted) { Start(); }
+		else { Stop(); }
+	}
+	if (!bRecording) { return; }
+	Record(EVRTelemetryEvent::FrameTime, (float)(FApp::GetDeltaTime() * 1000));
+	Record(EVRTelemetryEvent::GameThreadTime, FPlatformTime::ToMilliseconds(GGameThreadTime));
+}
@@ -0,0 +1,249 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VRWorkSchedulerSubsystem.h"
+#include "GhibliWaterHill.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Work Scheduler"), STAT_WorkScheduler, STATGROUP_VRInteraction);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Work Budget Used (ms)"), STAT_WorkBudgetUsed, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Work Deferred"), STAT_WorkDeferred, STATGROUP_VRInteraction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Work Forced"), STAT_WorkForced, STATGROUP_VRInteraction);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frames Over Work Budget"), STAT_WorkFramesOverBudget, STATGROUP_VRInteraction);
+
+static float GVRWorkBudgetMs = 0;
+static FAutoConsoleVariableRef CVarVRWorkBudgetMs(
+	TEXT("vr.WorkBudgetMs"),
+	GVRWorkBudgetMs,
+	TEXT("Overrides the interaction work budget per frame in milliseconds, 0 uses BudgetMs from the config"));
+
+static int32 GVRWorkScheduler = 1;
+static FAutoConsoleVariableRef CVarVRWorkScheduler(
+	TEXT("vr.WorkScheduler"),
+	GVRWorkScheduler,
+	TEXT("1 to keep interaction work within vr.WorkBudgetMs, 0 to run all requested work every frame"));
+
+namespace
+{
+	const FName StressWorkName(TEXT("WorkStress"));
+}
+
+bool UVRWorkSchedulerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UVRWorkSchedulerSubsystem::Deinitialize()
+{
+	Items.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UVRWorkSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVRWorkSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+int32 UVRWorkSchedulerSubsystem::RegisterWork(UObject* Owner, FName Name, EVRWorkPriority Priority, float EstimatedCostMs, TFunction<void(float)> Work, bool bEveryFrame)
+{
+	if (!ensure(Owner && Work)) { return INDEX_NONE; }
+
+	FWorkItem& Item = Items.AddDefaulted_GetRef();
+	Item.Handle = NextHandle++;
+	Item.Name = Name;
+	Item.Owner = Owner;
+	Item.Priority = Priority;
+	Item.EstimatedCostMs = EstimatedCostMs;
+	Item.Work = MoveTemp(Work);
+	Item.bEveryFrame = bEveryFrame;
+	return Item.Handle;
+}
+
+void UVRWorkSchedulerSubsystem::UnregisterWork(int32 Handle)
+{
+	// Only marked here, as this can be called from inside running work. Tick removes it
+	if (FWorkItem* Item = FindItem(Handle)) { Item->Handle = INDEX_NONE; }
+}
+
+UVRWorkSchedulerSubsystem::FWorkItem* UVRWorkSchedulerSubsystem::FindItem(int32 Handle)
+{
+	if (Handle == INDEX_NONE) { return nullptr; }
+	for (FWorkItem& Item : Items)
+	{
+		if (Item.Handle == Handle) { return Item.Owner.IsValid() ? &Item : nullptr; }
+	}
+	return nullptr;
+}
+
+bool UVRWorkSchedulerSubsystem::RequestWork(int32 Handle)
+{
+	FWorkItem* Item = FindItem(Handle);
+	if (!Item) { return false; }
+	if (Item->Priority != EVRWorkPriority::Critical)
+	{
+		Item->bRequested = true;
+		return true;
+	}
+
+	if (CriticalFrame != GFrameCounter)
+	{
+		CriticalFrame = GFrameCounter;
+		CriticalMs = 0;
+	}
+	CriticalMs += RunItem(*Item);
+	return true;
+}
+
+float UVRWorkSchedulerSubsystem::GetBudgetMs() const
+{
+	if (GVRWorkScheduler == 0) { return MAX_flt; }
+	return GVRWorkBudgetMs > 0 ? GVRWorkBudgetMs : BudgetMs;
+}
+
+float UVRWorkSchedulerSubsystem::RunItem(FWorkItem& Item)
+{
+	float Now = GetWorld()->GetTimeSeconds();
+	float DeltaTime = Item.LastRunTime < 0 ? GetWorld()->GetDeltaSeconds() : Now - Item.LastRunTime;
+	int32 Handle = Item.Handle;
+	Item.LastRunTime = Now;
+	Item.bRequested = false;
+	Item.FramesDeferred = 0;
+	Item.Runs++;
+
+	double StartTime = FPlatformTime::Seconds();
+	Item.Work(DeltaTime);
+	float CostMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+	// The work may have registered more, so Item can't be trusted any more
+	if (FWorkItem* Ran = FindItem(Handle)) { Ran->EstimatedCostMs = FMath::Lerp(Ran->EstimatedCostMs, CostMs, CostSmoothing); }
+	return CostMs;
+}
+
+void UVRWorkSchedulerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WorkScheduler);
+	Items.RemoveAll([](const FWorkItem& Item) { return Item.Handle == INDEX_NONE || !Item.Owner.IsValid(); });
+
+	struct FQueuedWork
+	{
+		int32 Handle;
+		bool bForced;
+		EVRWorkPriority Priority;
+		int32 FramesDeferred;
+	};
+	TArray<FQueuedWork, TInlineAllocator<32>> Queue;
+	for (FWorkItem& Item : Items)
+	{
+		if (Item.bEveryFrame) { Item.bRequested = true; }
+		if (!Item.bRequested) { continue; }
+		bool bForced = Item.Priority == EVRWorkPriority::Critical || Item.FramesDeferred >= MaxDeferredFrames;
+		Queue.Add({ Item.Handle, bForced, Item.Priority, Item.FramesDeferred });
+	}
+	// Starved work first, then by priority, then whatever has waited longest
+	Queue.Sort([](const FQueuedWork& A, const FQueuedWork& B)
+	{
+		if (A.bForced != B.bForced) { return A.bForced; }
+		if (A.Priority != B.Priority) { return A.Priority < B.Priority; }
+		return A.FramesDeferred > B.FramesDeferred;
+	});
+
+	float Budget = GetBudgetMs();
+	float SpentMs = CriticalFrame == GFrameCounter ? CriticalMs : 0;
+	int32 NumDeferred = 0, NumForced = 0;
+	for (const FQueuedWork& Queued : Queue)
+	{
+		FWorkItem* Item = FindItem(Queued.Handle);
+		if (!Item) { continue; }
+		if (!Queued.bForced && SpentMs + Item->EstimatedCostMs > Budget)
+		{
+			// Stays requested, so it is queued again next frame
+			Item->FramesDeferred++;
+			Item->Deferrals++;
+			NumDeferred++;
+			continue;
+		}
+		if (Queued.bForced && Item->Priority != EVRWorkPriority::Critical)
+		{
+			Item->ForcedRuns++;
+			NumForced++;
+		}
+		SpentMs += RunItem(*Item);
+	}
+
+	FramesScheduled++;
+	WorstFrameMs = FMath::Max(WorstFrameMs, SpentMs);
+	if (SpentMs > Budget)
+	{
+		FramesOverBudget++;
+		INC_DWORD_STAT(STAT_WorkFramesOverBudget);
+	}
+	INC_FLOAT_STAT_BY(STAT_WorkBudgetUsed, SpentMs);
+	INC_DWORD_STAT_BY(STAT_WorkDeferred, NumDeferred);
+	INC_DWORD_STAT_BY(STAT_WorkForced, NumForced);
+}
+
+void UVRWorkSchedulerSubsystem::LogReport() const
+{
+	float Budget = GetBudgetMs();
+	UE_LOG(LogTemp, Display, TEXT("Work scheduler: %d of %d frames over the %.2f ms budget (%.1f%%), worst frame %.2f ms"),
+		FramesOverBudget, FramesScheduled, Budget, FramesScheduled > 0 ? 100.f * FramesOverBudget / FramesScheduled : 0.f, WorstFrameMs);
+	for (const FWorkItem& Item : Items)
+	{
+		if (Item.Handle == INDEX_NONE) { continue; }
+		UE_LOG(LogTemp, Display, TEXT("  %s (%s): %.3f ms estimated, %d runs, %d deferrals, %d forced by the starvation guard"),
+			*Item.Name.ToString(), *UEnum::GetValueAsString(Item.Priority), Item.EstimatedCostMs, Item.Runs, Item.Deferrals, Item.ForcedRuns);
+	}
+}
+
+void UVRWorkSchedulerSubsystem::SetStressLoad(int32 Count, float CostMs)
+{
+	for (FWorkItem& Item : Items)
+	{
+		if (Item.Name == StressWorkName) { Item.Handle = INDEX_NONE; }
+	}
+	FramesScheduled = 0;
+	FramesOverBudget = 0;
+	WorstFrameMs = 0;
+
+	FRandomStream Random(Count);
+	for (int32 i = 0; i < Count; i++)
+	{
+		// Half to one and a half times CostMs, so estimates have something to follow
+		float ItemCostMs = CostMs * (0.5f + Random.FRand());
+		EVRWorkPriority Priority = (EVRWorkPriority)((int32)EVRWorkPriority::High + i % 3);
+		RegisterWork(this, StressWorkName, Priority, ItemCostMs, [ItemCostMs](float)
+		{
+			double EndTime = FPlatformTime::Seconds() + ItemCostMs / 1000;
+			while (FPlatformTime::Seconds() < EndTime) {}
+		}, true);
+	}
+}
+
+static void LogWorkReport(UWorld* World)
+{
+	if (UVRWorkSchedulerSubsystem* Scheduler = World ? World->GetSubsystem<UVRWorkSchedulerSubsystem>() : nullptr) { Scheduler->LogReport(); }
+}
+
+static FAutoConsoleCommandWithWorld VRWorkReportCommand(
+	TEXT("vr.WorkReport"),
+	TEXT("Logs how often the interaction work budget was exceeded, and each work item's cost and deferrals"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&LogWorkReport));
+
+/** Adds busy-wait work to check the budget holds under load: vr.WorkStress <Count> <CostMs>, then vr.WorkReport */
+static void SetWorkStress(const TArray<FString>& Args, UWorld* World)
+{
+	UVRWorkSchedulerSubsystem* Scheduler = World ? World->GetSubsystem<UVRWorkSchedulerSubsystem>() : nullptr;
+	if (!Scheduler) { return; }
+
+	int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 20;
+	float CostMs = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.25f;
+	Scheduler->SetStressLoad(Count, CostMs);
+	UE_LOG(LogTemp, Display, TEXT("Added %d synthetic work items of about %.2f ms, check stat VRInteraction or vr.WorkReport"), Count, CostMs);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs VRWorkStressCommand(
+	TEXT("vr.WorkStress"),
+	TEXT("Adds synthetic interaction work for testing the frame budget: vr.WorkStress <Count> <CostMs>, 0 removes it"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SetWorkStress));
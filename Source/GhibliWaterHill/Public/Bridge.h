@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PuzzleNetRelevancy.h"
 #include "Bridge.generated.h"
 
 UCLASS()
@@ -18,11 +19,19 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// For bridges spawned at runtime (eg. AVRStressGameMode), call before BeginPlay
+	void SetLinkedLever(class ALever* Lever) { LinkedLever = Lever; }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 private:
 	UPROPERTY(EditAnywhere)
 	class ALever* LinkedLever = nullptr;
@@ -30,4 +39,13 @@ private:
 	FRotator InitRotation = FRotator(-81, 20, 5);
 
 	FRotator MaxRotation = FRotator(11, 20, 5);
+
+	// The rotation is fully described by the lever, so that is all that gets sent (0-255)
+	UPROPERTY(Replicated)
+	uint8 ReplicatedLeverPercentage = 0;
+	UPROPERTY(EditAnywhere)
+	int32 ReplicationStep = 3;
+	FPuzzleNetRelevancy NetRelevancy;
+
+	float GetLinkedLeverPercentage();
 };
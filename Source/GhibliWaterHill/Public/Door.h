@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PuzzleNetRelevancy.h"
 #include "Door.generated.h"
 
 UCLASS()
@@ -18,12 +19,19 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-	void SetLockedState(bool Locked);
+	// Every machine applies the initial lock itself, so only gameplay changes need bWakeClients
+	void SetLockedState(bool Locked, bool bWakeClients = true);
+	bool bIsLocked() const { return bLocked; }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 private:
 	UPROPERTY(EditDefaultsOnly)
@@ -32,4 +40,14 @@ private:
 	UStaticMeshComponent* LockMesh = nullptr;
 
 	UStaticMeshComponent* SetDoorMesh();
+
+	// Replicated so clients only hear about the door when its lock changes
+	UPROPERTY(ReplicatedUsing = OnRep_Locked)
+	bool bLocked = false;
+	FPuzzleNetRelevancy NetRelevancy;
+
+	UFUNCTION()
+	void OnRep_Locked();
+	void ApplyLockedState();
+	void BroadcastLockChanged();
 };
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VRInteractionEvents.h"
+#include "InteractableSignificanceSubsystem.generated.h"
+
+UENUM()
+enum class ESignificanceBucket : uint8
+{
+	Full,
+	Reduced,
+	Dormant
+};
+
+/**
+ * Scores registered interactables by distance to the HMD and by the view cone, and moves
+ * the less significant ones onto slower ticks (or stops them ticking). A hand coming close
+ * puts an actor straight back to full rate on the same frame, as does grabbing or flinging it.
+ * The hand check runs as critical work on UVRWorkSchedulerSubsystem so it is never deferred, the distance
+ * and view scoring as normal priority work that can wait when the frame is over budget.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UInteractableSignificanceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// WakeRadius < 0 uses HandWakeRadius. Actors that must keep updating (eg. the bridge following its lever) pass bAllowTickDisable = false
+	void RegisterActor(AActor* Actor, float WakeRadius = -1, bool bAllowTickDisable = true);
+	void UnregisterActor(AActor* Actor);
+	// Puts an actor back to full rate straight away, eg. when it is grabbed or flicked
+	void WakeActor(AActor* Actor);
+
+private:
+	UPROPERTY(Config)
+	float FullRateDistance = 1000;
+	UPROPERTY(Config)
+	float ReducedRateDistance = 3000;
+	UPROPERTY(Config)
+	float ViewConeHalfAngle = 65;
+	UPROPERTY(Config)
+	float ReducedTickInterval = 0.1;
+	UPROPERTY(Config)
+	float DormantTickInterval = 0.5;
+	UPROPERTY(Config)
+	float HandWakeRadius = 150;
+	UPROPERTY(Config)
+	float ScoreInterval = 0.1;
+
+	struct FSignificanceEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		float WakeRadiusSquared = 0;
+		bool bAllowTickDisable = true;
+		// Authored on the actor, what full rate goes back to
+		float FullTickInterval = 0;
+		ESignificanceBucket Bucket = ESignificanceBucket::Full;
+	};
+	TArray<FSignificanceEntry> Entries;
+
+	struct FViewer
+	{
+		FVector Location;
+		FVector Forward;
+	};
+	TArray<FViewer> Viewers;
+	TArray<FVector> HandLocations;
+
+	float TimeSinceScore = 0;
+	FVRInteractionSubscription GrabbedSubscription = 0;
+	FVRInteractionSubscription FlingStartedSubscription = 0;
+
+private:
+	// Critical work on UVRWorkSchedulerSubsystem, every frame
+	void WakeNearHands(float DeltaTime);
+	// Normal priority work on UVRWorkSchedulerSubsystem
+	void Update(float DeltaTime);
+	void GatherViewers();
+	ESignificanceBucket ScoreEntry(const FSignificanceEntry& Entry) const;
+	bool bHandNear(const FSignificanceEntry& Entry) const;
+	void ApplyBucket(FSignificanceEntry& Entry, ESignificanceBucket Bucket);
+	void OnGrabbed(const FVRGrabEvent& Event);
+	void OnFlingStarted(const FVRFlingStartedEvent& Event);
+};
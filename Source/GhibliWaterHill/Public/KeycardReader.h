@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PuzzleNetRelevancy.h"
 #include "KeycardReader.generated.h"
 
 UCLASS()
@@ -18,11 +19,24 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	bool bIsDoorLocked() const { return bDoorLocked; }
+	// For checkpoints, locks or unlocks the linked door as if the card had been read
+	void RestoreLocked(bool bLocked) { SetLocked(bLocked); }
+	// For readers spawned at runtime (eg. AVRStressGameMode), call before BeginPlay
+	void SetLinks(class ADoor* Door, class AKeycard* Keycard) { LinkedDoor = Door; LinkedKeycard = Keycard; }
+	// Where a keycard has to be to be read
+	FVector GetDetectLocation() const;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 private:
 	UPROPERTY(EditAnywhere)
 	class ADoor* LinkedDoor = nullptr;
@@ -39,7 +53,9 @@ private:
 	UPROPERTY(EditDefaultsOnly)
 	class UStaticMeshComponent* ReaderMesh = nullptr;
 
-	class UMaterialInstanceDynamic* ActiveMaterialInstance = nullptr;
+	// The mesh's own material, the locked and unlocked instances of it are shared by every reader
+	UPROPERTY(Transient)
+	class UMaterialInterface* ReaderMaterialBase = nullptr;
 
 private:
 	UFUNCTION()
@@ -50,8 +66,13 @@ private:
 		bool bFromSweep,
 		const FHitResult& SweepResult);
 
-	void SetLocked(bool bLocked);
+	void SetLocked(bool bLocked, bool bWakeClients = true);
 	void ChangeMaterial(bool Locked);
 	UStaticMeshComponent* SetReaderMesh();
+	UPROPERTY(ReplicatedUsing = OnRep_DoorLocked)
 	bool bDoorLocked = false;
+	FPuzzleNetRelevancy NetRelevancy;
+
+	UFUNCTION()
+	void OnRep_DoorLocked();
 };
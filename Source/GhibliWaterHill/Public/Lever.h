@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PuzzleNetRelevancy.h"
 #include "Lever.generated.h"
 
 UCLASS()
@@ -18,12 +19,22 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
 	float GetLeverRotationPercentage();
+	// True when one of the local player's hands has hold of the rod, in which case it is ahead of the server
+	bool bIsHeldLocally() const;
+	// Signed rod position from -1 to 1, set for checkpoints
+	float GetSignedRodScale() const;
+	void RestoreRodScale(float Scale);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 private:
 	class UStaticMeshComponent* SetLeverMesh();
@@ -32,4 +43,17 @@ private:
 
 	FRotator InitialRodRotation = FRotator(-22.5, -90, 0);
 	float RodRotationMaxScale = 22.5;
+
+	// Signed rod position in percent, only sent once it has moved at least ReplicationStep
+	UPROPERTY(ReplicatedUsing = OnRep_RodPercentage)
+	int8 ReplicatedRodPercentage = 0;
+	UPROPERTY(EditAnywhere)
+	int32 ReplicationStep = 2;
+	FPuzzleNetRelevancy NetRelevancy;
+
+	UFUNCTION()
+	void OnRep_RodPercentage();
+	void ApplyRodScale(float Scale);
+	// Server and clients, each time the replicated step changes
+	void BroadcastLeverChanged();
 };
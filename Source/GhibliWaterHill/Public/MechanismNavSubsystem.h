@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MechanismNavSubsystem.generated.h"
+
+UENUM()
+enum class EMechanismNavState : uint8
+{
+	// Navmesh matches where it is
+	Idle,
+	// Moved this frame or hasn't been still for SettleTime yet
+	Moving,
+	// Settled, out of the navigation octree and waiting for the next rebuild slot to go back in
+	Dirty,
+	// Its tiles are being rebuilt
+	Building
+};
+
+/**
+ * Keeps the navmesh under moving mechanisms (bridges, doors) up to date without rebuilding it every
+ * frame they move. As soon as a mechanism starts moving its primitives stop affecting navigation, which
+ * takes them out of the octree and dirties their old bounds once, so however it moves the octree isn't
+ * updated again. After it has been still for SettleTime they are put back, dirtying the new bounds, at most
+ * once every MinRebuildInterval. Other moving components keep updating the octree as usual. Tiles are rebuilt asynchronously by
+ * the dynamic navmesh (see DefaultEngine.ini). Until that is done, teleports onto the mechanism are refused.
+ * Runs as low priority work on UVRWorkSchedulerSubsystem.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UMechanismNavSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Every primitive on the actor that affects navigation is tracked
+	void RegisterMechanism(AActor* Actor);
+	void UnregisterMechanism(AActor* Actor);
+	// False if Location is on or next to a mechanism the navmesh hasn't caught up with
+	bool IsSettledAt(const FVector& Location) const;
+
+private:
+	UPROPERTY(Config)
+	float SettleTime = 0.25;
+	UPROPERTY(Config)
+	float MinRebuildInterval = 0.5;
+	// Teleport destinations this close to an unsettled mechanism are refused
+	UPROPERTY(Config)
+	float UnsettledPadding = 50;
+
+	struct FMechanismComponent
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FTransform LastTransform;
+	};
+	struct FMechanism
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TArray<FMechanismComponent> Components;
+		EMechanismNavState State = EMechanismNavState::Idle;
+		float StillTime = 0;
+		// Where the navmesh thinks it is, and everywhere it has been since
+		FBox BuiltBounds = FBox(ForceInit);
+		FBox UnsettledBounds = FBox(ForceInit);
+		// Its primitives have been taken out of the navigation octree while it moves
+		bool bOutOfOctree = false;
+	};
+	TArray<FMechanism> Mechanisms;
+	float TimeSinceRebuild = 0;
+
+private:
+	// Low priority work on UVRWorkSchedulerSubsystem
+	void Update(float DeltaTime);
+	void UpdateMotion(FMechanism& Mechanism, float DeltaTime);
+	void RebuildDirty();
+	void SetAffectsNavigation(FMechanism& Mechanism, bool bAffects);
+	bool bMovedFrom(const FTransform& Transform, const FTransform& From, float Distance, float AngleDegrees) const;
+};
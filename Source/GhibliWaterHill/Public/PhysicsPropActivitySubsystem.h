@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/World.h"
+#include "PhysicsPropActivitySubsystem.generated.h"
+
+UENUM()
+enum class EPropActivity : uint8
+{
+	// Left to the physics engine
+	Active,
+	// Put to sleep by us, still wakes on contact
+	Asleep,
+	// Out of the simulation altogether until someone comes close
+	Kinematic
+};
+
+/**
+ * Keeps only the physics props near a player simulating. Props out of view and away from everyone are put
+ * to sleep, and far away ones that have come to rest stop simulating. Props are kept in a spatial hash,
+ * so hands and flick cones wake what they approach without looking at every prop in the level, and
+ * the rest are re-scored a slice at a time.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UPhysicsPropActivitySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return Props.Num() > 0; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+	// Level props are found as their level is added to the world, anything spawned later that should be managed registers here
+	void RegisterProp(UPrimitiveComponent* Component);
+	// Before destroying a registered prop. Ones destroyed without it are dropped when next scored
+	void UnregisterProp(UPrimitiveComponent* Component);
+	// Including the ones we have taken out of the simulation
+	void GetPropComponents(TArray<UPrimitiveComponent*>& OutComponents) const;
+
+private:
+	UPROPERTY(Config)
+	float CellSize = 200;
+	UPROPERTY(Config)
+	float HandWakeRadius = 150;
+	UPROPERTY(Config)
+	float FlickConeLength = 2000;
+	UPROPERTY(Config)
+	float FlickConeHalfAngle = 15;
+	// Props this close to a player always simulate
+	UPROPERTY(Config)
+	float InteractionRadius = 800;
+	UPROPERTY(Config)
+	float ViewDistance = 3000;
+	UPROPERTY(Config)
+	float ViewConeHalfAngle = 65;
+	UPROPERTY(Config)
+	float KinematicDistance = 5000;
+	UPROPERTY(Config)
+	int32 PropsScoredPerFrame = 200;
+	UPROPERTY(Config)
+	int32 ActiveBodyBudget = 150;
+	// Over budget, props in view but outside InteractionRadius slower than this are put to sleep too
+	UPROPERTY(Config)
+	float BudgetSleepSpeed = 50;
+	// Out of view and away from everyone, props only go to sleep once they are slower than this
+	UPROPERTY(Config)
+	float SleepLinearSpeed = 20;
+	// In degrees per second
+	UPROPERTY(Config)
+	float SleepAngularSpeed = 45;
+
+	struct FPhysicsProp
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FIntVector Cell;
+		EPropActivity Activity = EPropActivity::Active;
+		bool bInView = false;
+	};
+	TArray<FPhysicsProp> Props;
+	TMap<FIntVector, TArray<int32>> Grid;
+
+	struct FViewer
+	{
+		FVector Location;
+		FVector Forward;
+	};
+	struct FFlickCone
+	{
+		FVector Origin;
+		FVector Direction;
+	};
+	TArray<FViewer> Viewers;
+	TArray<FVector> HandLocations;
+	TArray<FFlickCone> FlickCones;
+	// Held or mid flick, never touched
+	TArray<UPrimitiveComponent*> PinnedComponents;
+	TArray<int32> QueryResults;
+
+	int32 NextScoreIndex = 0;
+	int32 AwakeThisCycle = 0;
+	int32 AwakeLastCycle = 0;
+	int32 NumKinematic = 0;
+	bool bWasEnabled = true;
+	FDelegateHandle ActorsInitializedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+	TArray<TWeakObjectPtr<ULevel>> RegisteredLevels;
+
+private:
+	void OnActorsInitialized(const UWorld::FActorsInitializedParams& Params);
+	void OnLevelAdded(ULevel* Level, UWorld* World);
+	void OnLevelRemoved(ULevel* Level, UWorld* World);
+	void RegisterLevelProps(ULevel* Level);
+	void UnregisterLevelProps(ULevel* Level);
+	bool IsSettling(const UPrimitiveComponent* Component) const;
+	void GatherInterest();
+	void WakeNearHands();
+	void ScoreProp(int32 Index);
+	void SetActivity(FPhysicsProp& Prop, EPropActivity Activity);
+	void WakeProp(FPhysicsProp& Prop);
+	void RestoreAll();
+
+	FIntVector GetCell(const FVector& Location) const;
+	void MoveToCell(int32 Index, const FIntVector& Cell);
+	// Swaps the last prop into its place
+	void RemoveProp(int32 Index);
+	void QuerySphere(const FVector& Center, float Radius);
+};
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Async/Future.h"
+#include "PuzzleCheckpointSubsystem.generated.h"
+
+/**
+ * Saves and restores puzzle state without reloading the map: door and reader locks, lever positions
+ * (bridges follow their lever) and the transforms and velocities of every physics prop. A checkpoint is
+ * a header followed by flat arrays of fixed size records, written on a worker thread and memory mapped
+ * when restored so it can be applied in one pass.
+ */
+UCLASS()
+class GHIBLIWATERHILL_API UPuzzleCheckpointSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// Captures on the game thread and returns straight away, the file is written in the background
+	void SaveCheckpoint(const FString& Name);
+	// Server or standalone only, clients get the result through replication
+	bool LoadCheckpoint(const FString& Name);
+
+	static FString GetCheckpointPath(const FString& Name);
+
+private:
+	TFuture<bool> PendingWrite;
+	FString PendingWritePath;
+
+private:
+	void WaitForPendingWrite();
+	TMap<uint32, UObject*> GatherCheckpointObjects() const;
+};
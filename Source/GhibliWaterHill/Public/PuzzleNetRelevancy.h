@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Shared network setup for the puzzle actors (doors, levers, bridges, keycards and readers).
+ * They change state rarely, so they replicate dormant and are only woken by a state transition.
+ * Ones placed in a streamed room are only relevant to viewers inside that room.
+ */
+struct GHIBLIWATERHILL_API FPuzzleNetRelevancy
+{
+	// Call from the constructor
+	static void ConfigureDormantReplication(AActor* Actor);
+
+	// Call from BeginPlay, once the actor knows which level it is in
+	void Init(const AActor* Actor);
+	bool IsRelevantFor(const FVector& SrcLocation) const;
+
+private:
+	FBox RoomBounds = FBox(ForceInit);
+};
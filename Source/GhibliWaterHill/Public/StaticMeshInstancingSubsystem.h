@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/World.h"
+#include "StaticMeshInstancingSubsystem.generated.h"
+
+class AStaticMeshActor;
+class UStaticMeshComponent;
+
+/**
+ * Whitebox levels are built from hundreds of plain static mesh actors. When a level is added to the world,
+ * static mesh actors that only render and collide are grouped by mesh, materials and collision, per level
+ * and per cell, and replaced by one hierarchical instanced component per group. Collision is copied from
+ * the originals so navigation and traces see the same geometry.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UStaticMeshInstancingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void LogReport() const;
+
+private:
+	// Instances are grouped per cell as well as per level, so each group can still be culled on its own
+	UPROPERTY(Config)
+	float CellSize = 4000;
+	// Fewer copies than this are left as they are
+	UPROPERTY(Config)
+	int32 MinInstances = 3;
+	// Actors with this tag are never merged, for ones referenced by level Blueprints
+	UPROPERTY(Config)
+	FName KeepTag = TEXT("NoAutoInstance");
+
+	TSet<TWeakObjectPtr<ULevel>> ProcessedLevels;
+
+	int32 TotalMergedComponents = 0;
+	int32 TotalInstancedComponents = 0;
+	int64 TotalBytesSaved = 0;
+	double TotalSeconds = 0;
+
+	FDelegateHandle ActorsInitializedHandle;
+	FDelegateHandle LevelAddedHandle;
+
+private:
+	void OnActorsInitialized(const UWorld::FActorsInitializedParams& Params);
+	void OnLevelAdded(ULevel* Level, UWorld* World);
+	void InstanceLevel(ULevel* Level);
+	bool bCanInstance(const AStaticMeshActor* Actor) const;
+};
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TeleportStreamingSubsystem.generated.h"
+
+/**
+ * Streams rooms (sublevels with streaming volumes) around the players and around where they are
+ * aiming to teleport. The aimed destination is known well before the pawn moves, so the rooms there
+ * are loaded and made visible while aiming and during the fade instead of popping in after it.
+ * Levels without streaming volumes are left to the engine.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UTeleportStreamingSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return !bGathered || ManagedLevels.Num() > 0; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+	// Call every frame while a destination is being shown, it is dropped after PrefetchHoldTime
+	void PrefetchAround(const FVector& Location);
+	// Every room within PrefetchRadius of Location is loaded and visible
+	bool IsReadyAt(const FVector& Location) const;
+	// Last resort once the fade is over, blocks the game thread until the rooms are in
+	void FlushAt(const FVector& Location);
+
+private:
+	UPROPERTY(Config)
+	float PrefetchRadius = 300;
+	UPROPERTY(Config)
+	float PrefetchHoldTime = 1;
+	// Rooms stay loaded this long after nothing wants them, so turning around doesn't reload them
+	UPROPERTY(Config)
+	float UnloadDelay = 5;
+
+	struct FManagedLevel
+	{
+		TWeakObjectPtr<class ULevelStreaming> Level;
+		TArray<TWeakObjectPtr<class ALevelStreamingVolume>> Volumes;
+		float LastWantedTime = -BIG_NUMBER;
+	};
+	TArray<FManagedLevel> ManagedLevels;
+	bool bGathered = false;
+
+	struct FPrefetchTarget
+	{
+		FVector Location;
+		float Time;
+	};
+	TArray<FPrefetchTarget> PrefetchTargets;
+	TArray<FVector> ViewLocations;
+
+private:
+	void GatherManagedLevels();
+	bool bLevelNear(const FManagedLevel& Managed, const FVector& Location, float Radius) const;
+	void SetLevelWanted(FManagedLevel& Managed, bool bWanted, float Now);
+};
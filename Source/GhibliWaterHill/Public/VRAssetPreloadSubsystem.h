@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/SoftObjectPtr.h"
+#include "Engine/StreamableManager.h"
+#include "VRAssetPreloadSubsystem.generated.h"
+
+/**
+ * Loads the player's assets in one async batch while the map loads. Every soft object reference
+ * on the default objects of PreloadClasses is requested, so adding a TSoftObjectPtr to the controller
+ * or character is enough for it to be preloaded. The pool and the character wait for it through
+ * CallWhenPreloaded, so they only bind what is already resident.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UVRAssetPreloadSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	bool IsPreloaded() const { return bPreloaded; }
+	// Runs straight away if the preload has already finished
+	void CallWhenPreloaded(FSimpleDelegate Callback);
+	// Logs the time from process start and from map load, once per process
+	void NotifyFirstInteractiveFrame();
+
+	// The asset if it is resident, otherwise loads it synchronously and warns as that is a hitch
+	template<typename T>
+	static T* GetResident(const TSoftObjectPtr<T>& Asset)
+	{
+		if (Asset.IsNull()) { return nullptr; }
+		if (T* Loaded = Asset.Get()) { return Loaded; }
+		UE_LOG(LogTemp, Warning, TEXT("%s was not preloaded, loading it synchronously"), *Asset.ToString());
+		return Asset.LoadSynchronous();
+	}
+
+private:
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<UObject>> PreloadClasses;
+
+	TSharedPtr<FStreamableHandle> ClassHandle;
+	TSharedPtr<FStreamableHandle> AssetHandle;
+	bool bPreloaded = false;
+	TArray<FSimpleDelegate> PendingCallbacks;
+	double MapLoadStartTime = 0;
+
+private:
+	void OnClassesLoaded();
+	void OnAssetsLoaded();
+};
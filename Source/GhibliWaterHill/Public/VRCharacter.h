@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Containers/Queue.h"
+#include "VRNetTypes.h"
+#include "VRMathCore.h"
 #include "VRCharacter.generated.h"
 
 UENUM()
@@ -33,6 +35,8 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
@@ -41,7 +45,18 @@ public:
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	void StopTeleportationCheck();
+	class AVRController* GetLeftController() const { return LeftController; }
+	class AVRController* GetRightController() const { return RightController; }
+	class AVRController* GetOtherController(const class AVRController* Controller) const { return Controller == LeftController ? RightController : LeftController; }
+
+	// Interaction state goes over the network as events rather than per-frame transforms.
+	// The owning client has already predicted these, the server validates them and corrects it if needed
+	void NotifyGrabbed(EControllerHand Hand, class UPrimitiveComponent* Component);
+	void NotifyReleased(EControllerHand Hand);
+	void NotifyFlickStarted(const FVRFlickEvent& FlickEvent, class UPrimitiveComponent* Component);
 private:
 	UPROPERTY(VisibleAnywhere)
 	class UCameraComponent* Camera = nullptr;
@@ -59,6 +74,11 @@ private:
 	float TeleportBlinkTime = 0.3;
 	UPROPERTY(EditDefaultsOnly)
 	float TeleportTime = 0.1;
+	// How long to stay faded out for rooms at the destination to stream in, before blocking on them
+	UPROPERTY(EditDefaultsOnly)
+	float MaxTeleportStreamingWait = 1;
+	float TeleportStreamingWait = 0;
+	FVector PendingTeleportLocation = FVector::ZeroVector;
 	UPROPERTY(EditDefaultsOnly)
 	ETurnType TurnType = ETurnType::Snap;
 	UPROPERTY(EditDefaultsOnly)
@@ -74,29 +94,131 @@ private:
 	UPROPERTY(EditDefaultsOnly)
 	float SmoothTurnActivationScale = 0.7;
 
-	int32 ScaleHistoryMaxNum = 5;
-	TArray<float> ScaleHistory;
+	// Sampled every locomotion step, so this is a fixed window of time
+	VRMath::TStickGesture<5> TeleportGesture;
 	bool bCurrentlyTeleporting = false;
 	class APlayerCameraManager* PlayerCameraManager = nullptr;
 	bool HaveSnapped = false;
 
 	UPROPERTY(EditDefaultsOnly)
-	class UMaterialInterface* HighlightMaterialBase = nullptr;;
+	TSoftObjectPtr<class UMaterialInterface> HighlightMaterialBase;
+	bool bReportedInteractive = false;
+
+	// Turning and the teleport gesture run at this fixed rate, so they feel the same at any headset refresh rate or under reprojection
+	UPROPERTY(EditDefaultsOnly)
+	float LocomotionStepRate = 90;
+	// After a hitch the remaining time is dropped rather than catching up all at once
+	UPROPERTY(EditDefaultsOnly)
+	int32 MaxLocomotionStepsPerFrame = 8;
+	float LocomotionAccumulator = 0;
+	// Latest axis values, and the teleport axis from last frame to interpolate between
+	float TurnInput = 0;
+	float TeleportInput = 0;
+	float LastTeleportInput = 0;
+	// Yaw integrated by the steps, the frame is drawn between the last two
+	float PreviousTurnYaw = 0;
+	float TurnYaw = 0;
+	float AppliedTurnYaw = 0;
 
 private:
 	void MoveForward(float Scale);
 	void MoveRight(float Scale);
 	void TurnRight(float Scale);
 	void TryTeleport(float Scale);
+	void TickLocomotion(float DeltaTime);
+	void StepTurn(float Scale, float StepTime);
+	void StepTeleport(float Scale);
 	void SendGrabRequestLeft(float Scale);
 	void SendGrabRequestRight(float Scale);
 	void EndTeleport();
+	void FinishTeleport();
 	void FadeOutFromTeleport();
+	// On the owning client and the server, once the character has moved
+	void BroadcastTeleported(const FVector& From);
 	void UpdateActionMapping(class UInputSettings* InputSettings, FName ActionName, FKey OldKey, FKey NewKey);
 	void UpdateAxisMapping(class UInputSettings* InputSettings, FName AxisName, FKey Key, float Scale);
 	void StartTeleportationCheck();
 	bool bVelocityForTeleport(float Scale);
 	AVRController* GetTeleportController();
 	AVRController* GetMovementController();
+	AVRController* GetHandController(EControllerHand Hand);
+	// The rest of BeginPlay, once UVRAssetPreloadSubsystem has the hands' and highlight's assets resident
+	void BindPreloaded();
+	AVRController* AcquireHandController(EControllerHand Hand);
+	void ReleaseHandController(AVRController* Controller);
+
+private:
+	UPROPERTY(EditDefaultsOnly)
+	float PoseSendRate = 45;
+	// Still poses the server hasn't acknowledged are sent again at this rate, as the pose RPC is unreliable
+	UPROPERTY(EditDefaultsOnly)
+	float PoseResendRate = 5;
+	// Server side grab validation, on top of the grab volume to allow for pose latency
+	UPROPERTY(EditDefaultsOnly)
+	float MaxGrabReach = 60;
+	UPROPERTY(EditDefaultsOnly)
+	float MaxFlickDistance = 2000;
+	// Server side teleport validation, slack on the arc's range for pose latency
+	UPROPERTY(EditDefaultsOnly)
+	float TeleportRangeTolerance = 200;
+	// How often the server sends the owning client where its held objects really are
+	UPROPERTY(EditDefaultsOnly)
+	float GrabStateSendRate = 10;
+	float TimeSinceGrabStateSend = 0;
+
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedPoses)
+	FVRReplicatedPoses ReplicatedPoses;
+	// Last pose update the server has received from the owning client, used as its delta baseline
+	UPROPERTY(Replicated)
+	uint16 AckedPoseSequence = 0;
+
+	struct FPoseHistoryEntry
+	{
+		uint16 Sequence = 0;
+		FVRReplicatedPoses Poses;
+	};
+	static const int32 PoseHistorySize = 32;
+	// Sent poses on the owning client, received poses on the server
+	FPoseHistoryEntry PoseHistory[PoseHistorySize];
+	uint16 PoseSequence = 0;
+	FVRReplicatedPoses LastSentPoses;
+	float TimeSinceLastPoseSend = 0;
+	float TimeSinceLastPoseRPC = 0;
+	bool bLocallyTracked = true;
+
+private:
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerUpdatePoses(const FVRPoseDelta& Delta);
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerTryGrab(EControllerHand Hand, class UPrimitiveComponent* Component);
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerReleaseGrab(EControllerHand Hand);
+	UFUNCTION(Client, Reliable)
+	void ClientRejectGrab(EControllerHand Hand);
+	UFUNCTION(Client, Unreliable)
+	void ClientGrabState(EControllerHand Hand, FVector_NetQuantize10 ServerLocation);
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastSetGrabbing(EControllerHand Hand, bool bGrabbing);
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerStartFlick(const FVRFlickEvent& FlickEvent, class UPrimitiveComponent* Component);
+	UFUNCTION(Client, Reliable)
+	void ClientRejectFlick(EControllerHand Hand);
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastStartFlick(const FVRFlickEvent& FlickEvent);
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerTeleport(FVector_NetQuantize Destination);
+	// Lets the server start streaming the destination in during the fade too
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerPrefetchTeleport(FVector_NetQuantize Destination);
+	UFUNCTION()
+	void OnRep_ReplicatedPoses();
+
+	void UpdateLocalTracking();
+	void SendPoses(float DeltaTime);
+	FVRReplicatedPoses CapturePoses() const;
+	void ApplyPoses(const FVRReplicatedPoses& Poses);
+	void StorePoseHistory(uint16 Sequence, const FVRReplicatedPoses& Poses);
+	void SendGrabStates(float DeltaTime);
+	float GetNetLatency() const;
 
 };
@@ -4,10 +4,55 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "VRLatency.h"
 #include "VRController.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FFlingEvent, USplineComponent*, FlickPath, UPrimitiveComponent*, FlickedComponent);
 
+/** What a hand is doing. Each state has a fixed set of per-frame work (traces, pose checks, grab following), see HandStateWork */
+UENUM()
+enum class EHandState : uint8
+{
+	Idle,
+	AimingTeleport,
+	HighlightingFlick,
+	// From gripping a highlighted object until it has finished flying
+	Flicking,
+	Grabbing
+};
+
+/** Everything that can move a hand between states, see HandTransitions */
+enum class EHandEvent : uint8
+{
+	TeleportCheckStarted,
+	TeleportCheckStopped,
+	FlickPoseEntered,
+	FlickPoseLeft,
+	FlickHeld,
+	FlickLaunched,
+	FlickFinished,
+	Grabbed,
+	Released
+};
+
+/**
+ * The controller's pose as every mechanic sees it this frame. Taken once at the start of the controller's
+ * tick, after the motion controller has updated, so teleport, flick, grab and hand coupled movement all
+ * agree, and kept to a single cache line. Input handled before that sees the last frame's pose.
+ */
+struct alignas(PLATFORM_CACHE_LINE_SIZE) FVRControllerPose
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Forward = FVector::ForwardVector;
+	FVector Right = FVector::RightVector;
+	// Out of the palm, where flicks are aimed
+	FVector HandDirection = FVector::UpVector;
+	// Since the last tick's snapshot, zero for a hand's first pose
+	FVector Velocity = FVector::ZeroVector;
+	bool bGoodFlickRotation = false;
+};
+static_assert(sizeof(FVRControllerPose) == PLATFORM_CACHE_LINE_SIZE, "FVRControllerPose should fit one cache line");
+
 UCLASS()
 class GHIBLIWATERHILL_API AVRController : public AActor
 {
@@ -20,21 +65,52 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
 	void SetHand(EControllerHand Hand);
+	const FVRControllerPose& GetPose();
 	bool bCanHandTeleport();
 	bool bCanHandMove();
 	bool FindTeleportDestination(FVector& Location);
 	bool UpdateTeleportationCheck();
 	void SetCanCheckTeleport(bool bCheck);
+	// Last valid destination shown by the teleport check
+	FVector GetLastTeleportDestination() const { return LastTeleportDestination; }
 	void TryGrab();
 	void ReleaseGrab();
 	void DetectGrabStyle();
 
+	// Used on other players' pawns, whose hands are driven by replicated poses instead of local devices
+	void SetLocallyTracked(bool bTracked);
+	void SetTrackedPose(const FTransform& RelativeTransform);
+	void SetRemoteGrabbing(bool bGrabbing) { bRemoteGrabbing = bGrabbing; }
+	bool bIsHandGrabbing() const { return bIsGrabbing() || bRemoteGrabbing; }
+	EHandState GetHandState() const { return HandState; }
+	void PlayRemoteFlick(const struct FVRFlickEvent& FlickEvent);
+
+	// Server side of the predicted grab and flick, validated by AVRCharacter before these are called
+	bool bCanReachComponent(UPrimitiveComponent* Component, float Reach) const;
+	// Whether the teleport arc could land there from this hand, give or take Tolerance, and it's on the navmesh
+	bool bCanArcReach(const FVector& Destination, float Tolerance) const;
+	void AuthorityGrab(UPrimitiveComponent* Component);
+	void AuthorityFlick(UPrimitiveComponent* Component, const struct FVRFlickEvent& FlickEvent);
+	UPrimitiveComponent* GetGrabbedComponent() const { return bIsGrabbing() ? GrabbedComponent : nullptr; }
+	UPrimitiveComponent* GetFlickingComponent() const { return ComponentCurrentlyFlicking; }
+	// Owning client side, when the server disagrees with what we predicted
+	void RejectPredictedGrab();
+	void RejectPredictedFlick();
+	void ReconcileGrab(const FVector& ServerLocation, float Latency);
+
+	// Used by UVRInteractionPoolSubsystem. Inactive controllers are hidden, don't tick and have no grab or flick state
+	void SetPooledActive(bool bActive);
+	// Creates enough arc meshes up front for the longest teleport or flick arc
+	void PrewarmArcMeshes();
+
 	bool bAllowCharacterTeleport = false;
 
 	UPROPERTY(EditDefaultsOnly)
@@ -69,13 +145,15 @@ private:
 	class USceneComponent* FlickRoot = nullptr;
 	UPROPERTY(VisibleAnywhere)
 	class UStaticMeshComponent* FlickVolume = nullptr;
+	// Editor only
 	UPROPERTY(VisibleAnywhere)
 	class UStaticMeshComponent* DebugMesh = nullptr;
 
+	// Soft so they can be preloaded with the map instead of with the class, see UVRAssetPreloadSubsystem
 	UPROPERTY(EditDefaultsOnly)
-	UStaticMesh* LeftControllerMesh = nullptr;
+	TSoftObjectPtr<UStaticMesh> LeftControllerMesh;
 	UPROPERTY(EditDefaultsOnly)
-	UStaticMesh* RightControllerMesh = nullptr;
+	TSoftObjectPtr<UStaticMesh> RightControllerMesh;
 
 	UPROPERTY(EditDefaultsOnly)
 	float TeleportProjectileSpeed = 800;
@@ -87,25 +165,86 @@ private:
 	float TeleportSimulationFrequency = 50;
 	UPROPERTY(EditDefaultsOnly)
 	FVector TeleportNavExtent = FVector(100, 100, 100);
+	// Aim assist: when the aimed arc can't land, a fan of arcs this many steps either side of it is tried, nearest first. 0 turns it off
+	UPROPERTY(EditDefaultsOnly)
+	int32 TeleportAssistSteps = 1;
+	UPROPERTY(EditDefaultsOnly)
+	float TeleportAssistPitchStep = 3;
+	UPROPERTY(EditDefaultsOnly)
+	float TeleportAssistYawStep = 4;
+	// Arcs stop this far below the hand
+	UPROPERTY(EditDefaultsOnly)
+	float TeleportMaxDrop = 5000;
+	// Arc samples covered by one sweep, only a stretch that hits is swept again sample by sample
 	UPROPERTY(EditDefaultsOnly)
-	class UStaticMesh* TeleportArcMesh;
+	int32 TeleportCoarseSamples = 8;
 	UPROPERTY(EditDefaultsOnly)
-	class UMaterialInterface* TeleportArcMaterial;
+	TSoftObjectPtr<class UStaticMesh> TeleportArcMesh;
+	UPROPERTY(EditDefaultsOnly)
+	TSoftObjectPtr<class UMaterialInterface> TeleportArcMaterial;
 	UPROPERTY() // need this for proper garbage collection
 	TArray<class USplineMeshComponent*> MeshObjects;
+	// From the start of MeshObjects, set by UpdateSpline
+	int32 NumArcMeshesInUse = 0;
 	UPROPERTY(EditDefaultsOnly)
 	FVector DestinationMarkerScale = FVector(0.7, 0.7, 0.5);
 
 
-	bool bCanCheckTeleport = false;
-	bool bIsGrabbing = false;
+	FVRControllerPose Pose;
+	bool bHasPose = false;
+	// DeltaTime since the last snapshot, 0 when there is none to take the velocity from
+	void RefreshPose(float DeltaTime);
+
+	// Motion to photon, from when the motion controller last moved the hand, see FVRLatency
+	double HandMovedTime = 0;
+	double PoseSampleTime = 0;
+	bool bPoseMoved = false;
+	FVRLatencyTrace TeleportLatency;
+	FVRLatencyTrace FlickLatency;
+	void OnHandMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	// Invalid when the hand hasn't moved since the last pose or isn't tracked here
+	FVRLatencyTrace BeginLatencyTrace();
+
+	FVector LastTeleportDestination = FVector::ZeroVector;
+	bool bRemoteGrabbing = false;
+	bool bLocallyTracked = true;
+	bool bInPool = false;
+	EHandState HandState = EHandState::Idle;
+	// Teleport pressed while the hand was busy, started once it's back to Idle
+	bool bTeleportCheckPending = false;
+	bool bIsGrabbing() const { return HandState == EHandState::Grabbing; }
+	bool bCanHandleHandEvent(EHandEvent Event) const;
+	// Looks the event up in HandTransitions, returns false (and changes nothing) if the current state doesn't take it
+	bool HandleHandEvent(EHandEvent Event);
+	void SetHandState(EHandState NewState);
+	void UpdateFlickPose();
+	void ClearFlickHighlight();
+	// Teleport and flick traces go through UVRWorkSchedulerSubsystem, the teleport arc as critical work
+	int32 TeleportWorkHandle = INDEX_NONE;
+	int32 FlickWorkHandle = INDEX_NONE;
+	void RequestHandWork(int32 Handle, void (AVRController::*Work)(float), float DeltaTime);
+	void TeleportTraceWork(float DeltaTime);
+	void FlickTraceWork(float DeltaTime);
 	class UPrimitiveComponent* GrabbedComponent = nullptr;
 	float GrabbedComponentInitDistance;
 	FRotator ControllerRotationOnGrab;
 private:
-	void UpdateSpline(TArray<FVector> PathData, USplineComponent* PathToUpdate);
+	void UpdateSpline(const TArray<FVector>& PathData, USplineComponent* PathToUpdate);
+	USplineMeshComponent* AddArcMesh();
 	bool ProjectilePathingUpdate(struct FPredictProjectilePathResult& Result, float ProjectileRadius, FVector StartLocation, FVector Direction, float ProjectileSpeed, float SimulationTime, ECollisionChannel CollisionChannel);
 
+	// Pitch and yaw offsets of the aim assist fan, the aimed arc first and then nearest first
+	TArray<FVector2D> TeleportFanOffsets;
+	// Kept between frames so finding the destination doesn't allocate
+	TArray<FVector> TeleportFanVelocities;
+	TArray<FVector> TeleportFanPoints;
+	TArray<int32> TeleportFanCounts;
+	TArray<FVector> TeleportPathPoints;
+	void BuildTeleportFan();
+	// Sweeps the arc TeleportCoarseSamples at a time and only refines the stretch that hits
+	bool TraceTeleportArc(const FVector* Points, int32 NumPoints, FHitResult& OutHit, int32& OutHitSegment) const;
+	bool bValidTeleportLocation(const FVector& HitLocation, FVector& OutLocation) const;
+
 private:
 	void FlickHighlight();
 	void UpdateFlickSpline();
@@ -115,7 +254,6 @@ private:
 	UFUNCTION(BlueprintCallable)
 	void ResetRegisteredComponents();
 	void ModifySplinePoints(USplineComponent* PathToUpdate, bool bHidePoints, bool bClear);
-	TArray<FVector> PathPointDataToFVector(TArray<struct FPredictProjectilePathPointData> PathData);
 	
 	UPrimitiveComponent* RegisteredFlickComponent = nullptr;
 	USplineComponent* RegisteredSplineComponent = nullptr;
@@ -124,6 +262,55 @@ private:
 	bool bHoldingFlick = false;
 	bool bOnOldComponent = true;
 	float FlickVelocityRequired = 250;
+	int32 FlickSplinePointCount = 100;
+	FVector FlickControlPoints[4];
+
+	UPROPERTY(EditDefaultsOnly)
+	float RemoteFlickDisplayTime = 1;
+	FTimerHandle RemoteFlickTimer;
+	void HideRemoteFlick();
+	class AVRCharacter* GetOwningCharacter() const;
+
+	// Prediction error below this is left alone, above it we blend towards the server over GrabReconcileBlendTime.
+	// Used for held objects and for where a flicked object ends its flight
+	UPROPERTY(EditDefaultsOnly)
+	float GrabReconcileThreshold = 5;
+	UPROPERTY(EditDefaultsOnly)
+	float GrabReconcileBlendTime = 0.15;
+	// Once the error is back under the threshold, an old correction fades out over this long
+	UPROPERTY(EditDefaultsOnly)
+	float GrabCorrectionDecayTime = 0.5;
+	// A flicked object the server still disagrees with after this long is handed over as it is
+	UPROPERTY(EditDefaultsOnly)
+	float FlightSettleTimeout = 2;
+
+	struct FPredictedGrabSample
+	{
+		float Time = 0;
+		FVector Location = FVector::ZeroVector;
+	};
+	static const int32 PredictedGrabHistorySize = 64;
+	FPredictedGrabSample PredictedGrabHistory[PredictedGrabHistorySize];
+	int32 PredictedGrabHistoryHead = 0;
+	FVector PendingGrabCorrection = FVector::ZeroVector;
+	// The part of the correction already applied, kept on the physics handle's target
+	FVector GrabCorrectionOffset = FVector::ZeroVector;
+	bool bGrabErrorUnderThreshold = true;
+
+	// A flicked object whose predicted flight has ended, still ours until it agrees with the server
+	TWeakObjectPtr<UPrimitiveComponent> SettlingFlight;
+	float FlightSettleTime = 0;
+	bool bFlightBlending = false;
+
+	void GrabComponent(UPrimitiveComponent* Component);
+	void SetPredictingComponent(UPrimitiveComponent* Component, bool bPredicting);
+	void RecordPredictedGrab();
+	void ApplyGrabCorrection(float DeltaTime);
+	void BeginFlightSettle(UPrimitiveComponent* Component);
+	void UpdateFlightSettle(float DeltaTime);
+	void EndFlightSettle();
+	// Dedicated, listen or standalone, as opposed to a client predicting its own grabs
+	bool bOnServer() const;
 
 public:
 	UPROPERTY(BlueprintAssignable)
@@ -131,4 +318,8 @@ public:
 
 	void DetectReleaseStyle();
 	bool bGoodFlickRotation();
+
+private:
+	// Native subscribers first, then StartComponentFling if the Blueprint bound it
+	void BroadcastFlingStarted();
 };
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "VRInteractionEvents.h"
+#include "VRInteractionEventBridge.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FVRBridgeFlingEvent, AVRController*, Controller, USplineComponent*, Path, UPrimitiveComponent*, Component);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FVRBridgeGrabEvent, AVRController*, Controller, UPrimitiveComponent*, Component);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FVRBridgeTeleportEvent, AVRCharacter*, Character, FVector, From, FVector, To);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FVRBridgeDoorEvent, ADoor*, Door, bool, bLocked);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FVRBridgeLeverEvent, ALever*, Lever, float, Scale);
+
+/**
+ * Forwards the native interaction events (UVRInteractionEventSubsystem) to Blueprint. Add it to a
+ * Blueprint that needs them, only events with something bound go through the Blueprint VM.
+ */
+UCLASS(ClassGroup=(VR), meta=(BlueprintSpawnableComponent))
+class GHIBLIWATERHILL_API UVRInteractionEventBridge : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UVRInteractionEventBridge();
+
+	UPROPERTY(BlueprintAssignable)
+	FVRBridgeFlingEvent OnFlingStarted;
+	UPROPERTY(BlueprintAssignable)
+	FVRBridgeGrabEvent OnGrabbed;
+	UPROPERTY(BlueprintAssignable)
+	FVRBridgeGrabEvent OnReleased;
+	UPROPERTY(BlueprintAssignable)
+	FVRBridgeTeleportEvent OnTeleported;
+	UPROPERTY(BlueprintAssignable)
+	FVRBridgeDoorEvent OnDoorLockChanged;
+	UPROPERTY(BlueprintAssignable)
+	FVRBridgeLeverEvent OnLeverChanged;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	FVRInteractionSubscription FlingStartedSubscription = 0;
+	FVRInteractionSubscription GrabbedSubscription = 0;
+	FVRInteractionSubscription ReleasedSubscription = 0;
+	FVRInteractionSubscription TeleportedSubscription = 0;
+	FVRInteractionSubscription DoorLockChangedSubscription = 0;
+	FVRInteractionSubscription LeverChangedSubscription = 0;
+
+	void HandleFlingStarted(const FVRFlingStartedEvent& Event);
+	void HandleGrabbed(const FVRGrabEvent& Event);
+	void HandleReleased(const FVRGrabEvent& Event);
+	void HandleTeleported(const FVRTeleportEvent& Event);
+	void HandleDoorLockChanged(const FVRDoorLockEvent& Event);
+	void HandleLeverChanged(const FVRLeverEvent& Event);
+};
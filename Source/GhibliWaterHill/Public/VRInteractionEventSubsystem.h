@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VRInteractionEvents.h"
+#include "VRInteractionEventSubsystem.generated.h"
+
+/**
+ * Native event bus for interactions. Hands, characters, doors and levers broadcast here, and systems
+ * such as significance, audio or telemetry subscribe to the channels they care about without going
+ * through reflection. Blueprints that need the events use UVRInteractionEventBridge instead.
+ */
+UCLASS()
+class GHIBLIWATERHILL_API UVRInteractionEventSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	TVRInteractionChannel<FVRFlingStartedEvent> FlingStarted;
+	TVRInteractionChannel<FVRGrabEvent> Grabbed;
+	TVRInteractionChannel<FVRGrabEvent> Released;
+	TVRInteractionChannel<FVRTeleportEvent> Teleported;
+	TVRInteractionChannel<FVRDoorLockEvent> DoorLockChanged;
+	TVRInteractionChannel<FVRLeverEvent> LeverChanged;
+};
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AVRController;
+class AVRCharacter;
+class ADoor;
+class ALever;
+class USplineComponent;
+class UPrimitiveComponent;
+
+// Payloads for UVRInteractionEventSubsystem, passed by reference and never stored by the bus
+
+struct FVRFlingStartedEvent
+{
+	AVRController* Controller;
+	USplineComponent* Path;
+	UPrimitiveComponent* Component;
+};
+
+// Grabbed and Released, on the machine doing the grabbing (the owning client predicting it, or the server)
+struct FVRGrabEvent
+{
+	AVRController* Controller;
+	UPrimitiveComponent* Component;
+};
+
+// Once the character has moved, on the owning client and on the server
+struct FVRTeleportEvent
+{
+	AVRCharacter* Character;
+	FVector From;
+	FVector To;
+};
+
+// On the server and, through replication, on clients
+struct FVRDoorLockEvent
+{
+	ADoor* Door;
+	bool bLocked;
+};
+
+// Each time the rod moves a replication step, Scale is the signed rod position from -1 to 1
+struct FVRLeverEvent
+{
+	ALever* Lever;
+	float Scale;
+};
+
+using FVRInteractionSubscription = uint32;
+
+/**
+ * One typed event. Subscribers are a function pointer and a target kept in one array, so a broadcast
+ * is a loop of direct calls with no allocation, reflection or Blueprint VM. Subscribers must unsubscribe
+ * before they are destroyed. Unsubscribing from inside a handler is fine, and a subscriber added by a
+ * handler first hears the next event.
+ */
+template<typename TEvent>
+class TVRInteractionChannel
+{
+public:
+	// Binds a member function without allocating, eg. Events->Grabbed.Subscribe<UMySubsystem, &UMySubsystem::OnGrabbed>(this)
+	template<typename TObject, void (TObject::*Handler)(const TEvent&)>
+	FVRInteractionSubscription Subscribe(TObject* Object)
+	{
+		return Add([](void* Target, const TEvent& Event) { (static_cast<TObject*>(Target)->*Handler)(Event); }, Object);
+	}
+
+	// For free functions, Context is passed back as given
+	FVRInteractionSubscription Subscribe(void (*Handler)(void* Context, const TEvent& Event), void* Context)
+	{
+		return Add(Handler, Context);
+	}
+
+	void Unsubscribe(FVRInteractionSubscription Subscription)
+	{
+		for (FSubscriber& Subscriber : Subscribers)
+		{
+			if (Subscriber.Subscription == Subscription) { Subscriber.Thunk = nullptr; }
+		}
+		// Left in place while broadcasting, so the array doesn't move under the loop
+		if (BroadcastDepth == 0) { Subscribers.RemoveAll([](const FSubscriber& Subscriber) { return !Subscriber.Thunk; }); }
+		else { bNeedsCompact = true; }
+	}
+
+	void Broadcast(const TEvent& Event)
+	{
+		BroadcastDepth++;
+		const int32 NumSubscribers = Subscribers.Num();
+		for (int32 i = 0; i < NumSubscribers; i++)
+		{
+			// Copied out, a handler that subscribes can reallocate the array
+			FSubscriber Subscriber = Subscribers[i];
+			if (Subscriber.Thunk) { Subscriber.Thunk(Subscriber.Target, Event); }
+		}
+		if (--BroadcastDepth == 0 && bNeedsCompact)
+		{
+			bNeedsCompact = false;
+			Subscribers.RemoveAll([](const FSubscriber& Subscriber) { return !Subscriber.Thunk; });
+		}
+	}
+
+	bool HasSubscribers() const { return Subscribers.Num() > 0; }
+
+private:
+	using FThunk = void (*)(void* Target, const TEvent& Event);
+	struct FSubscriber
+	{
+		FThunk Thunk;
+		void* Target;
+		FVRInteractionSubscription Subscription;
+	};
+	TArray<FSubscriber, TInlineAllocator<4>> Subscribers;
+	FVRInteractionSubscription NextSubscription = 1;
+	int32 BroadcastDepth = 0;
+	bool bNeedsCompact = false;
+
+	FVRInteractionSubscription Add(FThunk Thunk, void* Target)
+	{
+		Subscribers.Add({ Thunk, Target, NextSubscription });
+		return NextSubscription++;
+	}
+};
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/World.h"
+#include "VRInteractionPoolSubsystem.generated.h"
+
+class AVRController;
+
+/**
+ * Keeps hand controllers alive between pawns. They are spawned (with their arc meshes) once the
+ * map's actors are initialised, handed out when a pawn begins play and reset and hidden when it ends,
+ * so joining or respawning doesn't pay for spawning and registering a dozen components per hand.
+ * Dynamic materials that only differ by a parameter value are shared, so steady state play creates
+ * no new UObjects.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UVRInteractionPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Falls back to spawning when the pool for this class is empty
+	AVRController* AcquireController(TSubclassOf<AVRController> ControllerClass, AActor* NewOwner);
+	void ReleaseController(AVRController* Controller);
+
+	// Created the first time a parent and value is asked for, then swapped in with SetMaterial instead of setting the parameter per actor
+	class UMaterialInstanceDynamic* GetSharedMaterialInstance(class UMaterialInterface* Parent, FName ScalarParameter, float Value);
+
+private:
+	// Soft so the subsystem doesn't pull the Blueprint into every world that never uses it
+	UPROPERTY(Config)
+	TSoftClassPtr<AVRController> PrewarmControllerClass;
+	// Two per expected player
+	UPROPERTY(Config)
+	int32 PrewarmControllerCount = 4;
+
+	UPROPERTY()
+	TArray<AVRController*> FreeControllers;
+	UPROPERTY()
+	TArray<AVRController*> ActiveControllers;
+
+	UPROPERTY()
+	TArray<class UMaterialInstanceDynamic*> SharedMaterialInstances;
+	struct FSharedMaterialKey
+	{
+		class UMaterialInterface* Parent;
+		FName ScalarParameter;
+		float Value;
+	};
+	// Same order as SharedMaterialInstances, which keep the parents alive
+	TArray<FSharedMaterialKey> SharedMaterialKeys;
+
+	FDelegateHandle ActorsInitializedHandle;
+
+private:
+	void OnActorsInitialized(const UWorld::FActorsInitializedParams& Params);
+	void Prewarm();
+	AVRController* SpawnPooledController(TSubclassOf<AVRController> ControllerClass);
+	void UpdateStats() const;
+};
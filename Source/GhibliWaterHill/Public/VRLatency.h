@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/** The feedback a hand movement has, each gets its own motion to photon histogram */
+enum class EVRLatencyMechanic : uint8
+{
+	// The teleport arc and marker following the aim
+	TeleportArc,
+	// The flick highlight and arc following the palm
+	FlickHighlight,
+	// A grabbed object following the hand
+	HeldObject,
+	Count
+};
+
+/** Where the time goes between a hand moving and the result reaching the display */
+enum class EVRLatencyStage : uint8
+{
+	// Pose sampled until the controller works on it, waiting on the tick order or the work scheduler
+	PoseToTick,
+	// Traces and overlaps
+	TickToQuery,
+	// Splines, meshes, highlight and physics handle updated
+	QueryToUpdate,
+	// Rest of the game frame, physics and the render thread
+	UpdateToSubmit,
+	// GPU and scanout, an estimate from vr.LatencyDisplayHz
+	SubmitToPhoton,
+	Count
+};
+
+/** Timestamps a hand movement carries through one mechanic, in FVRLatency::Now() seconds. Zero PoseTime means not traced */
+struct FVRLatencyTrace
+{
+	double PoseTime = 0;
+	double TickTime = 0;
+	double QueryTime = 0;
+
+	bool IsValid() const { return PoseTime > 0; }
+	// After the mechanic's scene queries, a mechanic without any leaves it unset
+	void MarkQueried();
+};
+
+/** Motion to photon latency of one mechanic, in 0.5 ms buckets */
+struct FVRLatencyHistogram
+{
+	static const int32 NumBuckets = 160;
+	static constexpr float BucketMs = 0.5f;
+
+	// The last bucket holds everything longer
+	uint32 Buckets[NumBuckets] = {};
+	uint32 Count = 0;
+	float MaxMs = 0;
+	double StageSumMs[(int32)EVRLatencyStage::Count] = {};
+
+	void Add(float TotalMs, const float (&StageMs)[(int32)EVRLatencyStage::Count]);
+	// Upper edge of the bucket the percentile falls in
+	float GetPercentileMs(float Percentile) const;
+	float GetStageAverageMs(EVRLatencyStage Stage) const { return Count > 0 ? (float)(StageSumMs[(int32)Stage] / Count) : 0; }
+};
+
+/**
+ * Motion to photon latency of the interaction feedback. A trace starts from the time the hand's pose was
+ * sampled, is stamped as the controller ticks, queries and updates what it shows, and is finished once the
+ * render thread has submitted that frame and the display has scanned it out. Finished traces go into a
+ * histogram per mechanic, `stat VRInteraction` and telemetry.
+ *
+ * Without a renderer (-nullrhi, or vr.LatencySimulate 1) frames are timed as if vsynced at vr.LatencyDisplayHz:
+ * each frame starts on a vsync, work within it is timed for real, the render thread is taken to finish
+ * one frame after the game thread and scanout one frame after that. Headless bot and stress runs then
+ * give the same numbers on any machine, and a mechanic that slips a frame shows up.
+ */
+class GHIBLIWATERHILL_API FVRLatency
+{
+public:
+	static FVRLatency& Get();
+
+	bool IsEnabled() const { return bEnabled; }
+	bool IsSimulated() const { return bSimulated; }
+	// Game thread only, simulated time when headless
+	double Now() const;
+
+	FVRLatencyTrace BeginTrace(double PoseTime) const;
+	// Stamps the update, the trace is finished when its frame has been submitted
+	void Submit(EVRLatencyMechanic Mechanic, const FVRLatencyTrace& Trace);
+
+	const FVRLatencyHistogram& GetHistogram(EVRLatencyMechanic Mechanic) const { return Histograms[(int32)Mechanic]; }
+	void Reset();
+	void LogReport() const;
+
+	// Called by the module
+	void BeginFrame();
+	void EndFrame();
+	// Render thread
+	void RenderFrameEnded();
+
+private:
+	struct FPendingTrace
+	{
+		FVRLatencyTrace Trace;
+		double UpdateTime;
+		uint32 Frame;
+		EVRLatencyMechanic Mechanic;
+	};
+	TArray<FPendingTrace> Pending;
+	FVRLatencyHistogram Histograms[(int32)EVRLatencyMechanic::Count];
+
+	bool bEnabled = false;
+	bool bSimulated = false;
+	double RealFrameStart = 0;
+	double SimulatedFrameStart = 0;
+
+	// When the render thread finished each frame, written by the render thread and read by the game thread
+	static const uint32 NumSubmitSlots = 8;
+	struct FSubmitSlot
+	{
+		std::atomic<uint32> Frame{ 0 };
+		std::atomic<double> Time{ 0 };
+	};
+	FSubmitSlot SubmitSlots[NumSubmitSlots];
+
+	double GetDisplayPeriod() const;
+	void Finish(const FPendingTrace& Finished, double SubmitTime);
+};
+
+inline void FVRLatencyTrace::MarkQueried()
+{
+	if (IsValid()) { QueryTime = FVRLatency::Get().Now(); }
+}
@@ -0,0 +1,340 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/*
+The pure maths behind the VR mechanics: teleport arc and aim assist fan, flick Bezier, flick pose window, thumbstick
+teleport gesture and the lever to bridge mapping. Deliberately engine free (standard headers only) so
+the kernels can be built and timed outside the editor, eg. g++ -O2 -I Public with a small main.
+Vectors are three packed floats, the same layout as FVector, so engine arrays can be passed straight in.
+*/
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VRMATH_SIMD 1
+#else
+#define VRMATH_SIMD 0
+#endif
+
+namespace VRMath
+{
+	struct FVec3
+	{
+		float X, Y, Z;
+	};
+	static_assert(sizeof(FVec3) == 12, "Has to match FVector");
+
+	inline float Clamp(float Value, float Min, float Max) { return Value < Min ? Min : (Value > Max ? Max : Value); }
+
+	/** Palm turned up within the window, the right hand's roll is mirrored */
+	struct FFlickPoseWindow
+	{
+		float MinPitch = -45;
+		float MaxPitch = 25;
+		float MinRoll = 15;
+		float MaxRoll = 120;
+	};
+
+	inline bool IsGoodFlickRotation(float Pitch, float Roll, bool bRightHand, const FFlickPoseWindow& Window = FFlickPoseWindow())
+	{
+		if (bRightHand) { Roll = -Roll; }
+		return Pitch < Window.MaxPitch && Pitch > Window.MinPitch && Roll < Window.MaxRoll && Roll > Window.MinRoll;
+	}
+
+	/** Cubic Bezier through four control points, NumPoints evenly spaced in t from 0 to 1 inclusive */
+	inline void EvaluateBezierScalar(const FVec3* ControlPoints, int NumPoints, FVec3* OutPoints)
+	{
+		if (NumPoints < 2) { if (NumPoints == 1) { OutPoints[0] = ControlPoints[0]; } return; }
+		const FVec3& P0 = ControlPoints[0];
+		const FVec3& P1 = ControlPoints[1];
+		const FVec3& P2 = ControlPoints[2];
+		const FVec3& P3 = ControlPoints[3];
+		float Step = 1.f / (NumPoints - 1);
+		for (int i = 0; i < NumPoints; i++)
+		{
+			float T = i * Step;
+			float U = 1 - T;
+			float B0 = U * U * U, B1 = 3 * U * U * T, B2 = 3 * U * T * T, B3 = T * T * T;
+			OutPoints[i].X = B0 * P0.X + B1 * P1.X + B2 * P2.X + B3 * P3.X;
+			OutPoints[i].Y = B0 * P0.Y + B1 * P1.Y + B2 * P2.Y + B3 * P3.Y;
+			OutPoints[i].Z = B0 * P0.Z + B1 * P1.Z + B2 * P2.Z + B3 * P3.Z;
+		}
+	}
+
+	/** Ballistic arc sampled every 1 / Frequency seconds up to SimTime, returns the number of points written */
+	inline int ArcPointCount(float SimTime, float Frequency)
+	{
+		return (int)std::ceil(SimTime * Frequency) + 1;
+	}
+
+	inline int IntegrateArcScalar(const FVec3& Start, const FVec3& Velocity, float GravityZ, float SimTime, float Frequency, FVec3* OutPoints, int MaxPoints)
+	{
+		int NumPoints = ArcPointCount(SimTime, Frequency);
+		if (NumPoints > MaxPoints) { NumPoints = MaxPoints; }
+		float Step = 1.f / Frequency;
+		for (int i = 0; i < NumPoints; i++)
+		{
+			float T = i * Step < SimTime ? i * Step : SimTime;
+			OutPoints[i].X = Start.X + Velocity.X * T;
+			OutPoints[i].Y = Start.Y + Velocity.Y * T;
+			OutPoints[i].Z = Start.Z + Velocity.Z * T + 0.5f * GravityZ * T * T;
+		}
+		return NumPoints;
+	}
+
+	/**
+	 * How many of an arc's samples it takes to fall below MinZ, up to and including the first one under it
+	 * so the last segment crosses it. The rest can be skipped, there's nothing to land on down there.
+	 */
+	inline int ArcPointCountAbove(const FVec3& Start, const FVec3& Velocity, float GravityZ, float SimTime, float Frequency, float MinZ)
+	{
+		int NumPoints = ArcPointCount(SimTime, Frequency);
+		float Height = Start.Z - MinZ;
+		if (GravityZ >= 0 || Height <= 0) { return NumPoints; }
+		// Positive root of Start.Z + Velocity.Z * t + GravityZ * t^2 / 2 = MinZ
+		float A = 0.5f * GravityZ;
+		float Time = (-Velocity.Z - std::sqrt(Velocity.Z * Velocity.Z - 4 * A * Height)) / (2 * A);
+		int Needed = ArcPointCount(Time, Frequency);
+		if (Needed < 2) { Needed = 2; }
+		return Needed < NumPoints ? Needed : NumPoints;
+	}
+
+	/** Furthest a stretch of arc SpanTime seconds long bows away from the straight line between its ends */
+	inline float ArcSagitta(float GravityZ, float SpanTime)
+	{
+		return std::fabs(GravityZ) * SpanTime * SpanTime / 8;
+	}
+
+	/**
+	 * NumArcs arcs from the same start, eg. a fan of launch directions, each cut off below MinZ (see
+	 * ArcPointCountAbove). Arc A's samples go to OutPoints[A * MaxPoints] onwards, and how many to OutCounts[A].
+	 */
+	inline void IntegrateArcFanScalar(const FVec3& Start, const FVec3* Velocities, int NumArcs, float GravityZ, float SimTime, float Frequency, float MinZ, FVec3* OutPoints, int MaxPoints, int* OutCounts)
+	{
+		for (int Arc = 0; Arc < NumArcs; Arc++)
+		{
+			int Count = ArcPointCountAbove(Start, Velocities[Arc], GravityZ, SimTime, Frequency, MinZ);
+			OutCounts[Arc] = IntegrateArcScalar(Start, Velocities[Arc], GravityZ, SimTime, Frequency, OutPoints + Arc * MaxPoints, Count < MaxPoints ? Count : MaxPoints);
+		}
+	}
+
+#if VRMATH_SIMD
+	namespace Detail
+	{
+		// Four points come out of the SIMD lanes as separate X, Y and Z registers
+		inline void StorePoints(__m128 X, __m128 Y, __m128 Z, FVec3* OutPoints, int Count)
+		{
+			alignas(16) float Xs[4], Ys[4], Zs[4];
+			_mm_store_ps(Xs, X);
+			_mm_store_ps(Ys, Y);
+			_mm_store_ps(Zs, Z);
+			for (int Lane = 0; Lane < Count; Lane++) { OutPoints[Lane] = { Xs[Lane], Ys[Lane], Zs[Lane] }; }
+		}
+	}
+
+	/** Same as EvaluateBezierScalar, four values of t at a time */
+	inline void EvaluateBezierSIMD(const FVec3* ControlPoints, int NumPoints, FVec3* OutPoints)
+	{
+		if (NumPoints < 2) { EvaluateBezierScalar(ControlPoints, NumPoints, OutPoints); return; }
+		const __m128 P0X = _mm_set1_ps(ControlPoints[0].X), P0Y = _mm_set1_ps(ControlPoints[0].Y), P0Z = _mm_set1_ps(ControlPoints[0].Z);
+		const __m128 P1X = _mm_set1_ps(ControlPoints[1].X), P1Y = _mm_set1_ps(ControlPoints[1].Y), P1Z = _mm_set1_ps(ControlPoints[1].Z);
+		const __m128 P2X = _mm_set1_ps(ControlPoints[2].X), P2Y = _mm_set1_ps(ControlPoints[2].Y), P2Z = _mm_set1_ps(ControlPoints[2].Z);
+		const __m128 P3X = _mm_set1_ps(ControlPoints[3].X), P3Y = _mm_set1_ps(ControlPoints[3].Y), P3Z = _mm_set1_ps(ControlPoints[3].Z);
+		const __m128 One = _mm_set1_ps(1), Three = _mm_set1_ps(3);
+		const __m128 Step = _mm_set1_ps(1.f / (NumPoints - 1));
+		const __m128 LaneOffsets = _mm_set_ps(3, 2, 1, 0);
+
+		for (int i = 0; i < NumPoints; i += 4)
+		{
+			__m128 T = _mm_min_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)i), LaneOffsets), Step), One);
+			__m128 U = _mm_sub_ps(One, T);
+			__m128 UU = _mm_mul_ps(U, U), TT = _mm_mul_ps(T, T);
+			__m128 B0 = _mm_mul_ps(UU, U);
+			__m128 B1 = _mm_mul_ps(Three, _mm_mul_ps(UU, T));
+			__m128 B2 = _mm_mul_ps(Three, _mm_mul_ps(U, TT));
+			__m128 B3 = _mm_mul_ps(TT, T);
+			__m128 X = _mm_add_ps(_mm_add_ps(_mm_mul_ps(B0, P0X), _mm_mul_ps(B1, P1X)), _mm_add_ps(_mm_mul_ps(B2, P2X), _mm_mul_ps(B3, P3X)));
+			__m128 Y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(B0, P0Y), _mm_mul_ps(B1, P1Y)), _mm_add_ps(_mm_mul_ps(B2, P2Y), _mm_mul_ps(B3, P3Y)));
+			__m128 Z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(B0, P0Z), _mm_mul_ps(B1, P1Z)), _mm_add_ps(_mm_mul_ps(B2, P2Z), _mm_mul_ps(B3, P3Z)));
+			Detail::StorePoints(X, Y, Z, OutPoints + i, NumPoints - i < 4 ? NumPoints - i : 4);
+		}
+	}
+
+	/** Same as IntegrateArcScalar, four samples at a time */
+	inline int IntegrateArcSIMD(const FVec3& Start, const FVec3& Velocity, float GravityZ, float SimTime, float Frequency, FVec3* OutPoints, int MaxPoints)
+	{
+		int NumPoints = ArcPointCount(SimTime, Frequency);
+		if (NumPoints > MaxPoints) { NumPoints = MaxPoints; }
+		const __m128 SX = _mm_set1_ps(Start.X), SY = _mm_set1_ps(Start.Y), SZ = _mm_set1_ps(Start.Z);
+		const __m128 VX = _mm_set1_ps(Velocity.X), VY = _mm_set1_ps(Velocity.Y), VZ = _mm_set1_ps(Velocity.Z);
+		const __m128 HalfGravity = _mm_set1_ps(0.5f * GravityZ);
+		const __m128 Step = _mm_set1_ps(1.f / Frequency);
+		const __m128 MaxTime = _mm_set1_ps(SimTime);
+		const __m128 LaneOffsets = _mm_set_ps(3, 2, 1, 0);
+
+		for (int i = 0; i < NumPoints; i += 4)
+		{
+			__m128 T = _mm_min_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)i), LaneOffsets), Step), MaxTime);
+			__m128 X = _mm_add_ps(SX, _mm_mul_ps(VX, T));
+			__m128 Y = _mm_add_ps(SY, _mm_mul_ps(VY, T));
+			__m128 Z = _mm_add_ps(_mm_add_ps(SZ, _mm_mul_ps(VZ, T)), _mm_mul_ps(HalfGravity, _mm_mul_ps(T, T)));
+			Detail::StorePoints(X, Y, Z, OutPoints + i, NumPoints - i < 4 ? NumPoints - i : 4);
+		}
+		return NumPoints;
+	}
+
+	namespace Detail
+	{
+		// Four consecutive points of one arc, given as X, Y and Z registers, stored as 12 packed floats
+		inline void StoreArcBlock(__m128 X, __m128 Y, __m128 Z, FVec3* OutPoints, int Count)
+		{
+			if (Count < 4) { StorePoints(X, Y, Z, OutPoints, Count); return; }
+			__m128 XY01 = _mm_unpacklo_ps(X, Y);
+			__m128 XY23 = _mm_unpackhi_ps(X, Y);
+			float* OutFloats = &OutPoints->X;
+			// X0 Y0 Z0 X1, Y1 Z1 X2 Y2, Z2 X3 Y3 Z3
+			_mm_storeu_ps(OutFloats, _mm_shuffle_ps(XY01, _mm_shuffle_ps(Z, X, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storeu_ps(OutFloats + 4, _mm_shuffle_ps(_mm_shuffle_ps(Y, Z, _MM_SHUFFLE(1, 1, 1, 1)), XY23, _MM_SHUFFLE(1, 0, 2, 0)));
+			_mm_storeu_ps(OutFloats + 8, _mm_shuffle_ps(_mm_shuffle_ps(Z, XY23, _MM_SHUFFLE(2, 2, 3, 2)), _mm_shuffle_ps(XY23, Z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+
+		struct FArcLanes
+		{
+			__m128 SX, SY, SZ, VX, VY, VZ, HalfGravity;
+
+			inline void Sample(__m128 T, __m128& X, __m128& Y, __m128& Z) const
+			{
+				X = _mm_add_ps(SX, _mm_mul_ps(VX, T));
+				Y = _mm_add_ps(SY, _mm_mul_ps(VY, T));
+				Z = _mm_add_ps(_mm_add_ps(SZ, _mm_mul_ps(VZ, T)), _mm_mul_ps(HalfGravity, _mm_mul_ps(T, T)));
+			}
+		};
+	}
+
+	/**
+	 * Same as IntegrateArcFanScalar, four arcs at a time, one per lane. Each block of four samples is
+	 * transposed so every arc's points are written out contiguously.
+	 */
+	inline void IntegrateArcFanSIMD(const FVec3& Start, const FVec3* Velocities, int NumArcs, float GravityZ, float SimTime, float Frequency, float MinZ, FVec3* OutPoints, int MaxPoints, int* OutCounts)
+	{
+		const __m128 Step = _mm_set1_ps(1.f / Frequency);
+		const __m128 MaxTime = _mm_set1_ps(SimTime);
+
+		for (int Arc = 0; Arc < NumArcs; Arc += 4)
+		{
+			int Lanes = NumArcs - Arc < 4 ? NumArcs - Arc : 4;
+			alignas(16) float VXs[4] = {}, VYs[4] = {}, VZs[4] = {};
+			int Counts[4] = {};
+			int GroupPoints = 0;
+			for (int Lane = 0; Lane < Lanes; Lane++)
+			{
+				const FVec3& Velocity = Velocities[Arc + Lane];
+				VXs[Lane] = Velocity.X;
+				VYs[Lane] = Velocity.Y;
+				VZs[Lane] = Velocity.Z;
+				int Count = ArcPointCountAbove(Start, Velocity, GravityZ, SimTime, Frequency, MinZ);
+				Counts[Lane] = OutCounts[Arc + Lane] = Count < MaxPoints ? Count : MaxPoints;
+				if (Counts[Lane] > GroupPoints) { GroupPoints = Counts[Lane]; }
+			}
+			const Detail::FArcLanes Lanes4 = { _mm_set1_ps(Start.X), _mm_set1_ps(Start.Y), _mm_set1_ps(Start.Z),
+				_mm_load_ps(VXs), _mm_load_ps(VYs), _mm_load_ps(VZs), _mm_set1_ps(0.5f * GravityZ) };
+			FVec3* ArcPoints = OutPoints + Arc * MaxPoints;
+
+			for (int i = 0; i < GroupPoints; i += 4)
+			{
+				// Rows are samples with the arcs across them, after the transpose each row is one arc's four samples
+				__m128 X0, X1, X2, X3, Y0, Y1, Y2, Y3, Z0, Z1, Z2, Z3;
+				Lanes4.Sample(_mm_min_ps(_mm_mul_ps(_mm_set1_ps((float)i), Step), MaxTime), X0, Y0, Z0);
+				Lanes4.Sample(_mm_min_ps(_mm_mul_ps(_mm_set1_ps((float)(i + 1)), Step), MaxTime), X1, Y1, Z1);
+				Lanes4.Sample(_mm_min_ps(_mm_mul_ps(_mm_set1_ps((float)(i + 2)), Step), MaxTime), X2, Y2, Z2);
+				Lanes4.Sample(_mm_min_ps(_mm_mul_ps(_mm_set1_ps((float)(i + 3)), Step), MaxTime), X3, Y3, Z3);
+				_MM_TRANSPOSE4_PS(X0, X1, X2, X3);
+				_MM_TRANSPOSE4_PS(Y0, Y1, Y2, Y3);
+				_MM_TRANSPOSE4_PS(Z0, Z1, Z2, Z3);
+				if (Counts[0] > i) { Detail::StoreArcBlock(X0, Y0, Z0, ArcPoints + i, Counts[0] - i); }
+				if (Counts[1] > i) { Detail::StoreArcBlock(X1, Y1, Z1, ArcPoints + MaxPoints + i, Counts[1] - i); }
+				if (Counts[2] > i) { Detail::StoreArcBlock(X2, Y2, Z2, ArcPoints + 2 * MaxPoints + i, Counts[2] - i); }
+				if (Counts[3] > i) { Detail::StoreArcBlock(X3, Y3, Z3, ArcPoints + 3 * MaxPoints + i, Counts[3] - i); }
+			}
+		}
+	}
+
+	inline void EvaluateBezier(const FVec3* ControlPoints, int NumPoints, FVec3* OutPoints) { EvaluateBezierSIMD(ControlPoints, NumPoints, OutPoints); }
+	inline int IntegrateArc(const FVec3& Start, const FVec3& Velocity, float GravityZ, float SimTime, float Frequency, FVec3* OutPoints, int MaxPoints)
+	{
+		return IntegrateArcSIMD(Start, Velocity, GravityZ, SimTime, Frequency, OutPoints, MaxPoints);
+	}
+	inline void IntegrateArcFan(const FVec3& Start, const FVec3* Velocities, int NumArcs, float GravityZ, float SimTime, float Frequency, float MinZ, FVec3* OutPoints, int MaxPoints, int* OutCounts)
+	{
+		IntegrateArcFanSIMD(Start, Velocities, NumArcs, GravityZ, SimTime, Frequency, MinZ, OutPoints, MaxPoints, OutCounts);
+	}
+#else
+	inline void EvaluateBezier(const FVec3* ControlPoints, int NumPoints, FVec3* OutPoints) { EvaluateBezierScalar(ControlPoints, NumPoints, OutPoints); }
+	inline int IntegrateArc(const FVec3& Start, const FVec3& Velocity, float GravityZ, float SimTime, float Frequency, FVec3* OutPoints, int MaxPoints)
+	{
+		return IntegrateArcScalar(Start, Velocity, GravityZ, SimTime, Frequency, OutPoints, MaxPoints);
+	}
+	inline void IntegrateArcFan(const FVec3& Start, const FVec3* Velocities, int NumArcs, float GravityZ, float SimTime, float Frequency, float MinZ, FVec3* OutPoints, int MaxPoints, int* OutCounts)
+	{
+		IntegrateArcFanScalar(Start, Velocities, NumArcs, GravityZ, SimTime, Frequency, MinZ, OutPoints, MaxPoints, OutCounts);
+	}
+#endif
+
+	/**
+	 * Teleport gesture on the thumbstick: the stick pulled back and then released upwards quickly.
+	 * Fires when the last N samples are all at or below zero and the newest is Activation above the oldest.
+	 */
+	template<int N>
+	struct TStickGesture
+	{
+		float History[N] = {};
+		int Count = 0;
+		int Head = 0;
+
+		bool Push(float Scale, float Activation)
+		{
+			History[Head] = Scale;
+			Head = (Head + 1) % N;
+			if (Count < N) { Count++; }
+			if (Count < N) { return false; }
+
+			// Head now points at the oldest sample
+			float Oldest = History[Head];
+			float Newest = History[(Head + N - 1) % N];
+			for (int i = 0; i < N; i++)
+			{
+				if (History[i] > 0) { return false; }
+			}
+			return Newest - Oldest > Activation;
+		}
+
+		void Reset() { Count = 0; Head = 0; }
+	};
+
+	/** Lever rod position (-1 to 1) to how far open it is (0 to 1), with a dead zone around the middle */
+	inline float LeverOpenAmount(float SignedRodScale, float DeadZone = 0.05f)
+	{
+		float Amount = std::fabs(SignedRodScale);
+		return Amount < DeadZone ? 0 : Clamp(Amount, 0, 1);
+	}
+
+	/** Rod pitch relative to its rest pitch, to a signed scale */
+	inline float RodPitchToScale(float RelativePitch, float MaxPitch)
+	{
+		return Clamp(RelativePitch / MaxPitch, -1, 1);
+	}
+
+	/** How far the bridge pitches up from its lowered rotation for a lever open amount */
+	inline float BridgePitchForLever(float OpenAmount, float Sweep = 90)
+	{
+		return Sweep * OpenAmount;
+	}
+
+	/** 0-1 to a byte, for replicating lever and bridge positions */
+	inline unsigned char QuantizeUnit8(float Value)
+	{
+		return (unsigned char)(Clamp(Value, 0, 1) * 255 + 0.5f);
+	}
+}
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "VRMemoryTracking.h"
+#include "VRMemoryBudgetSubsystem.generated.h"
+
+/**
+ * Checks the VR LLM tags against their budgets every CheckInterval seconds and warns once each time one
+ * goes over. With vr.MemorySteadyState set, it also takes a baseline after SteadyStateWarmup seconds and
+ * fails if any tag grows past SteadyStateToleranceKB from it, so a long headless session catches leaks.
+ * Needs -llm, without it nothing is tracked. Garbage collection pauses and the live UObject count are
+ * tracked either way, and the UObject count is held to SteadyStateToleranceObjects from the baseline.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UVRMemoryBudgetSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+	void LogReport() const;
+
+private:
+	UPROPERTY(Config)
+	float CheckInterval = 2;
+	UPROPERTY(Config)
+	float TeleportBudgetKB = 512;
+	UPROPERTY(Config)
+	float FlickBudgetKB = 256;
+	UPROPERTY(Config)
+	float GrabBudgetKB = 64;
+	UPROPERTY(Config)
+	float HighlightBudgetKB = 64;
+	UPROPERTY(Config)
+	float InteractablesBudgetKB = 1024;
+	UPROPERTY(Config)
+	float SteadyStateWarmup = 60;
+	UPROPERTY(Config)
+	float SteadyStateToleranceKB = 64;
+	UPROPERTY(Config)
+	int32 SteadyStateToleranceObjects = 256;
+
+	float TimeSinceCheck = 0;
+	float TimeRunning = 0;
+	bool bOverBudget[NumVRLLMTags] = {};
+	int64 SteadyStateBaseline[NumVRLLMTags] = {};
+	bool bHasBaseline = false;
+	bool bSteadyStateFailed = false;
+	bool bWarnedNoLLM = false;
+	int32 ObjectBaseline = 0;
+
+	FDelegateHandle PreGCHandle;
+	FDelegateHandle PostGCHandle;
+	uint64 GCStartCycles = 0;
+	int32 GCCount = 0;
+	double GCTotalMs = 0;
+	float GCMaxMs = 0;
+
+private:
+	float GetBudgetKB(int32 TagIndex) const;
+	void CheckSteadyState(const int64* TagBytes);
+	void CheckObjectSteadyState(int32 NumObjects);
+	void FailSteadyState();
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/*
+Low level memory tags for the VR mechanics. Run with -llm and use stat LLMFULL to see them, or let
+UVRMemoryBudgetSubsystem warn when one goes over its budget.
+*/
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+enum class EVRLLMTag : uint8
+{
+	Teleport = (uint8)ELLMTag::ProjectTagStart,
+	Flick,
+	Grab,
+	Highlight,
+	Interactables,
+	End
+};
+
+#define VR_LLM_SCOPE(Tag) LLM_SCOPE((ELLMTag)EVRLLMTag::Tag)
+
+#else
+
+#define VR_LLM_SCOPE(Tag)
+
+#endif
+
+// Called once from the module startup, before anything allocates under the tags
+void RegisterVRLLMTags();
+// Bytes currently tracked under a tag, -1 when LLM isn't running
+int64 GetVRLLMTagBytes(int32 TagIndex);
+const TCHAR* GetVRLLMTagName(int32 TagIndex);
+const int32 NumVRLLMTags = 5;
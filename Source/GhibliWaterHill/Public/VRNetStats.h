@@ -0,0 +1,9 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Periodic net reports (vr.NetReportInterval), started and stopped with the module so the ticker never outlives it
+void StartVRNetReports();
+void StopVRNetReports();
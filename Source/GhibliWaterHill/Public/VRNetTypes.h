@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InputCoreTypes.h"
+#include "Engine/NetSerialization.h"
+#include "VRNetTypes.generated.h"
+
+/**
+ * A tracking space transform (relative to the pawn's VRRoot) quantised for the wire.
+ * Position is stored in millimetres, rotation as smallest-three with 10 bits per component,
+ * 77 bits in total instead of the 28 bytes of a raw location and quaternion.
+ */
+USTRUCT()
+struct GHIBLIWATERHILL_API FVRQuantizedTransform
+{
+	GENERATED_BODY()
+
+	static const int32 PositionBits = 15;
+	static const int32 MaxPosition = (1 << (PositionBits - 1)) - 1; // +-16.38m at 1mm
+	static const int32 RotationComponentBits = 10;
+
+	int32 Position[3] = { 0, 0, 0 };
+	uint32 PackedRotation = 0;
+
+	void FromTransform(const FTransform& Transform);
+	FTransform ToTransform() const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FVRQuantizedTransform& Other) const
+	{
+		return Position[0] == Other.Position[0] && Position[1] == Other.Position[1] && Position[2] == Other.Position[2] && PackedRotation == Other.PackedRotation;
+	}
+	bool operator!=(const FVRQuantizedTransform& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FVRQuantizedTransform> : public TStructOpsTypeTraitsBase2<FVRQuantizedTransform>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/**
+ * HMD and both hands. Deliberately has no NetSerialize of its own so the property replication
+ * compares each member against the connection's last acknowledged state and only resends those that changed.
+ */
+USTRUCT()
+struct GHIBLIWATERHILL_API FVRReplicatedPoses
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVRQuantizedTransform Head;
+	UPROPERTY()
+	FVRQuantizedTransform Left;
+	UPROPERTY()
+	FVRQuantizedTransform Right;
+
+	static const int32 NumPoses = 3;
+	FVRQuantizedTransform& GetPose(int32 Index) { return Index == 0 ? Head : (Index == 1 ? Left : Right); }
+	const FVRQuantizedTransform& GetPose(int32 Index) const { return Index == 0 ? Head : (Index == 1 ? Left : Right); }
+
+	bool operator==(const FVRReplicatedPoses& Other) const { return Head == Other.Head && Left == Other.Left && Right == Other.Right; }
+	bool operator!=(const FVRReplicatedPoses& Other) const { return !(*this == Other); }
+};
+
+/**
+ * Client to server pose update, delta compressed against the last pose the server acknowledged.
+ * Only the poses that changed are written, and each position axis is sent as a small delta where it fits.
+ */
+USTRUCT()
+struct GHIBLIWATERHILL_API FVRPoseDelta
+{
+	GENERATED_BODY()
+
+	uint16 Sequence = 0;
+	uint16 BaselineSequence = 0;
+	bool bHasBaseline = false;
+	uint8 ChangedMask = 0;
+	// Absolute when there is no baseline, otherwise the difference from it
+	FVRQuantizedTransform Poses[FVRReplicatedPoses::NumPoses];
+
+	static FVRPoseDelta Make(uint16 Sequence, const FVRReplicatedPoses& Current, const FVRReplicatedPoses* Baseline, uint16 BaselineSequence);
+	FVRReplicatedPoses Apply(const FVRReplicatedPoses& Baseline) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FVRPoseDelta> : public TStructOpsTypeTraitsBase2<FVRPoseDelta>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Flick start, sent once instead of the flicked component's transform every frame */
+USTRUCT()
+struct GHIBLIWATERHILL_API FVRFlickEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EControllerHand Hand = EControllerHand::Left;
+	UPROPERTY()
+	FVector_NetQuantize10 Start;
+	UPROPERTY()
+	FVector_NetQuantize10 ControlPoint1;
+	UPROPERTY()
+	FVector_NetQuantize10 ControlPoint2;
+	UPROPERTY()
+	FVector_NetQuantize10 End;
+};
+
+/** Sequence numbers wrap, so compare them in a window */
+FORCEINLINE bool IsNewerVRSequence(uint16 A, uint16 B)
+{
+	return A != B && (uint16)(A - B) < 0x8000;
+}
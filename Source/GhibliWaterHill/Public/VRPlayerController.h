@@ -6,12 +6,57 @@
 #include "GameFramework/PlayerController.h"
 #include "VRPlayerController.generated.h"
 
+UENUM()
+enum class EVRBotAction : uint8
+{
+	Idle,
+	Teleport,
+	Turn,
+	Flick,
+	Grab
+};
+
 /**
- * 
+ * With -vrbot on the command line the local player is driven by a bot, for load testing a dedicated
+ * server with many headless (-nullrhi) clients. The bot moves the head and hands procedurally, so poses
+ * replicate as they would from a headset, and feeds the Touch controller keys into the player input, so
+ * teleports, turns, flicks and grabs go through the same bindings as AVRCharacter::SetupPlayerInputComponent.
  */
-UCLASS()
+UCLASS(Config=Game)
 class GHIBLIWATERHILL_API AVRPlayerController : public APlayerController
 {
 	GENERATED_BODY()
-	
+
+public:
+	virtual void BeginPlay() override;
+	virtual void PlayerTick(float DeltaTime) override;
+
+	bool bIsBot() const { return bBot; }
+
+private:
+	UPROPERTY(Config)
+	float BotMinIdleTime = 1;
+	UPROPERTY(Config)
+	float BotMaxIdleTime = 4;
+	// How far the head looks around either side
+	UPROPERTY(Config)
+	float BotLookYaw = 40;
+
+	bool bBot = false;
+	FRandomStream BotRandom;
+	float BotTime = 0;
+	float BotPhase = 0;
+	EVRBotAction BotAction = EVRBotAction::Idle;
+	float BotActionTime = 0;
+	float BotActionLength = 0;
+	float BotTurnDirection = 1;
+	bool bBotTeleportPressed = false;
+
+private:
+	void TickBot(float DeltaTime);
+	void TickBotPoses(class AVRCharacter* Character, float DeltaTime);
+	void TickBotInput(class AVRCharacter* Character, float DeltaTime);
+	void StartBotAction();
+	// The hand the character teleports and turns with
+	bool bBotTeleportsLeft(class AVRCharacter* Character) const;
 };
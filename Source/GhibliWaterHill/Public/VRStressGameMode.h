@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+#include "VRStressGameMode.generated.h"
+
+UENUM()
+enum class EStressSweep : uint8
+{
+	// Builds Props, Levers and Chains once and measures that
+	None,
+	// Scales each of them on its own from zero, after a baseline with nothing
+	Each,
+	// Scales all three together
+	All
+};
+
+/**
+ * Builds synthetic worlds for scaling tests and measures the frame time in each. Rooms are laid out
+ * above the map with physics props, lever to bridge pairs and keycard to reader to door chains spread
+ * over them. Scripted input sweeps the levers, reads the keycards, and swaps the player's hands
+ * between the flick pose and grabbing a prop, so FlickHighlight, TryGrab, the reader overlaps and the
+ * lever and bridge ticks all run. Results go to Saved/Stress/VRStress-<time>.csv, one row per step.
+ *
+ * Options come from the URL, eg. test?game=VRStress?Props=2000?Levers=50?Chains=50?Rooms=9?Steps=4?Sweep=Each
+ * Layout=Grid or Line, Walls=0 or 1, Exit=0 to stay in the world when done.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API AVRStressGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AVRStressGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	// The project's Blueprints carry the meshes, so those are what gets spawned
+	UPROPERTY(Config)
+	TSoftClassPtr<APawn> StressPawnClass;
+	UPROPERTY(Config)
+	TSoftClassPtr<APlayerController> StressPlayerControllerClass;
+	UPROPERTY(Config)
+	TSoftClassPtr<class ALever> LeverClass;
+	UPROPERTY(Config)
+	TSoftClassPtr<class ABridge> BridgeClass;
+	UPROPERTY(Config)
+	TSoftClassPtr<class AKeycard> KeycardClass;
+	UPROPERTY(Config)
+	TSoftClassPtr<class AKeycardReader> KeycardReaderClass;
+	UPROPERTY(Config)
+	TSoftClassPtr<class ADoor> DoorClass;
+
+	UPROPERTY(Config)
+	FVector RoomOrigin = FVector(0, 0, 20000);
+	UPROPERTY(Config)
+	float RoomSize = 3000;
+	UPROPERTY(Config)
+	float WarmupTime = 3;
+	UPROPERTY(Config)
+	float MeasureTime = 10;
+	UPROPERTY(Config)
+	float LeverPeriod = 4;
+	UPROPERTY(Config)
+	float KeycardPeriod = 3;
+	UPROPERTY(Config)
+	float HandPeriod = 4;
+
+	// From the URL
+	int32 NumProps = 500;
+	int32 NumLevers = 20;
+	int32 NumChains = 20;
+	int32 NumRooms = 4;
+	int32 NumSteps = 4;
+	EStressSweep Sweep = EStressSweep::Each;
+	bool bLineLayout = false;
+	bool bWalls = true;
+	bool bExitWhenDone = true;
+
+	struct FStressStep
+	{
+		FString Dimension;
+		int32 Props = 0;
+		int32 Levers = 0;
+		int32 Chains = 0;
+	};
+	TArray<FStressStep> Steps;
+	int32 CurrentStep = INDEX_NONE;
+	float StepTime = 0;
+	TArray<float> FrameTimesMs;
+	double LastFrameSeconds = 0;
+	FString CsvPath;
+	FString Csv;
+
+	UPROPERTY(Transient)
+	TArray<AActor*> StepActors;
+	UPROPERTY(Transient)
+	TArray<class UStaticMeshComponent*> StepProps;
+
+	struct FStressLever
+	{
+		TWeakObjectPtr<class ALever> Lever;
+		float Phase = 0;
+	};
+	TArray<FStressLever> Levers;
+
+	struct FStressChain
+	{
+		TWeakObjectPtr<class AKeycard> Keycard;
+		TWeakObjectPtr<class AKeycardReader> Reader;
+		FVector RestLocation = FVector::ZeroVector;
+		float Phase = 0;
+		bool bInserted = false;
+	};
+	TArray<FStressChain> Chains;
+
+	bool bPawnPlaced = false;
+	bool bHandGrabbing = false;
+	float ScriptTime = 0;
+	FRandomStream Random;
+
+private:
+	void BuildSteps();
+	void BuildRooms();
+	FVector GetRoomLocation(int32 Room) const;
+	FVector GetSpawnLocation(int32 Index);
+	void StartStep(int32 Step);
+	void ClearStep();
+	void FinishStep();
+	void TickScriptedInput(float DeltaSeconds);
+	void TickHands(class AVRCharacter* Character, float DeltaSeconds);
+	class AStaticMeshActor* SpawnCube(const FVector& Location, const FVector& Scale, bool bSimulate);
+};
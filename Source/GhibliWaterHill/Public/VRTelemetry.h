@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include <atomic>
+
+enum class EVRTelemetryEvent : uint32
+{
+	// Timings, Value in milliseconds
+	FrameTime,
+	GameThreadTime,
+	TeleportPhase,
+	FlickPhase,
+	GrabPhase,
+	// Gameplay events, Value is the hand where there is one
+	Teleport,
+	FlickStarted,
+	Grabbed,
+	Released,
+	DoorUnlocked,
+	// Written by the writer thread when the ring was full, Value is the number of records lost
+	Dropped,
+	// Garbage collection pause, Value in milliseconds. After Dropped so older files read the same
+	GarbageCollect,
+	// Motion to photon latency of one hand movement, Value in milliseconds, see FVRLatency
+	TeleportArcLatency,
+	FlickHighlightLatency,
+	HeldObjectLatency
+};
+
+struct FVRTelemetryRecord
+{
+	uint64 Cycles;
+	float Value;
+	EVRTelemetryEvent Type;
+};
+static_assert(sizeof(FVRTelemetryRecord) == 16, "Telemetry records are written as raw memory");
+
+/**
+ * Session telemetry. The game thread pushes fixed size records into a single producer, single consumer
+ * ring, and a writer thread streams them to Saved/Telemetry. The writer also keeps the last few seconds,
+ * and when a frame goes over vr.TelemetryHitchMs it dumps them as a separate hitch report.
+ * Recording costs a timestamp and a store, and never blocks: when the ring is full records are dropped.
+ */
+class GHIBLIWATERHILL_API FVRTelemetry
+{
+public:
+	static FVRTelemetry& Get();
+
+	// Game thread only
+	FORCEINLINE void Record(EVRTelemetryEvent Type, float Value = 0)
+	{
+		if (!bRecording) { return; }
+		checkSlow(IsInGameThread());
+		uint32 Write = WriteIndex.load(std::memory_order_relaxed);
+		if (Write - ReadIndex.load(std::memory_order_acquire) >= RingSize)
+		{
+			DroppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		Ring[Write & (RingSize - 1)] = { FPlatformTime::Cycles64(), Value, Type };
+		WriteIndex.store(Write + 1, std::memory_order_release);
+	}
+
+	void Start();
+	void Stop();
+	bool IsRecording() const { return bRecording; }
+	// Called at the end of every frame by the module
+	void RecordFrame();
+
+private:
+	static const uint32 RingSize = 1 << 16;
+	FVRTelemetryRecord Ring[RingSize];
+
+	// Kept on their own cache lines so the two threads don't invalidate each other on every record
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> WriteIndex{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> ReadIndex{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> DroppedCount{ 0 };
+	bool bRecording = false;
+
+	class FVRTelemetryWriter* Writer = nullptr;
+	class FRunnableThread* WriterThread = nullptr;
+
+	friend class FVRTelemetryWriter;
+};
+
+/** Records how long the enclosing scope took as one record */
+class FVRTelemetryScope
+{
+public:
+	FORCEINLINE explicit FVRTelemetryScope(EVRTelemetryEvent InType)
+		: Type(InType)
+		, StartCycles(FVRTelemetry::Get().IsRecording() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+	FORCEINLINE ~FVRTelemetryScope()
+	{
+		if (StartCycles == 0) { return; }
+		FVRTelemetry::Get().Record(Type, (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+private:
+	EVRTelemetryEvent Type;
+	uint64 StartCycles;
+};
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "VRWorkSchedulerSubsystem.generated.h"
+
+UENUM()
+enum class EVRWorkPriority : uint8
+{
+	// Runs as soon as it is requested and is never deferred, eg. the arc under the aiming hand
+	Critical,
+	High,
+	Normal,
+	Low
+};
+
+/**
+ * Runs interaction work within a per frame CPU budget. Systems register work with a priority and an
+ * estimated cost (refined from measured runs) and request it on the frames they want it. Critical work
+ * runs straight away; everything else runs at the end of the frame, highest priority first, until
+ * BudgetMs is spent. Anything that doesn't fit carries over to the next frame, and work deferred for
+ * MaxDeferredFrames in a row runs regardless so low priority systems can't starve.
+ */
+UCLASS(Config=Game)
+class GHIBLIWATERHILL_API UVRWorkSchedulerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return Items.Num() > 0; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+	// Work is passed the time since it last ran. bEveryFrame work is requested automatically, and
+	// the work is dropped once Owner is destroyed. Returns the handle to request and unregister it with.
+	int32 RegisterWork(UObject* Owner, FName Name, EVRWorkPriority Priority, float EstimatedCostMs, TFunction<void(float)> Work, bool bEveryFrame = false);
+	void UnregisterWork(int32 Handle);
+	// False if there is no such work, so the caller can run it itself
+	bool RequestWork(int32 Handle);
+
+	void LogReport() const;
+	// Synthetic load: Count every frame items of CostMs each, spread over the non critical priorities. 0 removes them
+	void SetStressLoad(int32 Count, float CostMs);
+
+private:
+	UPROPERTY(Config)
+	float BudgetMs = 1.5;
+	UPROPERTY(Config)
+	int32 MaxDeferredFrames = 4;
+	// How quickly the estimated cost follows measured runs
+	UPROPERTY(Config)
+	float CostSmoothing = 0.2;
+
+	struct FWorkItem
+	{
+		int32 Handle = INDEX_NONE;
+		FName Name;
+		TWeakObjectPtr<UObject> Owner;
+		EVRWorkPriority Priority = EVRWorkPriority::Normal;
+		float EstimatedCostMs = 0;
+		TFunction<void(float)> Work;
+		bool bEveryFrame = false;
+		bool bRequested = false;
+		float LastRunTime = -1;
+		int32 FramesDeferred = 0;
+		// For the report
+		int32 Runs = 0;
+		int32 Deferrals = 0;
+		int32 ForcedRuns = 0;
+	};
+	TArray<FWorkItem> Items;
+	int32 NextHandle = 0;
+
+	// Critical work runs outside Tick, so it is added to the frame it ran in
+	uint64 CriticalFrame = 0;
+	float CriticalMs = 0;
+
+	int32 FramesScheduled = 0;
+	int32 FramesOverBudget = 0;
+	float WorstFrameMs = 0;
+
+private:
+	FWorkItem* FindItem(int32 Handle);
+	float RunItem(FWorkItem& Item);
+	float GetBudgetMs() const;
+};
@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+Checks that the SIMD kernels in VRMathCore.h give the scalar results, then times both.
+	VRMathBench           check, then print ns per call
+	VRMathBench --check   check only, exits non zero on a mismatch
+*/
+
+#include "VRMathCore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using VRMath::FVec3;
+
+namespace
+{
+	const float GravityZ = -980;
+	const float ArcSimTime = 2;
+	const float ArcFrequency = 30;
+	const int MaxArcPoints = 64;
+	const int FanArcs = 16;
+	const int BezierPoints = 32;
+
+	int NumFailures = 0;
+	float MaxError = 0;
+
+	// The SIMD paths multiply in a different order, so allow for float rounding at the scale of the arc
+	bool NearlyEqual(const FVec3& A, const FVec3& B)
+	{
+		const float Tolerance = 1e-3f;
+		const float Components[3][2] = { { A.X, B.X }, { A.Y, B.Y }, { A.Z, B.Z } };
+		for (const auto& Pair : Components)
+		{
+			float Error = std::fabs(Pair[0] - Pair[1]);
+			float Scale = std::fabs(Pair[0]) > 1 ? std::fabs(Pair[0]) : 1;
+			if (Error > MaxError) { MaxError = Error; }
+			if (Error > Tolerance * Scale) { return false; }
+		}
+		return true;
+	}
+
+	void Fail(const char* Kernel, int Case, int Point, const FVec3& Scalar, const FVec3& SIMD)
+	{
+		if (NumFailures++ < 10)
+		{
+			std::printf("FAIL %s case %d point %d: scalar (%f %f %f) simd (%f %f %f)\n", Kernel, Case, Point, Scalar.X, Scalar.Y, Scalar.Z, SIMD.X, SIMD.Y, SIMD.Z);
+		}
+	}
+
+	FVec3 RandomVec(std::mt19937& Random, float Min, float Max)
+	{
+		std::uniform_real_distribution<float> Range(Min, Max);
+		return { Range(Random), Range(Random), Range(Random) };
+	}
+
+	// A launch speed between 400 and 1500 in a random direction, up to 60 degrees above the horizon
+	FVec3 RandomLaunch(std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Unit(0, 1);
+		float Yaw = Unit(Random) * 6.2831853f;
+		float Pitch = (Unit(Random) * 90 - 30) * 0.0174533f;
+		float Speed = 400 + Unit(Random) * 1100;
+		return { std::cos(Pitch) * std::cos(Yaw) * Speed, std::cos(Pitch) * std::sin(Yaw) * Speed, std::sin(Pitch) * Speed };
+	}
+
+	void CheckBezier(std::mt19937& Random)
+	{
+		FVec3 Scalar[BezierPoints * 2], SIMD[BezierPoints * 2];
+		for (int Case = 0; Case < 1000; Case++)
+		{
+			FVec3 ControlPoints[4];
+			for (FVec3& Point : ControlPoints) { Point = RandomVec(Random, -3000, 3000); }
+			// Every remainder of four, including the single point case
+			int NumPoints = 1 + Case % (BezierPoints * 2);
+			VRMath::EvaluateBezierScalar(ControlPoints, NumPoints, Scalar);
+			VRMath::EvaluateBezier(ControlPoints, NumPoints, SIMD);
+			for (int i = 0; i < NumPoints; i++)
+			{
+				if (!NearlyEqual(Scalar[i], SIMD[i])) { Fail("Bezier", Case, i, Scalar[i], SIMD[i]); }
+			}
+		}
+	}
+
+	void CheckArc(std::mt19937& Random)
+	{
+		FVec3 Scalar[MaxArcPoints], SIMD[MaxArcPoints];
+		for (int Case = 0; Case < 1000; Case++)
+		{
+			FVec3 Start = RandomVec(Random, -5000, 5000);
+			FVec3 Velocity = RandomLaunch(Random);
+			// Vary the cap so the last block is partial
+			int MaxPoints = 2 + Case % (MaxArcPoints - 1);
+			int ScalarCount = VRMath::IntegrateArcScalar(Start, Velocity, GravityZ, ArcSimTime, ArcFrequency, Scalar, MaxPoints);
+			int SIMDCount = VRMath::IntegrateArc(Start, Velocity, GravityZ, ArcSimTime, ArcFrequency, SIMD, MaxPoints);
+			if (ScalarCount != SIMDCount)
+			{
+				if (NumFailures++ < 10) { std::printf("FAIL Arc case %d: scalar %d points, simd %d\n", Case, ScalarCount, SIMDCount); }
+				continue;
+			}
+			for (int i = 0; i < ScalarCount; i++)
+			{
+				if (!NearlyEqual(Scalar[i], SIMD[i])) { Fail("Arc", Case, i, Scalar[i], SIMD[i]); }
+			}
+		}
+	}
+
+	void CheckArcFan(std::mt19937& Random)
+	{
+		std::vector<FVec3> Scalar(FanArcs * MaxArcPoints), SIMD(FanArcs * MaxArcPoints);
+		FVec3 Velocities[FanArcs];
+		for (int Case = 0; Case < 500; Case++)
+		{
+			FVec3 Start = RandomVec(Random, -5000, 5000);
+			for (FVec3& Velocity : Velocities) { Velocity = RandomLaunch(Random); }
+			// Partial groups of four arcs, and floors both above and below the start
+			int NumArcs = 1 + Case % FanArcs;
+			float MinZ = Start.Z - 1500 + (Case % 7) * 250.f;
+			int ScalarCounts[FanArcs], SIMDCounts[FanArcs];
+			VRMath::IntegrateArcFanScalar(Start, Velocities, NumArcs, GravityZ, ArcSimTime, ArcFrequency, MinZ, Scalar.data(), MaxArcPoints, ScalarCounts);
+			VRMath::IntegrateArcFan(Start, Velocities, NumArcs, GravityZ, ArcSimTime, ArcFrequency, MinZ, SIMD.data(), MaxArcPoints, SIMDCounts);
+			for (int Arc = 0; Arc < NumArcs; Arc++)
+			{
+				if (ScalarCounts[Arc] != SIMDCounts[Arc])
+				{
+					if (NumFailures++ < 10) { std::printf("FAIL ArcFan case %d arc %d: scalar %d points, simd %d\n", Case, Arc, ScalarCounts[Arc], SIMDCounts[Arc]); }
+					continue;
+				}
+				for (int i = 0; i < ScalarCounts[Arc]; i++)
+				{
+					const FVec3& A = Scalar[Arc * MaxArcPoints + i];
+					const FVec3& B = SIMD[Arc * MaxArcPoints + i];
+					if (!NearlyEqual(A, B)) { Fail("ArcFan", Case, Arc * MaxArcPoints + i, A, B); }
+				}
+			}
+		}
+	}
+
+	// Keeps the optimiser from dropping the calls being timed
+	volatile float Sink;
+
+	template<typename FunctionType>
+	double NanosecondsPerCall(FunctionType Function)
+	{
+		const int Calls = 200000;
+		for (int i = 0; i < Calls / 10; i++) { Function(i); }
+		auto Start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Calls; i++) { Function(i); }
+		auto End = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(End - Start).count() / Calls;
+	}
+
+	void Report(const char* Kernel, double Scalar, double SIMD)
+	{
+		std::printf("%-34s %10.1f %10.1f %8.2fx\n", Kernel, Scalar, SIMD, Scalar / SIMD);
+	}
+
+	void Bench()
+	{
+		std::mt19937 Random(7);
+		FVec3 ControlPoints[4];
+		for (FVec3& Point : ControlPoints) { Point = RandomVec(Random, -3000, 3000); }
+		FVec3 Start = { 0, 0, 150 };
+		FVec3 Velocities[FanArcs];
+		for (FVec3& Velocity : Velocities) { Velocity = RandomLaunch(Random); }
+		std::vector<FVec3> Points(FanArcs * MaxArcPoints);
+		int Counts[FanArcs];
+
+		std::printf("%-34s %10s %10s %9s\n", "ns per call", "scalar", "simd", "speedup");
+		Report("Bezier, 32 points",
+			NanosecondsPerCall([&](int i) { ControlPoints[3].X = (float)(i & 63); VRMath::EvaluateBezierScalar(ControlPoints, BezierPoints, Points.data()); Sink = Points[BezierPoints - 1].X; }),
+			NanosecondsPerCall([&](int i) { ControlPoints[3].X = (float)(i & 63); VRMath::EvaluateBezier(ControlPoints, BezierPoints, Points.data()); Sink = Points[BezierPoints - 1].X; }));
+		Report("Arc, 2 s at 30 Hz",
+			NanosecondsPerCall([&](int i) { Start.X = (float)(i & 63); Sink = (float)VRMath::IntegrateArcScalar(Start, Velocities[0], GravityZ, ArcSimTime, ArcFrequency, Points.data(), MaxArcPoints) + Points[1].X; }),
+			NanosecondsPerCall([&](int i) { Start.X = (float)(i & 63); Sink = (float)VRMath::IntegrateArc(Start, Velocities[0], GravityZ, ArcSimTime, ArcFrequency, Points.data(), MaxArcPoints) + Points[1].X; }));
+		Report("Arc fan, 16 arcs cut 500 below",
+			NanosecondsPerCall([&](int i) { Start.X = (float)(i & 63); VRMath::IntegrateArcFanScalar(Start, Velocities, FanArcs, GravityZ, ArcSimTime, ArcFrequency, Start.Z - 500, Points.data(), MaxArcPoints, Counts); Sink = Points[1].X + Counts[0]; }),
+			NanosecondsPerCall([&](int i) { Start.X = (float)(i & 63); VRMath::IntegrateArcFan(Start, Velocities, FanArcs, GravityZ, ArcSimTime, ArcFrequency, Start.Z - 500, Points.data(), MaxArcPoints, Counts); Sink = Points[1].X + Counts[0]; }));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool bCheckOnly = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+	if (!VRMATH_SIMD) { std::printf("Built without SSE2, the SIMD entry points are the scalar ones\n"); }
+
+	std::mt19937 Random(1);
+	CheckBezier(Random);
+	CheckArc(Random);
+	CheckArcFan(Random);
+	if (NumFailures > 0)
+	{
+		std::printf("%d mismatches between the scalar and SIMD kernels, largest error %g\n", NumFailures, MaxError);
+		return 1;
+	}
+	std::printf("Scalar and SIMD kernels match, largest error %g\n", MaxError);
+
+	if (!bCheckOnly) { Bench(); }
+	return 0;
+}